@@ -0,0 +1,102 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file admission.h
+ *
+ * Definition of type Admission_t
+ *
+ * The admission decides whether a new client can be served, instead of
+ * letting the reactors poll the listening socket while the limit of
+ * clients connected at the same time has been reached :
+ * 		- the connected clients (n_client) : at most max_client
+ *		- a bounded queue of clients already accepted that wait for a
+ *        free place (waiting) : at most max_waiting, 0 to disable it
+ *		- the accepts in progress (n_reserved) : a reactor reserves a place
+ *        (or a place in the queue) before accepting, so an accepted client
+ *        always finds one even if several reactors accept at the same time
+ *		- the lack of descriptors (starved) : an accept has failed because
+ *        the process has no descriptor left (EMFILE, ENFILE), the clients
+ *        wait in the backlog until a client leaves or retryAdmission
+ *		- the watch function : called when the listening socket must no
+ *        longer be watched (all the places and the queue are taken, or
+ *        no descriptor is left) and when it must be watched again
+ *
+ * A client that leaves gives its place directly to the oldest waiting client,
+ * the clients still waiting when the server stops are rejected.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef ADMISSION_H_
+#define ADMISSION_H_
+
+#include <pthread.h>
+
+// outcome of enterAdmission
+#define ADMISSION_ACCEPTED  (0)
+#define ADMISSION_QUEUED    (1)
+
+typedef struct Admission {
+    unsigned long   max_client;
+    unsigned long   n_client;
+    long*           waiting;
+    unsigned long   max_waiting;
+    unsigned long   head;
+    unsigned long   n_waiting;
+    unsigned long   n_reserved;
+    int             watching;
+    int             starved;
+    void            (*watch)(int on);
+    unsigned long   n_queued;
+    unsigned long   n_rejected;
+    pthread_mutex_t lock;
+} Admission_t;
+
+
+Admission_t* initAdmission( unsigned long max_client, unsigned long max_waiting, void (*watch)(int on) );
+
+void deleteAdmission( Admission_t* a );
+
+int reserveAdmission( Admission_t* a );
+
+void cancelAdmission( Admission_t* a );
+
+void starveAdmission( Admission_t* a );
+
+void retryAdmission( Admission_t* a );
+
+int enterAdmission( Admission_t* a, long fd );
+
+long leaveAdmission( Admission_t* a, int handover );
+
+void closeAdmission( Admission_t* a );
+
+void getStatsAdmission( Admission_t* a, unsigned long* n_queued, unsigned long* n_rejected );
+
+#endif /* ADMISSION_H_ */
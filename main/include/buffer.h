@@ -23,15 +23,24 @@
 */
 
 /**
- * @file queue.h
+ * @file buffer.h
  *
- * Definition of type Queue_t
+ * Definition of type Buffer_t
  *
- * A generic file has :
- * 		- a name (key) : a string representing the key of the file
- *		- a content (data) : the contents of the file
- *		- a size of content (size) : the size of the content
- *		- a pointer to another file (next) : to use to create a list of files
+ * A buffer is a bounded queue of pointers shared by several producers and
+ * several consumers, without locks (ring of Vyukov) :
+ * 		- a ring of cells (cell) : each one with its sequence number (seq),
+ *        which tells whether it is free for the producer of the turn 'pos'
+ *        (seq == pos) or full for the consumer of that turn (seq == pos + 1)
+ *		- the next turn of the producers (enq) and of the consumers (deq) :
+ *        each one on its own cache line, so producers and consumers do not
+ *        invalidate each other's line at every operation
+ *		- the sleep (block, bcond, n_wait) : used only by popBuffer when the
+ *        buffer is still empty after a few sched_yield, and by pushBuffer
+ *        only if a consumer is waiting (n_wait counts the consumers asleep
+ *        and not yet signalled)
+ *
+ * The elements are not copied: the buffer holds the pointers pushed.
  *
  * @author adrien koumgang tegantchouang
  * @version 1.0
@@ -44,34 +53,43 @@
 
 #include <pthread.h>
 
+// size of a cache line
+#define BUFFER_CACHE_LINE 64
+
 /**
-*
+* cell of the ring
 */
-typedef struct NodeB {
+typedef struct CellB {
+    unsigned long   seq;
     void*           data;
-    struct NodeB*    next;
-} NodeB_t;
+} CellB_t;
 
 /**
-*
+* bounded multi-producer multi-consumer queue
 */
 typedef struct Buffer {
-    NodeB_t*             head;
-    NodeB_t*             tail;
-    unsigned long       blen;
+    unsigned long       enq;
+    char                pad_enq[BUFFER_CACHE_LINE - sizeof(unsigned long)];
+    unsigned long       deq;
+    char                pad_deq[BUFFER_CACHE_LINE - sizeof(unsigned long)];
+    CellB_t*            cell;
+    unsigned long       mask;
+    unsigned long       n_wait;
     pthread_mutex_t     block;
     pthread_cond_t      bcond;
 } Buffer_t;
 
 
-Buffer_t* initBuffer( void );
+Buffer_t* initBuffer( unsigned long size );
 
 void deleteBuffer( Buffer_t* q );
 
-int pushBuffer( Buffer_t* q, void* data, size_t );
+int pushBuffer( Buffer_t* q, void* data );
 
 void* popBuffer( Buffer_t* q );
 
+void* tryPopBuffer( Buffer_t* q );
+
 unsigned long lengthBuffer( Buffer_t* q );
 
 #endif /* BUFFER_H_ */
@@ -36,6 +36,8 @@
 #ifndef COMMUNICATION_H
 #define COMMUNICATION_H
 
+#include <sys/uio.h>
+
 
 // flags that specify the operation requested by the client
 #define CC      "CC"
@@ -60,6 +62,12 @@
 #define _UF_O       (7)
 #define _CF_O       (8)
 #define _RFI_O      (9)
+#define _RFM_O      (10)    // 'read file' with the contents in a descriptor
+#define _RNFM_O     (11)    // 'read n file' with the contents in descriptors
+#define _SHM_O      (12)    // sets up the shared-memory rings of the connection
+
+// flag of the operation: the data of the request are in the request ring
+#define _SHM_F      (0x100)
 
 // how to open files
 #define O_NORMAL            (0)
@@ -71,6 +79,14 @@
 #define SUCCESS_O (0)
 #define FAILED_O (-1)
 
+// how the contents of a file follow a mapped read
+#define DATA_IN_LINE    (0)     // the bytes follow in the socket
+#define DATA_IN_FD      (1)     // a sealed memfd is attached (SCM_RIGHTS)
+#define DATA_IN_SHM     (2)     // the bytes are in the response ring
+
+// maximum number of buffers written with a single writev
+#define WRITEV_MAX (64)
+
 
 
 /***  utility functions for communication functions between client servers  ***/
@@ -119,6 +135,36 @@ static inline int writen(long fd, void *buf, size_t size) {
     return 1;
 }
 
+/** Evita scritture parziali di piu' buffer, scritti con writev
+ *  (l'array iov viene modificato)
+ *
+ *   \retval -1   errore (errno settato)
+ *   \retval  0   se durante la scrittura la writev ritorna 0
+ *   \retval  1   se la scrittura termina con successo
+ */
+static inline int writevn(long fd, struct iovec *iov, int cnt) {
+    ssize_t r;
+    while(cnt>0) {
+	if (iov->iov_len == 0) { iov++; cnt--; continue; }
+	if ((r=writev((int)fd, iov, (cnt < WRITEV_MAX) ? cnt : WRITEV_MAX)) == -1) {
+	    if (errno == EINTR) continue;
+	    return -1;
+	}
+	if (r == 0) return 0;
+	// skips the buffers written completely
+	while(cnt>0 && (size_t) r >= iov->iov_len) {
+	    r -= iov->iov_len;
+	    iov++;
+	    cnt--;
+	}
+	if (r > 0) {
+	    iov->iov_base = (char *) iov->iov_base + r;
+	    iov->iov_len -= r;
+	}
+    }
+    return 1;
+}
+
 static inline int read_pathname(int fd, char** pathname, size_t* sz_p){
     if(readn(fd, (void *) sz_p, sizeof(size_t)) == -1){
         return -1;
@@ -133,22 +179,27 @@ static inline int read_pathname(int fd, char** pathname, size_t* sz_p){
 }
 
 static inline int write_pathname(int fd, const char* pathname, size_t sz_p){
-    if((writen(fd, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd, (void *) pathname, sz_p)) == -1){
+    struct iovec iov[2] = { { (void *) &sz_p, sizeof(size_t) }, { (void *) pathname, sz_p } };
+    if((writevn(fd, iov, 2)) == -1){
         return -1;
     }
     return 0;
 }
 
+// the reason is always a terminated string (NULL on failure): the
+// connection may close in the middle of it
 static inline int read_reason( int fd, char** reason ){
     size_t sz_r  = 0;
-    if((readn(fd, &sz_r, sizeof(size_t))) == -1){
+    *reason = NULL;
+    if((readn(fd, &sz_r, sizeof(size_t))) <= 0){
+        return -1;
+    }
+    if((*reason = (char *) calloc(sz_r + 1, sizeof(char))) == NULL){
         return -1;
     }
-    *reason = (char *) malloc(sz_r);
-    if((readn(fd, *reason, sz_r)) == -1){
+    if(sz_r > 0 && (readn(fd, *reason, sz_r)) <= 0){
+        free(*reason);
+        *reason = NULL;
         return -1;
     }
     return 0;
@@ -156,20 +207,16 @@ static inline int read_reason( int fd, char** reason ){
 
 static inline int write_reason( int fd, char* reason ){
     size_t sz_r = strlen(reason)+1;
-    if((writen(fd, (void *) &sz_r, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd, (void *) reason, sz_r)) == -1){
+    struct iovec iov[2] = { { (void *) &sz_r, sizeof(size_t) }, { (void *) reason, sz_r } };
+    if((writevn(fd, iov, 2)) == -1){
         return -1;
     }
     return 0;
 }
 
 static inline int write_data( int fd, void* data, size_t sz_d ){
-    if((writen(fd, (void *) &sz_d, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd, (void *) data, sz_d)) == -1){
+    struct iovec iov[2] = { { (void *) &sz_d, sizeof(size_t) }, { data, sz_d } };
+    if((writevn(fd, iov, 2)) == -1){
         return -1;
     }
     return 0;
@@ -187,18 +234,27 @@ static inline int read_data( int fd, void** data, size_t* size ){
 }
 
 static inline int write_file_eject( int fd, int n, char** pathname, size_t* size_p, void** data, size_t* size_d ){
-    if((writen(fd, &n, sizeof(int))) == -1){
+    int cnt = 1 + ((n > 0) ? 4*n : 0);
+    struct iovec* iov = (struct iovec *) malloc(cnt * sizeof(struct iovec));
+    if(iov == NULL){
         return -1;
     }
-    if(n > 0){
-        for(int i=0; i<n; i++){
-            if((write_pathname(fd, pathname[i], size_p[i])) == -1){
-                return -1;
-            }
-            if((write_data(fd, data[i], size_d[i])) == -1){
-                return -1;
-            }
-        }
+    iov[0].iov_base = (void *) &n;
+    iov[0].iov_len = sizeof(int);
+    for(int i=0; i<n; i++){
+        iov[1+4*i].iov_base = (void *) &size_p[i];
+        iov[1+4*i].iov_len = sizeof(size_t);
+        iov[2+4*i].iov_base = (void *) pathname[i];
+        iov[2+4*i].iov_len = size_p[i];
+        iov[3+4*i].iov_base = (void *) &size_d[i];
+        iov[3+4*i].iov_len = sizeof(size_t);
+        iov[4+4*i].iov_base = data[i];
+        iov[4+4*i].iov_len = size_d[i];
+    }
+    int err = writevn(fd, iov, cnt);
+    free(iov);
+    if(err == -1){
+        return -1;
     }
     return 0;
 }
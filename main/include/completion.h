@@ -0,0 +1,82 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/**
+ * @file completion.h
+ *
+ * Definition of type Completion_t
+ *
+ * A completion queue is used by the workers to give back to the master
+ * the clients whose request has been served :
+ * 		- a list of records (head) : lock-free stack on which any worker can push
+ *		- a wake-up channel (cfd) : eventfd signalled only when the queue
+ *                                  passes from empty to non-empty, so that a
+ *                                  single wake-up of the master covers the
+ *                                  whole batch of records pushed in the meantime
+ *
+ * The records are not allocated by the queue: whoever pushes a record owns it
+ * until the master takes it back with popAllCompletion.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef COMPLETION_H_
+#define COMPLETION_H_
+
+/**
+* record of a served request
+*
+* fd : file descriptor of the client
+* toClose : 1 if the connection with the client must be closed
+* next : pointer to the next record
+*/
+typedef struct NodeC {
+    long            fd;
+    int             toClose;
+    struct NodeC*   next;
+} NodeC_t;
+
+/**
+* multi-producer (workers) single-consumer (master) queue
+*/
+typedef struct Completion {
+    NodeC_t*    head;
+    int         cfd;
+} Completion_t;
+
+
+Completion_t* initCompletion( void );
+
+void deleteCompletion( Completion_t* q );
+
+int getFdCompletion( Completion_t* q );
+
+int pushCompletion( Completion_t* q, NodeC_t* node );
+
+NodeC_t* popAllCompletion( Completion_t* q );
+
+#endif /* COMPLETION_H_ */
@@ -0,0 +1,262 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/**
+ * @file connection.h
+ *
+ * Definition of type conn_t
+ *
+ * A connection keeps the state of a client between two wake-ups of the master,
+ * so that the sockets can be used in non-blocking mode :
+ * 		- the request being received (req) with the stage reached by the
+ *        reception (stage) and the bytes already received of the current field (got)
+ *		- the requests received and not yet served (queue_*), in arrival order
+ *		- the request being served by a worker (cur) and its reply (out)
+ *		- a receive buffer (rx) : bytes read from the socket and not yet parsed
+ *		- the replies already served and not yet sent (tx), from the
+ *        segment tx_seg and its byte tx_off
+ *		- a completion record (done) : used by the worker to give the
+ *        connection back to the reactor that owns it, through its queue (completion)
+ *		- the shared-memory rings (shm) : if the client asked for them, the
+ *        data of its requests and the contents of the files it reads
+ *		- a flow (sched) : the place of the connection in the scheduler of
+ *        the reactor, while its next request waits for a worker
+ *		- a timer (timer) : the deadline of the connection in the timer wheel
+ *        of the reactor, for the kind of wait it is in (t_kind)
+ *
+ * The master receives a request until it is complete, only then it is passed
+ * to a worker, which writes the reply in 'out': the workers never use the
+ * socket and a slow client cannot keep a worker busy.
+ *
+ * A client can send many requests without waiting for the replies: the master
+ * keeps receiving them while a worker serves the previous one, but only one
+ * worker at a time serves a connection, so the requests are executed and the
+ * replies are sent in order. The worker only uses 'cur' and 'out', everything
+ * else belongs to the reactor, so no lock is needed.
+ *
+ * A reply is a list of segments sent with a single writev/sendmsg: the
+ * small fields (result, sizes, reasons) are copied in the header buffer
+ * of the reply, the contents of the files are referenced where the worker
+ * left them and released only after being sent. A segment can carry a
+ * descriptor (SCM_RIGHTS): it is sent with the first byte of the segment,
+ * which always starts a new message.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef CONNECTION_H_
+#define CONNECTION_H_
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "completion.h"
+#include "drr.h"
+#include "wheel.h"
+#include "shmring.h"
+
+// stages of the reception of a request
+#define CONN_STAGE_OP       (0)
+#define CONN_STAGE_ARG      (1)
+#define CONN_STAGE_SZ_P     (2)
+#define CONN_STAGE_PATH     (3)
+#define CONN_STAGE_SZ_D     (4)
+#define CONN_STAGE_DATA     (5)
+#define CONN_STAGE_DONE     (6)
+#define CONN_STAGE_ERROR    (-1)
+
+// size of the receive buffer of a connection
+#define CONN_RX_SIZE (8 * 1024)
+
+// header buffers larger than this are released after being sent
+#define CONN_TX_KEEP (64 * 1024)
+
+// payloads shorter than this are copied in the header buffer of the reply
+#define CONN_COPY_MAX (1024)
+
+// maximum number of segments sent with a single system call
+#define CONN_IOV_MAX (64)
+
+// maximum length of a pathname sent by a client
+#define CONN_MAX_PATHNAME (4 * 1024)
+
+// requests of a connection received and not yet served: beyond this
+// the master stops reading from the client until a worker catches up
+#define CONN_PIPELINE_DEPTH (64)
+
+/**
+* request of a client
+*
+* op : operation requested
+* arg : integer argument of the operation (flags of 'openFile', N of 'readNFile')
+* pathname : pathname of the file (if any)
+* data : contents sent by the client (if any)
+* in_shm : 1 if the contents are in the request ring instead of the socket
+* next : next request of the same connection
+*/
+typedef struct _request_t {
+    int                 op;
+    int                 arg;
+    char*               pathname;
+    size_t              sz_p;
+    void*               data;
+    size_t              sz_d;
+    int                 in_shm;
+    struct _request_t*  next;
+} request_t;
+
+/**
+* segment of a reply
+*
+* base : the referenced bytes, NULL if they are in the header buffer from 'off'
+* len : number of bytes
+* fd : descriptor passed to the client with the segment, -1 if none
+* release : if not NULL, called on 'owner' once the segment has been sent
+*/
+typedef struct _conn_seg_t {
+    const char*         base;
+    size_t              off;
+    size_t              len;
+    int                 fd;
+    void                (*release)( void* );
+    void*               owner;
+} conn_seg_t;
+
+/**
+* replies of a connection: the header buffer and the list of segments
+*/
+typedef struct _conn_reply_t {
+    char*               hdr;
+    size_t              hdr_len;
+    size_t              hdr_cap;
+    conn_seg_t*         seg;
+    int                 n_seg;
+    int                 seg_cap;
+} conn_reply_t;
+
+/**
+* state of a connection with a client
+*/
+typedef struct _conn_t {
+    long                fd;
+    int                 stage;
+    size_t              got;
+    char                field[sizeof(size_t)];
+    request_t           req;
+    request_t*          queue_head;
+    request_t*          queue_tail;
+    int                 queue_len;
+    request_t*          cur;
+    conn_reply_t        out;
+    char                rx[CONN_RX_SIZE];
+    size_t              rx_off;
+    size_t              rx_len;
+    conn_reply_t        tx;
+    int                 tx_seg;
+    size_t              tx_off;
+    struct iovec        tx_iov[CONN_IOV_MAX];
+    struct msghdr       tx_msg;
+    union {
+        char            buf[CMSG_SPACE(sizeof(int))];
+        size_t          align;      // alignment of a cmsghdr
+    }                   tx_ctl;
+    int                 busy;
+    long                worker;     // last worker that served the connection, -1 if none
+    int                 closing;
+    int                 broken;
+    int                 recv_pending;
+    int                 send_pending;
+    ShmRing_t*          shm;
+    Completion_t*       completion;
+    NodeC_t             done;
+    NodeD_t             sched;
+    NodeW_t             timer;
+    int                 t_kind;
+    size_t              t_got;      // bytes of the data received when the timer was set
+    struct _conn_t*     prev;
+    struct _conn_t*     next;
+} conn_t;
+
+
+conn_t* conn_create( long, Completion_t* );
+
+void conn_free( conn_t* );
+
+conn_t* conn_from_completion( NodeC_t* );
+
+conn_t* conn_from_drr( NodeD_t* );
+
+conn_t* conn_from_wheel( NodeW_t* );
+
+int conn_parse_input( conn_t* );
+
+void conn_recv_buffer( conn_t*, char**, size_t* );
+
+void conn_received( conn_t*, size_t );
+
+int conn_recv( conn_t* );
+
+int conn_has_input( conn_t* );
+
+int conn_push_request( conn_t* );
+
+request_t* conn_next_request( conn_t* );
+
+void conn_end_request( conn_t* );
+
+int conn_has_reply( conn_t* );
+
+void conn_flush_reply( conn_t* );
+
+int conn_sent( conn_t*, size_t );
+
+int conn_send( conn_t* );
+
+struct msghdr* conn_send_msg( conn_t* );
+
+int conn_has_output( conn_t* );
+
+int conn_writen( conn_t*, const void*, size_t );
+
+int conn_write_pathname( conn_t*, const char*, size_t );
+
+int conn_write_reason( conn_t*, const char* );
+
+int conn_write_ref( conn_t*, const void*, size_t, void (*)( void* ), void* );
+
+int conn_write_data( conn_t*, const void*, size_t );
+
+int conn_write_data_ref( conn_t*, const void*, size_t, void (*)( void* ), void* );
+
+int conn_write_data_fd( conn_t*, const void*, size_t, int, void (*)( void* ), void* );
+
+int conn_write_data_shm( conn_t*, const void*, size_t, void (*)( void* ), void* );
+
+int conn_write_file_eject( conn_t*, int, char**, size_t*, void**, size_t*, void (*)( void* ), void** );
+
+#endif /* CONNECTION_H_ */
@@ -0,0 +1,72 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file counter.h
+ *
+ * Definition of type Counter_t
+ *
+ * A counter split in shards, one per thread, for the statistics that all the
+ * threads update :
+ * 		- the shards (shard) : each one on its own cache line, a thread
+ *        always adds on the same shard, so two threads never write on the
+ *        same line (as long as there are no more threads than shards)
+ *		- the value : the sum of the shards, computed only by who reads it
+ *
+ * An update is a single atomic add without contention, the reading costs
+ * one load per shard: the counters suit values updated often and read
+ * rarely. No update is lost: once the threads have stopped, the sum is exact.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef COUNTER_H_
+#define COUNTER_H_
+
+#define COUNTER_LINE (64)
+
+typedef struct CellN {
+    long            v;
+    char            pad[COUNTER_LINE - sizeof(long)];
+} CellN_t;
+
+typedef struct Counter {
+    CellN_t*        shard;
+    unsigned long   n;
+} Counter_t;
+
+
+Counter_t* initCounter( unsigned long n );
+
+void deleteCounter( Counter_t* c );
+
+void addCounter( Counter_t* c, long delta );
+
+long readCounter( Counter_t* c );
+
+#endif /* COUNTER_H_ */
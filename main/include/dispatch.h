@@ -0,0 +1,81 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file dispatch.h
+ *
+ * Definition of type Dispatch_t
+ *
+ * The dispatcher distributes the work to a fixed set of workers :
+ * 		- a run queue for each worker (local) : the reactors push an element
+ *        on the queue of the worker that served it last, if any, so that its
+ *        data are still in the caches of that CPU, otherwise in round-robin
+ *		- the stealing : a worker whose queue is empty takes the oldest
+ *        element from the queue of another worker before going to sleep
+ *		- the sleep (lock, cond, sleeping) : taken only by the idle workers
+ *        and, when some worker is idle (n_idle), by who pushes an element
+ *
+ * The workers no longer contend on a single lock for every element: each
+ * queue is shared only by the reactors that push on it and by the thieves.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef DISPATCH_H_
+#define DISPATCH_H_
+
+#include <pthread.h>
+
+#include "buffer.h"
+
+typedef struct Dispatch {
+    unsigned long   n;
+    Buffer_t**      local;
+    unsigned long   rr;
+    unsigned long   n_idle;
+    int*            sleeping;
+    int             stop;
+    pthread_mutex_t lock;
+    pthread_cond_t* cond;
+    unsigned long*  n_stolen;
+} Dispatch_t;
+
+
+Dispatch_t* initDispatch( unsigned long n, unsigned long size );
+
+void deleteDispatch( Dispatch_t* d );
+
+int pushDispatch( Dispatch_t* d, void* data, long worker );
+
+void* popDispatch( Dispatch_t* d, unsigned long worker );
+
+void stopDispatch( Dispatch_t* d );
+
+unsigned long getStolenDispatch( Dispatch_t* d );
+
+#endif /* DISPATCH_H_ */
@@ -0,0 +1,103 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file drr.h
+ *
+ * Definition of type Drr_t
+ *
+ * Deficit round-robin scheduler of a reactor, between its connections and
+ * the workers :
+ * 		- the active flows (head, tail) : connections with a request ready,
+ *        each one with the cost of that request (cost, in bytes) and the
+ *        credit accumulated while waiting (deficit)
+ *		- the quantum : credit that a flow receives at each round
+ *		- the requests in the hands of the workers (in_flight), at most
+ *        max_flight : the others wait here, where the order is decided,
+ *        and not in the run queues of the workers, which are FIFO
+ *
+ * A client that sends large requests waits some rounds before being
+ * served, while the clients with small requests are served at every
+ * round: a bulk upload no longer delays the interactive clients.
+ *
+ * The nodes are part of the connections, the scheduler is used only
+ * by the reactor that owns them, so no lock is needed.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef DRR_H_
+#define DRR_H_
+
+#include <stddef.h>
+
+// credit given to a flow at each round
+#define DRR_QUANTUM (16 * 1024)
+
+// cost of a request besides its pathname and its data
+#define DRR_REQUEST_COST (64)
+
+/**
+* flow of a connection
+*
+* cost : cost of the request waiting to be served
+* deficit : credit not yet used
+* active : 1 if the flow is in the list of the scheduler
+*/
+typedef struct NodeD {
+    size_t          cost;
+    size_t          deficit;
+    int             active;
+    struct NodeD*   prev;
+    struct NodeD*   next;
+} NodeD_t;
+
+typedef struct Drr {
+    NodeD_t*        head;
+    NodeD_t*        tail;
+    size_t          quantum;
+    unsigned long   in_flight;
+    unsigned long   max_flight;
+} Drr_t;
+
+
+Drr_t* initDrr( size_t quantum, unsigned long max_flight );
+
+void deleteDrr( Drr_t* d );
+
+void pushDrr( Drr_t* d, NodeD_t* node, size_t cost );
+
+NodeD_t* popDrr( Drr_t* d );
+
+void removeDrr( Drr_t* d, NodeD_t* node );
+
+void doneDrr( Drr_t* d );
+
+void idleDrr( NodeD_t* node );
+
+#endif /* DRR_H_ */
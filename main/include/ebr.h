@@ -0,0 +1,111 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file ebr.h
+ *
+ * Definition of type Ebr_t
+ *
+ * Epoch-based reclamation: the objects removed from a structure read
+ * without locks are released only when no thread can still be reading them :
+ * 		- the global epoch (epoch) : advanced by one when all the threads
+ *        inside a read section have seen its current value
+ *		- a record per thread (EbrThread_t) : the epoch seen by the thread when
+ *        it entered its read section (0 outside), the depth of the nested
+ *        sections and the objects it retired, newest first
+ *		- the objects of the threads that have exited (orphans)
+ *
+ * An object retired in the epoch e has already been removed from the
+ * structure: the threads that can still reach it entered their section
+ * before e+1, so it is released once the global epoch reaches e+2.
+ *
+ * Entering and leaving a section write only the record of the thread, on
+ * its own cache line: the readers never write on shared lines. The objects
+ * are retired through a node they contain (NodeE_t), as the timers of the
+ * wheel, so retiring never allocates memory.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef EBR_H_
+#define EBR_H_
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define EBR_LINE (64)
+
+// objects retired by a thread between two attempts to advance the epoch
+#define EBR_RETIRE_SCAN (32)
+
+/**
+* node of a retired object
+*
+* epoch : global epoch when the object was retired
+* release : releases the object that contains the node
+*/
+typedef struct NodeE {
+    uint64_t        epoch;
+    void            (*release)( struct NodeE* );
+    struct NodeE*   next;
+} NodeE_t;
+
+struct Ebr;
+
+typedef struct EbrThread {
+    uint64_t            epoch;      // (epoch << 1) | 1 inside a read section, 0 outside
+    int                 nest;
+    int                 used;       // 1 while a thread owns the record
+    NodeE_t*            retired;
+    unsigned long       n_retired;  // objects retired since the last attempt to release them
+    struct Ebr*         domain;
+    struct EbrThread*   next;
+} __attribute__((aligned(EBR_LINE))) EbrThread_t;
+
+typedef struct Ebr {
+    uint64_t        epoch;
+    EbrThread_t*    threads;
+    pthread_key_t   key;
+    pthread_mutex_t lock;
+    NodeE_t*        orphans;
+} Ebr_t;
+
+
+Ebr_t* initEbr( void );
+
+void deleteEbr( Ebr_t* e );
+
+void enterEbr( Ebr_t* e );
+
+void exitEbr( Ebr_t* e );
+
+void retireEbr( Ebr_t* e, NodeE_t* node, void (*release)( NodeE_t* ) );
+
+void reclaimEbr( Ebr_t* e );
+
+#endif /* EBR_H_ */
@@ -49,6 +49,12 @@ int readFile( const char* pathname, void** buf, size_t* size );
 
 int readNFile( int N, const char* dirname );
 
+int readFileMapped( const char* pathname, void** buf, size_t* size );
+
+int releaseFileMapped( void* buf, size_t size );
+
+int readNFileMapped( int N, const char* dirname );
+
 int writeFile( const char* pathname, const char* dirname );
 
 int appendToFile( const char* pathname, void* buf, size_t size, const char* dirname );
@@ -61,4 +67,44 @@ int closeFile( const char* pathname );
 
 int removeFile( const char* pathname );
 
+int beginPipeline( int window );
+
+int endPipeline( void );
+
+/*
+* the same operations on an explicit connection: a process can open many
+* of them and use each one from its own thread
+*/
+typedef struct _fss_conn fss_conn;
+
+fss_conn* fss_openConnection( const char* sockname, int msec, const struct timespec abstime );
+
+int fss_closeConnection( fss_conn* c );
+
+int fss_openFile( fss_conn* c, const char* pathname, int flags );
+
+int fss_readFile( fss_conn* c, const char* pathname, void** buf, size_t* size );
+
+int fss_readNFile( fss_conn* c, int N, const char* dirname );
+
+int fss_readFileMapped( fss_conn* c, const char* pathname, void** buf, size_t* size );
+
+int fss_readNFileMapped( fss_conn* c, int N, const char* dirname );
+
+int fss_writeFile( fss_conn* c, const char* pathname, const char* dirname );
+
+int fss_appendToFile( fss_conn* c, const char* pathname, void* buf, size_t size, const char* dirname );
+
+int fss_lockFile( fss_conn* c, const char* pathname );
+
+int fss_unlockFile( fss_conn* c, const char* pathname );
+
+int fss_closeFile( fss_conn* c, const char* pathname );
+
+int fss_removeFile( fss_conn* c, const char* pathname );
+
+int fss_beginPipeline( fss_conn* c, int window );
+
+int fss_endPipeline( fss_conn* c );
+
 #endif
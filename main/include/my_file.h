@@ -31,8 +31,25 @@
  * 		- a name (key) : a string representing the key of the file
  *		- a content (data) : the contents of the file
  *		- a size of content (size) : the size of the content
+ *		- the buffer holding the content (buf)
  *		- a pointer to another file (next) : to use to create a list of files
  *
+ * The contents are held in an immutable buffer with a reference count:
+ * a reader pins the buffer and sends it without copying, while a write or
+ * an append publishes a new buffer in the file. The old buffer is released
+ * by its last holder.
+ *
+ * The contents are kept in the heap. A local client that asks for a
+ * mapped read receives a sealed memfd with a copy of them (fbuf_memfd),
+ * which it maps instead of receiving the bytes through the socket: the
+ * memfd is created at the first such read of the buffer and closed with
+ * it, so the files never read in this way hold no descriptor.
+ *
+ * The descriptors of the clients that opened the file (openers) are kept
+ * sorted inside the file while they are at most FILE_OPENERS_INLINE, in
+ * an array that doubles beyond: a file opened by a single client costs
+ * no allocation, and any descriptor number can be recorded.
+ *
  * @author adrien koumgang tegantchouang
  * @version 1.0
  * @date 00/05/2021
@@ -41,32 +58,90 @@
  #if !defined(FILE_T)
  #define FILE_T
 
+#include <stdint.h>
 #include <pthread.h>
-#include <sys/select.h>
+
+#include "ebr.h"
+
+// contents of at least this size are passed in a memfd to a mapped read
+#define FBUF_MEMFD_MIN (64 * 1024)
+
+/**
+* immutable contents of a file
+*
+* refs : number of holders (the file and the readers that pinned it)
+* size : number of bytes
+* memfd : sealed memfd with a copy of the bytes, -1 until a mapped read
+* data : the bytes, never modified after the creation
+*/
+typedef struct _fbuf_t {
+    long                    refs;
+    size_t                  size;
+    int                     memfd;
+    char*                   data;
+} fbuf_t;
+
+// openers kept inside the file before moving to an array
+#define FILE_OPENERS_INLINE (4)
+
+/**
+* descriptors of the clients that opened a file, in ascending order
+*
+* n : number of descriptors
+* cap : slots of the array u.v, 0 while the descriptors are in u.fd
+*/
+typedef struct _openers_t {
+    int                     n;
+    int                     cap;
+    union {
+        int                 fd[FILE_OPENERS_INLINE];
+        int*                v;
+    }                       u;
+} openers_t;
 
 /**
 * format of a generic file
 *
 * key : the unique identification key of a file (also its pathname)
-* data : string containing the contents of the file
+* hash : hash value of the key, computed once when the file is inserted
+* data : string containing the contents of the file (buf->data, read-only)
 * size : the size of the file
+* buf : the buffer of the contents (NULL if the file is empty)
+* openers : descriptors of the clients that opened the file
+* log : descriptor of the client that holds the lock, -1 if none
 * next : pointer to a possible file
+* retire : node used to release the file once no thread can still be reading it
 */
  typedef struct _file_t { // TODO: da completare sugli altri file
  	char*                   key;
     size_t                  size_key;
+    uint64_t                hash;
  	void*                   data;
     size_t                  size_data;
-    fd_set                  set;
+    fbuf_t*                 buf;
+    openers_t               openers;
     int                     log;
     pthread_mutex_t         flock;
     pthread_cond_t          fcond;
  	struct _file_t*         next;
+    NodeE_t                 retire;
  } file_t;
 
 
- // simple hash function
- unsigned int hash_function_for_file_t(char*);
+ // create an immutable buffer with a copy of the data
+fbuf_t* fbuf_create( const void*, size_t );
+
+// take a reference to a buffer
+fbuf_t* fbuf_pin( fbuf_t* );
+
+// leave a reference to a buffer (void* to be used as a release function)
+void fbuf_release( void* );
+
+// sealed memfd with the contents, for a mapped read (-1 if none)
+int fbuf_memfd( fbuf_t* );
+
+ // 64-bit hash of a pathname
+ uint64_t hash_function_for_file_t(char*);
 
  // compare function
  int hash_key_compare_for_file_t(char*, char*);
@@ -95,6 +170,9 @@ int file_has_lock( file_t*, int );
 // read the contents of a file
 int file_read_content( file_t *, void**, size_t* );
 
+// take a reference to the contents of a file, without copying them
+int file_pin_content( file_t*, fbuf_t** );
+
 int file_read( file_t*, char**, size_t*, void**, size_t* );
 
 // write the contents of a file
@@ -105,13 +183,13 @@ int file_append_content( file_t*, void*, size_t );
 //
 file_t* file_copy( file_t* );
 
-//
-void file_add_fd( file_t*, int );
+// records a client that opened the file
+int file_add_fd( file_t*, int );
 
-//
+// forgets a client that opened the file
 void file_remove_fd( file_t*, int );
 
-//
+// 1 if the client opened the file, 0 otherwise
 int file_has_fd( file_t*, int );
 
 #endif
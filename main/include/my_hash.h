@@ -33,6 +33,37 @@
  *		- a size of content (size) : the size of the content
  *		- a pointer to another file (next) : to use to create a list of files
  *
+ * The table grows online: when the items exceed HASH_LOAD_FACTOR per
+ * bucket, a table twice as large is installed and the buckets of the old
+ * one (old_table) are moved a few at a time by the operations that follow
+ * (HASH_MIGRATE_STEP each), so no operation pays for the whole copy. An
+ * operation first moves the old bucket of its key, then works only on the
+ * new table. The tables are swapped under the write lock (tlock), every
+ * other operation that changes the table holds it in read mode and locks
+ * only its bucket.
+ *
+ * The buckets share a fixed number of locks (stripe, chosen with
+ * hash_create_striped): the bucket i uses the stripe i modulo their
+ * number, so the table can grow to millions of buckets with the same
+ * locks. The items are counted on a sharded counter (count, see
+ * counter.h): an insert or a remove adds on the shard of its thread
+ * without any lock shared by the whole table.
+ *
+ * The lookups take no lock: they read the tables published in 'tab' and
+ * follow the lists while the writers change them. A bucket being moved
+ * to the new table has an odd 'seq': a lookup that did not find its key
+ * while the bucket changed looks again. The items removed and the old
+ * tables are released through the epochs of the table (ebr): an item
+ * found between hash_read_begin and hash_read_end stays valid until
+ * hash_read_end, even if another thread removes it, and who removes an
+ * item gives it back with hash_release_item instead of freeing it.
+ *
+ * A table created with hash_create_swiss keeps the files in an
+ * open-addressing index instead (index, see swiss.h): the lookups hold
+ * tlock in read mode, the operations that add or remove a file hold it in
+ * write mode, and the index grows in one go when it is full. Its items are
+ * released through the epochs as well.
+ *
  * @author adrien koumgang tegantchouang
  * @version 1.0
  * @date 00/05/2021
@@ -43,39 +74,99 @@
  #define HASH_T
 
 #include "my_file.h"
+#include "swiss.h"
+#include "ebr.h"
+#include "counter.h"
 
  // definition of element to be inserted in the hash table
  typedef struct _file_t data_hash_t;
 
+// items per bucket beyond which the table doubles
+#define HASH_LOAD_FACTOR (2)
+
+// buckets of the old table moved by each operation during a resize
+#define HASH_MIGRATE_STEP (2)
+
+// locks of the buckets of a table created with hash_create
+#define HASH_LOCK_STRIPES (256)
+
+// shards of the count of the items (threads that change the table)
+#define HASH_COUNT_SHARDS (32)
+
+#define HASH_LINE (64)
+
+/* a lock of the buckets, on its own cache line */
+typedef struct _hash_stripe {
+    pthread_mutex_t lock;
+} __attribute__((aligned(HASH_LINE))) hash_stripe;
+
 typedef struct _node_h{
     long n;
-    pthread_mutex_t nhlock;
-    pthread_cond_t nhcond;
+    int moved;      // bucket of the old table already moved to the new one
+    unsigned int seq;   // odd while the bucket is being moved
+    pthread_mutex_t* nhlock;    // stripe of the bucket
     data_hash_t* list;
 } node_h;
 
+/* tables seen by the lookups: replaced at each step of a resize, never changed */
+typedef struct _hash_tab {
+    int size;
+    node_h **table;
+    int old_size;
+    node_h **old_table;
+    NodeE_t retire;
+} hash_tab;
+
  /* the structure of hash table */
  typedef struct _hash_t {
  	int size;
- 	int number_of_item;
+    Counter_t *count;       // items in the table
  	node_h **table;
-    pthread_mutex_t hlock;
-    pthread_cond_t hcond;
- 	unsigned int (*hash_function)(char *);
+    hash_stripe *stripe;    // locks of the buckets
+    int n_stripes;          // power of two
+    int old_size;
+    node_h **old_table;     // table being emptied, NULL if no resize is running
+    int migrate_next;       // next bucket of the old table to move
+    int migrated;           // buckets of the old table already moved
+    int resizing;           // 1 from the start of a resize to its end
+    Swiss_t *index;         // open-addressing index of the files, NULL for the chained table
+    hash_tab *tab;          // tables published for the lookups
+    hash_tab *tab_end;      // tables once the running resize is over
+    Ebr_t *ebr;             // epochs of the readers, for the items and tables removed
+    pthread_rwlock_t tlock;
+ 	uint64_t (*hash_function)(char *);
  	int (*hash_key_compare)(char *, char *);
  } hash_t;
 
  /* Create a new hash table */
-hash_t* hash_create( const int, unsigned int (*hash_function)(char *),
+hash_t* hash_create( const int, uint64_t (*hash_function)(char *),
+                        int (*hash_key_compare)(char *, char *) );
+
+hash_t* hash_create_striped( const int, const int, uint64_t (*hash_function)(char *),
                         int (*hash_key_compare)(char *, char *) );
 
-data_hash_t* hash_find( const hash_t*, char* );
+hash_t* hash_create_swiss( const int, uint64_t (*hash_function)(char *),
+                        int (*hash_key_compare)(char *, char *) );
+
+data_hash_t* hash_find( hash_t*, char* );
 
 data_hash_t* hash_insert( hash_t*, char*, size_t, void*, size_t, int );
 
+/*
+* the same operations with the hash value of the key already computed
+* (hash_function), to compute it once for all the operations of a request
+*/
+data_hash_t* hash_find_h( hash_t*, char*, uint64_t );
+
+data_hash_t* hash_insert_h( hash_t*, char*, uint64_t, size_t, void*, size_t, int );
+
+data_hash_t* hash_update_insert_append_h( hash_t*, char*, uint64_t, size_t, void*, size_t, int );
+
+data_hash_t* hash_remove_h( hash_t*, char*, uint64_t );
+
 data_hash_t* hash_update_insert( hash_t*, char*, size_t, void*, size_t, int );
 
-data_hash_t* hash_update_insert_append( const hash_t*, char*, size_t, void*, size_t, int );
+data_hash_t* hash_update_insert_append( hash_t*, char*, size_t, void*, size_t, int );
 
 int hash_size( hash_t* );
 
@@ -85,8 +176,18 @@ data_hash_t* hash_remove( hash_t*, char* );
 
 data_hash_t* get_copy_file_hash( hash_t* , int* , int* );
 
+data_hash_t* hash_next_item( hash_t*, long*, data_hash_t* );
+
 int hash_delete( hash_t*, char* );
 
+void hash_finish_resize( hash_t* );
+
+void hash_read_begin( hash_t* );
+
+void hash_read_end( hash_t* );
+
+void hash_release_item( hash_t*, data_hash_t* );
+
 int hash_destroy( hash_t* );
 
  #endif
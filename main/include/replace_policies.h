@@ -65,6 +65,8 @@ int push_qp( Queue_p*, char*, size_t );
 
 char* pop_qp( Queue_p* );
 
+char* try_pop_qp( Queue_p* );
+
 char* get_put_last_qp( Queue_p* );
 
 Node_p* findNodeP( Queue_p*, char* );
@@ -0,0 +1,105 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file restart.h
+ *
+ * Hot restart of the server
+ *
+ * A server started with a CONTROL_SOCKET listens on it for its successor.
+ * When a new server connects, the old one drains its clients (as with SIGHUP)
+ * and, once its workers have finished, passes to the new one with SCM_RIGHTS :
+ * 		- the listening socket : the clients that connect in the meantime
+ *        wait in its backlog instead of being refused
+ *		- a sealed memfd with all the files (arena) : a header, the index
+ *        of the files (restart_entry_t) in the order of the replacement
+ *        queue and their names and contents
+ *
+ * The new server loads the files before accepting anyone, so it starts
+ * with the cache of the old one.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef RESTART_H_
+#define RESTART_H_
+
+#include <stddef.h>
+
+#include "my_hash.h"
+#include "replace_policies.h"
+
+// first bytes of an arena
+#define RESTART_MAGIC 0x31535346UL
+
+/**
+* header of the arena
+*
+* magic : RESTART_MAGIC
+* size : size of the arena
+* n_files : number of entries of the index, which follows the header
+*/
+typedef struct _restart_hdr_t {
+    unsigned long       magic;
+    size_t              size;
+    unsigned long       n_files;
+} restart_hdr_t;
+
+/**
+* entry of the index: offsets in the arena of the name and of the contents
+*/
+typedef struct _restart_entry_t {
+    size_t              key_off;
+    size_t              size_key;
+    size_t              data_off;
+    size_t              size_data;
+} restart_entry_t;
+
+/**
+* state received by the new server
+*
+* fd_listen : listening socket of the old server
+* hdr : the arena, mapped read-only (NULL if there are no files)
+* entry : the index of the files
+*/
+typedef struct _restart_t {
+    int                     fd_listen;
+    const restart_hdr_t*    hdr;
+    const restart_entry_t*  entry;
+} restart_t;
+
+
+int restart_listen( const char* );
+
+int restart_request( const char*, restart_t* );
+
+void restart_release( restart_t* );
+
+int restart_give( int, int, hash_t*, Queue_p* );
+
+#endif /* RESTART_H_ */
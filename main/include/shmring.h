@@ -0,0 +1,100 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file shmring.h
+ *
+ * Definition of type ShmRing_t
+ *
+ * Shared-memory rings of a connection between the server and a client on the
+ * same host, in a memfd created by the server and passed to the client :
+ * 		- the request ring (SHM_RING_REQUEST) : the client puts there the data
+ *        of its requests, the server takes them
+ *		- the response ring (SHM_RING_RESPONSE) : the server puts there the
+ *        contents of the files read, the client takes them
+ *		- for each ring, the bytes put (head) and the bytes taken (tail),
+ *        each one on its own cache line and written by one side only
+ *
+ * The socket still carries the requests and the replies, without the bytes
+ * that are in a ring: the bytes are taken in the same order in which they
+ * were put, so a header only needs their size. A payload that does not fit
+ * in the free space of a ring goes through the socket as usual.
+ *
+ * Each side keeps its own copy of the positions it writes: the values of the
+ * other side are only used to know how many bytes can be put or taken, so a
+ * wrong value can spoil the data but not the memory of who reads it.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef SHMRING_H_
+#define SHMRING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_RING_REQUEST    (0)
+#define SHM_RING_RESPONSE   (1)
+
+// payloads shorter than this always go through the socket
+#define SHM_RING_MIN (4 * 1024)
+
+// offset of the rings in the memfd (the positions are before)
+#define SHM_RING_DATA (4096)
+
+typedef struct ShmPos {
+    uint64_t        head;
+    char            pad_head[64 - sizeof(uint64_t)];
+    uint64_t        tail;
+    char            pad_tail[64 - sizeof(uint64_t)];
+} ShmPos_t;
+
+typedef struct ShmRing {
+    int             fd;
+    char*           base;
+    size_t          map_size;
+    size_t          size;           // bytes of each ring
+    ShmPos_t*       pos;            // positions shared with the other side
+    uint64_t        head[2];        // bytes put in each ring (by this side)
+    uint64_t        tail[2];        // bytes taken from each ring (by this side)
+} ShmRing_t;
+
+
+ShmRing_t* initShmRing( size_t size );
+
+ShmRing_t* mapShmRing( int fd );
+
+void deleteShmRing( ShmRing_t* r );
+
+int getFdShmRing( ShmRing_t* r );
+
+int putShmRing( ShmRing_t* r, int ring, const void* buf, size_t len );
+
+int takeShmRing( ShmRing_t* r, int ring, void* buf, size_t len );
+
+#endif /* SHMRING_H_ */
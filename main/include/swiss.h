@@ -0,0 +1,92 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file swiss.h
+ *
+ * Definition of type Swiss_t
+ *
+ * Open-addressing index of the files, in the style of SwissTable :
+ * 		- the control bytes (ctrl) : one per slot, in groups of SWISS_GROUP
+ *        contiguous bytes; a byte is SWISS_EMPTY, SWISS_DELETED or, if the
+ *        slot is full, the low 7 bits of the hash of its key (fingerprint)
+ *		- the slots (slot) : pointers to the files, which stay out of the
+ *        index (file_t)
+ *		- the number of slots (cap), a power of 2 multiple of SWISS_GROUP
+ *		- the files in the index (n) and the empty slots that can still
+ *        be used before the index is rebuilt (growth_left)
+ *
+ * A lookup starts from the group chosen by the high bits of the hash and
+ * compares the fingerprint with the 16 bytes of a group at once (SSE2): only
+ * the slots whose byte matches are followed to their file, so a lookup
+ * usually reads one line of control bytes and one file. The groups are
+ * visited in a triangular sequence, a group with an empty slot ends it.
+ *
+ * The index has no lock: it is used under the lock of the table that owns
+ * it (my_hash.h).
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef SWISS_H_
+#define SWISS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "my_file.h"
+
+// slots of a group of control bytes
+#define SWISS_GROUP   (16)
+
+// control bytes of the slots that are not full
+#define SWISS_EMPTY   ((uint8_t) 0x80)
+#define SWISS_DELETED ((uint8_t) 0xFE)
+
+typedef struct Swiss {
+    uint8_t*        ctrl;
+    file_t**        slot;
+    size_t          cap;
+    size_t          n;
+    size_t          growth_left;
+} Swiss_t;
+
+
+Swiss_t* initSwiss( size_t size );
+
+void deleteSwiss( Swiss_t* s );
+
+file_t* findSwiss( Swiss_t* s, char* key, uint64_t h, int (*compare)(char *, char *) );
+
+int insertSwiss( Swiss_t* s, file_t* f );
+
+file_t* removeSwiss( Swiss_t* s, char* key, uint64_t h, int (*compare)(char *, char *) );
+
+file_t* nextSwiss( Swiss_t* s, long* pos );
+
+#endif /* SWISS_H_ */
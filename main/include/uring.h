@@ -0,0 +1,102 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/**
+ * @file uring.h
+ *
+ * Definition of type Uring_t
+ *
+ * An io_uring instance used directly through its system calls :
+ * 		- a submission ring (sq_*) : the operations prepared by the program,
+ *                                   published to the kernel all together
+ *		- a completion ring (cq_*) : the results of the operations, read
+ *                                   without any system call
+ *		- the array of the submission entries (sqes)
+ *		- the number of operations whose result has not been consumed yet (inflight)
+ *
+ * With a single io_uring_enter the pending operations are submitted and
+ * the program waits for the next results: a batch of receives, sends and
+ * accepts costs one system call instead of one for each of them.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef URING_H_
+#define URING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+typedef struct Uring {
+    int                     ring_fd;
+    unsigned                sq_entries;
+    unsigned*               sq_head;
+    unsigned*               sq_tail;
+    unsigned*               sq_mask;
+    unsigned*               sq_array;
+    unsigned                sq_pending;
+    unsigned                inflight;
+    unsigned*               cq_head;
+    unsigned*               cq_tail;
+    unsigned*               cq_mask;
+    struct io_uring_sqe*    sqes;
+    struct io_uring_cqe*    cqes;
+    void*                   sq_ptr;
+    size_t                  sq_size;
+    void*                   cq_ptr;
+    size_t                  cq_size;
+    size_t                  sqes_size;
+} Uring_t;
+
+
+Uring_t* initUring( unsigned entries );
+
+void deleteUring( Uring_t* u );
+
+int submitUring( Uring_t* u, unsigned wait_nr );
+
+struct io_uring_cqe* peekCqeUring( Uring_t* u );
+
+void seenCqeUring( Uring_t* u );
+
+int recvUring( Uring_t* u, int fd, void* buf, size_t len, uint64_t data );
+
+int sendmsgUring( Uring_t* u, int fd, const struct msghdr* msg, uint64_t data );
+
+int acceptUring( Uring_t* u, int fd, uint64_t data );
+
+int readUring( Uring_t* u, int fd, void* buf, size_t len, uint64_t data );
+
+int pollUring( Uring_t* u, int fd, unsigned events, uint64_t data );
+
+int cancelUring( Uring_t* u, uint64_t target, uint64_t data );
+
+int cancelAllUring( Uring_t* u, uint64_t data );
+
+#endif /* URING_H_ */
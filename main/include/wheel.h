@@ -0,0 +1,92 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file wheel.h
+ *
+ * Definition of type Wheel_t
+ *
+ * Hierarchical timer wheel of a reactor, for the deadlines of its connections :
+ * 		- the levels (slot) : WHEEL_LEVELS wheels of WHEEL_SLOTS lists, a slot
+ *        of the level i covers WHEEL_SLOTS^i ticks; a timer goes to the first
+ *        level that reaches its expiration and moves down a level each time
+ *        the wheel above turns (cascade)
+ *		- the current tick (now) : the ticks up to 'now' have been processed
+ *		- the length of a tick (tick), in milliseconds
+ *
+ * Adding, moving and removing a timer cost O(1), whatever the number of
+ * connections: a deadline is moved at every byte received without scanning
+ * anything. The timers are part of the connections and the wheel is used
+ * only by the reactor that owns them, so no lock is needed.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+
+#ifndef WHEEL_H_
+#define WHEEL_H_
+
+#include <stdint.h>
+
+#define WHEEL_BITS   (6)
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_LEVELS (4)
+
+/**
+* timer
+*
+* expire : tick at which it expires
+* slot : list where it is, NULL if it is not in the wheel
+*/
+typedef struct NodeW {
+    uint64_t        expire;
+    struct NodeW**  slot;
+    struct NodeW*   prev;
+    struct NodeW*   next;
+} NodeW_t;
+
+typedef struct Wheel {
+    NodeW_t*        slot[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t        now;
+    unsigned long   tick;
+    unsigned long   n;
+} Wheel_t;
+
+
+Wheel_t* initWheel( unsigned long tick, uint64_t now );
+
+void deleteWheel( Wheel_t* w );
+
+void addWheel( Wheel_t* w, NodeW_t* node, uint64_t expire );
+
+void removeWheel( Wheel_t* w, NodeW_t* node );
+
+NodeW_t* advanceWheel( Wheel_t* w, uint64_t now );
+
+long nextWheel( Wheel_t* w, uint64_t now );
+
+#endif /* WHEEL_H_ */
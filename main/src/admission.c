@@ -0,0 +1,257 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file admission.c
+ *
+ * Implementation of the admission of the clients
+ *
+ * When all the places are taken the listening socket stays readable: if it
+ * were still watched, the reactors would be woken up continuously without
+ * being able to accept anyone. The admission stops watching it in that case
+ * and watches it again as soon as a client leaves, so the clients beyond the
+ * limit wait in the backlog of the socket at no cost for the server.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "utils.h"
+#include "admission.h"
+
+
+/************************** utility functions ************************/
+
+static inline int isFullAdmission( Admission_t* a ){
+    return a->n_client + a->n_waiting + a->n_reserved >= a->max_client + a->max_waiting;
+}
+
+/**
+* calls the watch function when the state of the admission changes
+* (with the lock held, so the calls are never reordered)
+*/
+static inline void updateWatchAdmission( Admission_t* a ){
+    int on = !isFullAdmission(a) && !a->starved;
+    if(on == a->watching) return;
+    a->watching = on;
+    if(a->watch) a->watch(on);
+}
+
+
+/************************* admission interface **********************/
+
+/**
+* @param max_client : clients connected at the same time
+* @param max_waiting : clients accepted that can wait for a place (0 for none)
+* @param watch : function called to stop (0) and resume (1) watching
+*                the listening socket, can be NULL
+*
+* @returns : the admission, NULL on failure and errno is set
+*/
+Admission_t* initAdmission( unsigned long max_client, unsigned long max_waiting, void (*watch)(int on) ){
+    if(max_client == 0){
+        errno = EINVAL;
+        return NULL;
+    }
+    Admission_t* a = malloc(sizeof(Admission_t));
+    if(!a) return NULL;
+    a->waiting = NULL;
+    if(max_waiting > 0 && (a->waiting = malloc(max_waiting * sizeof(long))) == NULL){
+        free(a);
+        return NULL;
+    }
+    if(pthread_mutex_init(&a->lock, NULL) != 0){
+        free(a->waiting);
+        free(a);
+        return NULL;
+    }
+    a->max_client   = max_client;
+    a->n_client     = 0;
+    a->max_waiting  = max_waiting;
+    a->head         = 0;
+    a->n_waiting    = 0;
+    a->n_reserved   = 0;
+    a->watching     = 1;
+    a->starved      = 0;
+    a->watch        = watch;
+    a->n_queued     = 0;
+    a->n_rejected   = 0;
+    return a;
+}
+
+/**
+* the clients still waiting for a place are disconnected
+*/
+void deleteAdmission( Admission_t* a ){
+    if(!a) return;
+    closeAdmission(a);
+    pthread_mutex_destroy(&a->lock);
+    free(a->waiting);
+    free(a);
+}
+
+/**
+* reserves a place (or a place in the queue) for the next client to accept
+*
+* @returns : 1 if the client can be accepted, 0 if all the places are taken
+*           (or no descriptor is left)
+*/
+int reserveAdmission( Admission_t* a ){
+    if(!a) return 0;
+    int r = 0;
+    LOCK(&a->lock);
+    if(!isFullAdmission(a) && !a->starved){
+        a->n_reserved++;
+        r = 1;
+        updateWatchAdmission(a);
+    }
+    UNLOCK(&a->lock);
+    return r;
+}
+
+/**
+* gives back the place reserved for an accept that has failed
+*/
+void cancelAdmission( Admission_t* a ){
+    if(!a) return;
+    LOCK(&a->lock);
+    if(a->n_reserved > 0) a->n_reserved--;
+    updateWatchAdmission(a);
+    UNLOCK(&a->lock);
+}
+
+/**
+* an accept has failed for lack of descriptors (EMFILE, ENFILE): the
+* listening socket is no longer watched, the clients wait in the backlog
+* instead of waking up the reactors at each attempt
+*/
+void starveAdmission( Admission_t* a ){
+    if(!a) return;
+    LOCK(&a->lock);
+    a->starved = 1;
+    updateWatchAdmission(a);
+    UNLOCK(&a->lock);
+}
+
+/**
+* the clients are accepted again after a lack of descriptors (some may
+* have been released meanwhile: if not, the next accept fails again)
+*/
+void retryAdmission( Admission_t* a ){
+    if(!a) return;
+    LOCK(&a->lock);
+    a->starved = 0;
+    updateWatchAdmission(a);
+    UNLOCK(&a->lock);
+}
+
+/**
+* a new client has been accepted on a place reserved with reserveAdmission
+*
+* @param fd : the client, kept in the queue if there is no free place
+*
+* @returns : ADMISSION_ACCEPTED if the client takes a place,
+*            ADMISSION_QUEUED if it waits in the queue
+*/
+int enterAdmission( Admission_t* a, long fd ){
+    if(!a){
+        errno = EINVAL;
+        return -1;
+    }
+    int r = ADMISSION_ACCEPTED;
+    LOCK(&a->lock);
+    if(a->n_reserved > 0) a->n_reserved--;
+    if(a->n_client < a->max_client){
+        a->n_client++;
+    }else{
+        a->waiting[(a->head + a->n_waiting) % a->max_waiting] = fd;
+        a->n_waiting++;
+        a->n_queued++;
+        r = ADMISSION_QUEUED;
+    }
+    UNLOCK(&a->lock);
+    return r;
+}
+
+/**
+* a client has left the server
+*
+* @param handover : 1 to give the place to the oldest waiting client,
+*                   0 at shutdown (the watch function is not called either)
+*
+* @returns : the client that takes the place, -1 if the place is free
+*/
+long leaveAdmission( Admission_t* a, int handover ){
+    if(!a) return -1;
+    long fd = -1;
+    LOCK(&a->lock);
+    if(handover && a->n_waiting > 0){
+        fd = a->waiting[a->head];
+        a->head = (a->head + 1) % a->max_waiting;
+        a->n_waiting--;
+    }else if(a->n_client > 0){
+        a->n_client--;
+    }
+    // the descriptor of the client that leaves is free again
+    if(handover) a->starved = 0;
+    if(handover) updateWatchAdmission(a);
+    UNLOCK(&a->lock);
+    return fd;
+}
+
+/**
+* the server stops: the clients still waiting for a place
+* are disconnected and counted as rejected
+*/
+void closeAdmission( Admission_t* a ){
+    if(!a) return;
+    LOCK(&a->lock);
+    while(a->n_waiting > 0){
+        close((int) a->waiting[a->head]);
+        a->head = (a->head + 1) % a->max_waiting;
+        a->n_waiting--;
+        a->n_rejected++;
+    }
+    UNLOCK(&a->lock);
+}
+
+/**
+* @param n_queued : where to write the clients that have waited in the queue
+* @param n_rejected : where to write the clients disconnected while waiting
+*/
+void getStatsAdmission( Admission_t* a, unsigned long* n_queued, unsigned long* n_rejected ){
+    if(!a) return;
+    LOCK(&a->lock);
+    if(n_queued) *n_queued = a->n_queued;
+    if(n_rejected) *n_rejected = a->n_rejected;
+    UNLOCK(&a->lock);
+}
@@ -23,15 +23,15 @@
 */
 
 /**
- * @file queue.c
+ * @file buffer.c
  *
- * Definition of type file_t
+ * Implementation of the bounded queue of pointers (ring of Vyukov)
  *
- * A generic file has :
- * 		- a name (key) : a string representing the key of the file
- *		- a content (data) : the contents of the file
- *		- a size of content (size) : the size of the content
- *		- a pointer to another file (next) : to use to create a list of files
+ * A producer reserves a turn with a compare-and-swap on enq, writes the
+ * pointer in the cell and publishes it by advancing the sequence number of
+ * the cell; a consumer does the same on deq. No allocation and no lock
+ * are needed to push or take an element: the lock of the buffer is only
+ * for the consumers that wait on an empty buffer.
  *
  * @author adrien koumgang tegantchouang
  * @version 1.0
@@ -40,27 +40,26 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "utils.h"
 #include "buffer.h"
 
+// attempts of popBuffer, each after a sched_yield, before it sleeps: a
+// consumer woken for one element would otherwise sleep again at once
+#define BUFFER_POP_SPIN 4
 
 
-/************************** utility functions ************************/
 
-static inline NodeB_t* allocNodeB( void ){
-    return malloc(sizeof(NodeB_t));
-}
+/************************** utility functions ************************/
 
 static inline Buffer_t* allocBuffer( void ){
-    return malloc(sizeof(Buffer_t));
-}
-
-static inline void freeNodeB( NodeB_t* node ){
-    free((void*)node);
+    void* b = NULL;
+    // enq starts a cache line, so it does not share it with other data
+    if(posix_memalign(&b, BUFFER_CACHE_LINE, sizeof(Buffer_t)) != 0) return NULL;
+    return (Buffer_t *) b;
 }
 
 static inline void lockBuffer( Buffer_t* b ){
@@ -83,87 +82,180 @@ static inline void unlockBufferAndSignal( Buffer_t* b ){
 
 /**************************** tail interface *************************/
 
-Buffer_t *initBuffer( void ) {
+/**
+* @param size : maximum number of elements (rounded up to a power of 2)
+*
+* @returns : the buffer, NULL on failure and errno is set
+*/
+Buffer_t *initBuffer( unsigned long size ) {
+    unsigned long i, n = 1;
+    if (size == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    while (n < size) n <<= 1;
+
     Buffer_t *b = allocBuffer();
     if (!b) return NULL;
-    b->head = NULL;
-    b->tail = NULL;
-    b->blen = 0;
+    if ((b->cell = malloc(n * sizeof(CellB_t))) == NULL) {
+        free(b);
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        b->cell[i].seq  = i;
+        b->cell[i].data = NULL;
+    }
+    b->mask   = n - 1;
+    b->enq    = 0;
+    b->deq    = 0;
+    b->n_wait = 0;
     if (pthread_mutex_init(&b->block, NULL) != 0) {
     	perror("mutex init");
+        free(b->cell);
+        free(b);
     	return NULL;
     }
     if (pthread_cond_init(&b->bcond, NULL) != 0) {
     	perror("mutex cond");
-    	if (&b->block) pthread_mutex_destroy(&b->block);
+    	pthread_mutex_destroy(&b->block);
+        free(b->cell);
+        free(b);
     	return NULL;
     }
     return b;
 }
 
+/**
+* the elements still in the buffer are not released: they belong to who pushed them
+*/
 void deleteBuffer(Buffer_t *b) {
-    while(b->head != NULL) {
-    	NodeB_t *nb = (NodeB_t*)b->head;
-    	b->head = b->head->next;
-        if(nb->data) free(nb->data);
-    	freeNodeB(nb);
-    }
-    if (&b->block)  pthread_mutex_destroy(&b->block);
-    if (&b->bcond)  pthread_cond_destroy(&b->bcond);
+    if (!b) return;
+    pthread_mutex_destroy(&b->block);
+    pthread_cond_destroy(&b->bcond);
+    free(b->cell);
     free(b);
 }
 
-int pushBuffer(Buffer_t *b, void *data, size_t size_data) {
+/**
+* adds an element (can be called by several threads)
+*
+* @param data : the element (not NULL)
+*
+* @returns : 0 on success, -1 on failure and errno is set (EAGAIN if the buffer is full)
+*/
+int pushBuffer(Buffer_t *b, void *data) {
     if ((b == NULL) || (data == NULL)){
         errno= EINVAL;
         return -1;
     }
 
-    NodeB_t *nb = allocNodeB();
-    if (!nb)
-        return -1;
+    CellB_t *c = NULL;
+    unsigned long pos = __atomic_load_n(&b->enq, __ATOMIC_RELAXED);
+    for (;;) {
+        c = &b->cell[pos & b->mask];
+        long dif = (long) __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (long) pos;
+        if (dif == 0) {
+            // the cell is free for this turn: I try to take the turn
+            if (__atomic_compare_exchange_n(&b->enq, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (dif < 0) {
+            // the cell still holds the element of the previous lap
+            errno = EAGAIN;
+            return -1;
+        } else {
+            pos = __atomic_load_n(&b->enq, __ATOMIC_RELAXED);
+        }
+    }
+    c->data = data;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
 
-    nb->data = malloc(size_data);
-    memcpy(nb->data, data, size_data);
-    nb->next = NULL;
-
-    lockBuffer(b);
-    if(b->head == NULL){
-        b->head = nb;
-        b->tail = nb;
-    }else{
-        b->tail->next = nb;
-        b->tail       = nb;
+    // pairs with the increment of n_wait in popBuffer
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&b->n_wait, __ATOMIC_RELAXED) > 0) {
+        lockBuffer(b);
+        // the consumer woken no longer counts: the next pushes made before
+        // it runs do not signal again
+        if (b->n_wait > 0) {
+            __atomic_sub_fetch(&b->n_wait, 1, __ATOMIC_SEQ_CST);
+            unlockBufferAndSignal(b);
+        } else {
+            unlockBuffer(b);
+        }
     }
-    b->blen      += 1;
-    unlockBufferAndSignal(b);
     return 0;
 }
 
+/**
+* takes the oldest element, waiting if the buffer is empty
+*/
 void *popBuffer(Buffer_t *b) {
     if (b == NULL) {
         errno= EINVAL;
         return NULL;
     }
-    lockBuffer(b);
-    while(b->head == NULL) {
-	       unlockBufferAndWait(b);
+    for (;;) {
+        void *data = tryPopBuffer(b);
+        if (data != NULL) return data;
+        for (int i = 0; i < BUFFER_POP_SPIN; i++) {
+            sched_yield();
+            if ((data = tryPopBuffer(b)) != NULL) return data;
+        }
+
+        lockBuffer(b);
+        __atomic_add_fetch(&b->n_wait, 1, __ATOMIC_SEQ_CST);
+        // an element pushed before n_wait was incremented has not signalled
+        if (lengthBuffer(b) == 0) {
+            // who signals takes this consumer off n_wait (after a spurious
+            // wakeup it counts one consumer too many: one useless signal)
+            unlockBufferAndWait(b);
+        } else {
+            __atomic_sub_fetch(&b->n_wait, 1, __ATOMIC_SEQ_CST);
+        }
+        unlockBuffer(b);
     }
-    // locked
-    assert(b->head);
-    NodeB_t *nb  = (NodeB_t *)b->head;
-    void *data = b->head->data;
-    b->head    = b->head->next;
-    b->blen   -= 1;
-    assert(b->blen>=0);
-    unlockBuffer(b);
-    freeNodeB(nb);
+}
+
+/**
+* like popBuffer, but it does not wait
+*
+* @returns : the oldest element, NULL if the buffer is empty
+*/
+void *tryPopBuffer(Buffer_t *b) {
+    if (b == NULL) {
+        errno= EINVAL;
+        return NULL;
+    }
+
+    CellB_t *c = NULL;
+    unsigned long pos = __atomic_load_n(&b->deq, __ATOMIC_RELAXED);
+    for (;;) {
+        c = &b->cell[pos & b->mask];
+        long dif = (long) __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (long) (pos + 1);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&b->deq, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (dif < 0) {
+            // the element of this turn has not been published yet
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&b->deq, __ATOMIC_RELAXED);
+        }
+    }
+    void *data = c->data;
+    // the cell is free for the producer of the next lap
+    __atomic_store_n(&c->seq, pos + b->mask + 1, __ATOMIC_RELEASE);
     return data;
 }
 
+/**
+* @returns : the number of elements (only an estimate
+*            while other threads use the buffer)
+*/
 unsigned long lengthBuffer(Buffer_t *b) {
-    lockBuffer(b);
-    unsigned long len = b->blen;
-    unlockBuffer(b);
-    return len;
+    if (b == NULL) return 0;
+    unsigned long deq = __atomic_load_n(&b->deq, __ATOMIC_SEQ_CST);
+    unsigned long enq = __atomic_load_n(&b->enq, __ATOMIC_SEQ_CST);
+    return enq - deq;
 }
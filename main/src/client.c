@@ -69,6 +69,9 @@ extern int usleep(useconds_t);
 #define time_to_retry (5 * 1000)
 #define time_to_connect_sec 5
 #define time_to_connect_nsec (time_to_connect_sec * 1000000)
+// requests of "-w" and "-W" sent without waiting for their reply
+// (less than the requests that the server reads in advance)
+#define PIPELINE_WINDOW 32
 
 char PATHNAME[2048];
 int LEN_PATHNAME = 0;
@@ -280,6 +283,8 @@ int do_cmd_w( char* arg, long n ){
     if(listOfFile(mdir, &flist, &n) == NULL) return -1;
     arg_list *corr = flist;
     arg_list *prev = NULL;
+    // the requests are sent without waiting for each reply
+    beginPipeline(PIPELINE_WINDOW);
     while(corr != NULL){
         if(openFile(corr->arg, O_CREATE_LOCK) == -1){
             fprintf(stderr, "ERROR: Request to write file '%s' failed\n", corr->arg);
@@ -291,6 +296,7 @@ int do_cmd_w( char* arg, long n ){
         if(prev->arg) free(prev->arg);
         free(prev);
     }
+    endPipeline();
 
     return 0;
 }
@@ -309,6 +315,8 @@ int do_cmd_W( char** args, long n ){
     if(!args || n<=0) return -1;
 
     if(print_operation) fprintf(stdout, "[%ld] writing '%ld' files to the server\n", timeToPrint++, n);
+    // the requests are sent without waiting for each reply
+    beginPipeline(PIPELINE_WINDOW);
     for(int i=0; i<n; i++){
         char path[MAX_FILE_NAME];
         if(realpath(args[i], path) == NULL){
@@ -332,6 +340,7 @@ int do_cmd_W( char** args, long n ){
             fprintf(stderr, "ERROR: Request to write file '%s' failed\n", path);
         }
     }
+    endPipeline();
 
     return 0;
 }
@@ -615,7 +624,7 @@ int main(int argc, char** argv){
             goto endClient;
         }
         memset(dirname_D, '\0', STR_LEN);
-        strncat(dirname_D, mdir, STR_LEN);
+        strncat(dirname_D, mdir, STR_LEN-1);
     }
     mdir = getFirstddir();
     if(mdir){
@@ -0,0 +1,732 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/**
+ * @file connection.c
+ *
+ * Implementation of the non-blocking reception of the requests
+ * and of the sending of the replies
+ *
+ * The reception is a state machine resumed at every wake-up of the master:
+ * each field of the request (operation, argument, size and pathname,
+ * size and data) is completed with the bytes available, and the stage
+ * is advanced according to the operation. The payloads larger than the
+ * receive buffer are read directly into their final buffer.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "communication.h"
+#include "connection.h"
+
+
+/************************** utility functions ************************/
+
+static inline conn_t* allocConn( void ){
+    return (conn_t *) malloc(sizeof(conn_t));
+}
+
+/**
+* stage that follows 'stage' for the operation of the request
+*/
+static int next_stage( conn_t* c, int stage ){
+    switch(stage){
+        case CONN_STAGE_OP:{
+            switch(c->req.op){
+                case _OF_O:
+                case _RNF_O:
+                case _RNFM_O:
+                    return CONN_STAGE_ARG;
+                case _RF_O:
+                case _RFM_O:
+                case _WF_O:
+                case _ATF_O:
+                case _LF_O:
+                case _UF_O:
+                case _CF_O:
+                case _RFI_O:
+                    return CONN_STAGE_SZ_P;
+                default: // close connection and unknown requests
+                    return CONN_STAGE_DONE;
+            }
+        }
+        case CONN_STAGE_ARG:
+            return (c->req.op == _OF_O) ? CONN_STAGE_SZ_P : CONN_STAGE_DONE;
+        case CONN_STAGE_SZ_P:
+            return (c->req.sz_p > 0) ? CONN_STAGE_PATH : next_stage(c, CONN_STAGE_PATH);
+        case CONN_STAGE_PATH:
+            return (c->req.op == _WF_O || c->req.op == _ATF_O) ? CONN_STAGE_SZ_D : CONN_STAGE_DONE;
+        case CONN_STAGE_SZ_D:
+            // the contents in the request ring have already been taken
+            return (c->req.sz_d > 0 && !c->req.in_shm) ? CONN_STAGE_DATA : CONN_STAGE_DONE;
+        default:
+            return CONN_STAGE_DONE;
+    }
+}
+
+/**
+* decodes a fixed-size field once all its bytes have been received
+*
+* @returns : 0 on success, -1 if the request is not acceptable
+*/
+static int end_field( conn_t* c ){
+    switch(c->stage){
+        case CONN_STAGE_OP:{
+            memcpy(&c->req.op, c->field, sizeof(int));
+            c->req.in_shm = (c->req.op & _SHM_F) != 0;
+            c->req.op &= ~_SHM_F;
+            // only the contents of a write can be in the request ring
+            if(c->req.in_shm && (__atomic_load_n(&c->shm, __ATOMIC_ACQUIRE) == NULL || (c->req.op != _WF_O && c->req.op != _ATF_O))) return -1;
+            break;
+        }
+        case CONN_STAGE_ARG:{
+            memcpy(&c->req.arg, c->field, sizeof(int));
+            break;
+        }
+        case CONN_STAGE_SZ_P:{
+            memcpy(&c->req.sz_p, c->field, sizeof(size_t));
+            if(c->req.sz_p > CONN_MAX_PATHNAME) return -1;
+            // the pathname is always terminated, even if the client did not
+            if((c->req.pathname = (char *) malloc(c->req.sz_p + 1)) == NULL) return -1;
+            c->req.pathname[c->req.sz_p] = '\0';
+            break;
+        }
+        case CONN_STAGE_SZ_D:{
+            memcpy(&c->req.sz_d, c->field, sizeof(size_t));
+            if(c->req.sz_d > 0 && (c->req.data = malloc(c->req.sz_d)) == NULL) return -1;
+            if(c->req.sz_d > 0 && c->req.in_shm && takeShmRing(c->shm, SHM_RING_REQUEST, c->req.data, c->req.sz_d) == -1) return -1;
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+* size of the current field of the request
+*/
+static size_t size_field( conn_t* c ){
+    switch(c->stage){
+        case CONN_STAGE_OP:
+        case CONN_STAGE_ARG:
+            return sizeof(int);
+        case CONN_STAGE_SZ_P:
+        case CONN_STAGE_SZ_D:
+            return sizeof(size_t);
+        case CONN_STAGE_PATH:
+            return c->req.sz_p;
+        case CONN_STAGE_DATA:
+            return c->req.sz_d;
+    }
+    return 0;
+}
+
+/**
+* consumes the bytes 'src' received from the client
+*
+* @returns : the number of bytes used, the parsing stops at the end of
+*            the request (the following bytes belong to the next one)
+*/
+static size_t parse( conn_t* c, const char* src, size_t len ){
+    size_t used = 0;
+    while(used < len && c->stage != CONN_STAGE_DONE && c->stage != CONN_STAGE_ERROR){
+        size_t need = size_field(c) - c->got;
+        size_t n = (len - used < need) ? len - used : need;
+        char* dst = NULL;
+        switch(c->stage){
+            case CONN_STAGE_PATH: dst = c->req.pathname; break;
+            case CONN_STAGE_DATA: dst = (char *) c->req.data; break;
+            default: dst = c->field;
+        }
+        memcpy(dst + c->got, src + used, n);
+        c->got += n;
+        used += n;
+        if(c->got == size_field(c)){
+            if(end_field(c) == -1){
+                c->stage = CONN_STAGE_ERROR;
+                break;
+            }
+            c->stage = next_stage(c, c->stage);
+            c->got = 0;
+        }
+    }
+    return used;
+}
+
+/**
+* makes room for 'size' more bytes in the buffer 'buf' of length 'len'
+*
+* @returns : 0 on success, -1 if the memory is over
+*/
+static int grow_buffer( char** buf, size_t len, size_t* cap, size_t size ){
+    if(len + size <= *cap) return 0;
+    size_t new_cap = (*cap > 0) ? *cap : 256;
+    while(new_cap < len + size) new_cap *= 2;
+    char* b = (char *) realloc(*buf, new_cap);
+    if(!b){
+        errno = ENOMEM;
+        return -1;
+    }
+    *buf = b;
+    *cap = new_cap;
+    return 0;
+}
+
+/**
+* makes room for 'n' more segments in the reply 'r'
+*
+* @returns : 0 on success, -1 if the memory is over
+*/
+static int grow_segments( conn_reply_t* r, int n ){
+    if(r->n_seg + n <= r->seg_cap) return 0;
+    int new_cap = (r->seg_cap > 0) ? r->seg_cap : 8;
+    while(new_cap < r->n_seg + n) new_cap *= 2;
+    conn_seg_t* s = (conn_seg_t *) realloc(r->seg, new_cap * sizeof(conn_seg_t));
+    if(!s){
+        errno = ENOMEM;
+        return -1;
+    }
+    r->seg = s;
+    r->seg_cap = new_cap;
+    return 0;
+}
+
+static inline void release_segment( conn_seg_t* s ){
+    if(s->release) s->release(s->owner);
+    s->release = NULL;
+}
+
+/**
+* releases the payloads of the segments of 'r' from 'from' and its buffers
+*/
+static void free_reply( conn_reply_t* r, int from ){
+    for(int i=from; i<r->n_seg; i++) release_segment(&r->seg[i]);
+    if(r->seg) free(r->seg);
+    if(r->hdr) free(r->hdr);
+}
+
+static void free_request( request_t* r ){
+    if(r->pathname) free(r->pathname);
+    if(r->data) free(r->data);
+    free(r);
+}
+
+
+/************************** connection interface *********************/
+
+/**
+* creates the state of a new connection
+*
+* @param fd : file descriptor of the client (non-blocking)
+* @param completion : queue where the workers give back the connection
+*
+* @returns : the new connection, NULL on failure
+*/
+conn_t* conn_create( long fd, Completion_t* completion ){
+    conn_t* c = allocConn();
+    if(!c) return NULL;
+    memset(c, 0, sizeof(conn_t));
+    c->fd = fd;
+    c->stage = CONN_STAGE_OP;
+    c->completion = completion;
+    c->done.fd = fd;
+    c->worker = -1;
+    return c;
+}
+
+void conn_free( conn_t* c ){
+    if(!c) return;
+    if(c->req.pathname) free(c->req.pathname);
+    if(c->req.data) free(c->req.data);
+    while(c->queue_head != NULL){
+        request_t* r = c->queue_head;
+        c->queue_head = r->next;
+        free_request(r);
+    }
+    if(c->cur) free_request(c->cur);
+    free_reply(&c->out, 0);
+    free_reply(&c->tx, c->tx_seg);
+    deleteShmRing(c->shm);
+    free(c);
+}
+
+/**
+* @returns : the connection the completion record belongs to
+*/
+conn_t* conn_from_completion( NodeC_t* node ){
+    if(!node) return NULL;
+    return (conn_t *) ((char *) node - offsetof(conn_t, done));
+}
+
+/**
+* @returns : the connection the flow of the scheduler belongs to
+*/
+conn_t* conn_from_drr( NodeD_t* node ){
+    if(!node) return NULL;
+    return (conn_t *) ((char *) node - offsetof(conn_t, sched));
+}
+
+/**
+* @returns : the connection the timer belongs to
+*/
+conn_t* conn_from_wheel( NodeW_t* node ){
+    if(!node) return NULL;
+    return (conn_t *) ((char *) node - offsetof(conn_t, timer));
+}
+
+/**
+* parses the bytes already received
+*
+* @returns : 1 if the request is complete
+*            0 if more bytes are needed
+*            -1 if the request is not acceptable
+*/
+int conn_parse_input( conn_t* c ){
+    if(c->rx_off < c->rx_len){
+        c->rx_off += parse(c, c->rx + c->rx_off, c->rx_len - c->rx_off);
+        if(c->rx_off == c->rx_len) c->rx_off = c->rx_len = 0;
+    }
+    if(c->stage == CONN_STAGE_DONE) return 1;
+    if(c->stage == CONN_STAGE_ERROR){
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+* where the next bytes of the client must be received: the large payloads
+* go directly in their buffer, everything else in the receive buffer
+*
+* @param buf : (output) the buffer
+* @param len : (output) the maximum number of bytes to receive
+*/
+void conn_recv_buffer( conn_t* c, char** buf, size_t* len ){
+    if((c->stage == CONN_STAGE_DATA) && (c->req.sz_d - c->got >= CONN_RX_SIZE)){
+        *buf = (char *) c->req.data + c->got;
+        *len = c->req.sz_d - c->got;
+    }else{
+        *buf = c->rx;
+        *len = CONN_RX_SIZE;
+    }
+}
+
+/**
+* accounts 'n' bytes received in the buffer given by conn_recv_buffer
+*/
+void conn_received( conn_t* c, size_t n ){
+    if((c->stage == CONN_STAGE_DATA) && (c->req.sz_d - c->got >= CONN_RX_SIZE)){
+        c->got += n;
+        if(c->got == c->req.sz_d){
+            c->stage = CONN_STAGE_DONE;
+            c->got = 0;
+        }
+    }else{
+        c->rx_off = 0;
+        c->rx_len = n;
+    }
+}
+
+/**
+* continues receiving the current request without blocking
+*
+* @returns : 1 if the request is complete
+*            0 if the socket has no more data for now
+*            -1 if the client has closed the connection or sent a bad request
+*/
+int conn_recv( conn_t* c ){
+    if(!c){
+        errno = EINVAL;
+        return -1;
+    }
+
+    int r = 0;
+    char* buf = NULL;
+    size_t len = 0;
+    // first I use what has already been received
+    while((r = conn_parse_input(c)) == 0){
+        conn_recv_buffer(c, &buf, &len);
+        ssize_t n = read((int) c->fd, buf, len);
+        if(n == -1){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if(n == 0) return -1; // EOF
+        conn_received(c, n);
+    }
+    return r;
+}
+
+/**
+* @returns : 1 if bytes already received are waiting to be parsed
+*/
+int conn_has_input( conn_t* c ){
+    return c->rx_off < c->rx_len;
+}
+
+/**
+* queues the request just received and prepares the reception of the next one
+*
+* @returns : 0 on success, -1 if the memory is over
+*/
+int conn_push_request( conn_t* c ){
+    request_t* r = (request_t *) malloc(sizeof(request_t));
+    if(!r) return -1;
+    *r = c->req;
+    r->next = NULL;
+    if(c->queue_tail) c->queue_tail->next = r;
+    else c->queue_head = r;
+    c->queue_tail = r;
+    c->queue_len++;
+
+    memset(&c->req, 0, sizeof(request_t));
+    c->stage = CONN_STAGE_OP;
+    c->got = 0;
+    return 0;
+}
+
+/**
+* takes the oldest request not yet served, which becomes the current one
+*
+* @returns : the request, NULL if there is none
+*/
+request_t* conn_next_request( conn_t* c ){
+    request_t* r = c->queue_head;
+    if(!r) return NULL;
+    c->queue_head = r->next;
+    if(!c->queue_head) c->queue_tail = NULL;
+    c->queue_len--;
+    r->next = NULL;
+    c->cur = r;
+    return r;
+}
+
+/**
+* releases the request served by the worker
+*/
+void conn_end_request( conn_t* c ){
+    if(c->cur) free_request(c->cur);
+    c->cur = NULL;
+}
+
+/**
+* @returns : 1 if the worker has written a reply not yet moved to 'tx'
+*/
+int conn_has_reply( conn_t* c ){
+    return c->out.n_seg > 0;
+}
+
+/**
+* moves the reply written by the worker behind the replies still to be sent
+* (the send buffer must not be in use)
+*/
+void conn_flush_reply( conn_t* c ){
+    if(c->out.n_seg == 0) return;
+    if(c->tx_seg == c->tx.n_seg){
+        // nothing to send: the replies are exchanged without copying
+        conn_reply_t r = c->tx;
+        r.hdr_len = 0;
+        r.n_seg = 0;
+        c->tx = c->out;
+        c->out = r;
+        c->tx_seg = 0;
+        c->tx_off = 0;
+        return;
+    }
+    conn_reply_t* t = &c->tx;
+    if(grow_buffer(&t->hdr, t->hdr_len, &t->hdr_cap, c->out.hdr_len) == -1) return;
+    if(grow_segments(t, c->out.n_seg) == -1) return;
+    for(int i=0; i<c->out.n_seg; i++){
+        conn_seg_t* s = &t->seg[t->n_seg++];
+        *s = c->out.seg[i];
+        if(!s->base) s->off += t->hdr_len;
+    }
+    if(c->out.hdr_len > 0) memcpy(t->hdr + t->hdr_len, c->out.hdr, c->out.hdr_len);
+    t->hdr_len += c->out.hdr_len;
+    c->out.hdr_len = 0;
+    c->out.n_seg = 0;
+}
+
+/**
+* accounts 'n' bytes of the replies sent to the client, the payloads
+* sent completely are released
+*
+* @returns : 1 if the replies have been sent completely, 0 otherwise
+*/
+int conn_sent( conn_t* c, size_t n ){
+    while(n > 0 && c->tx_seg < c->tx.n_seg){
+        conn_seg_t* s = &c->tx.seg[c->tx_seg];
+        size_t left = s->len - c->tx_off;
+        if(n < left){
+            c->tx_off += n;
+            return 0;
+        }
+        n -= left;
+        release_segment(s);
+        c->tx_seg++;
+        c->tx_off = 0;
+    }
+    if(c->tx_seg < c->tx.n_seg) return 0;
+    c->tx_seg = c->tx.n_seg = 0;
+    c->tx_off = c->tx.hdr_len = 0;
+    if(c->tx.hdr_cap > CONN_TX_KEEP){
+        free(c->tx.hdr);
+        c->tx.hdr = NULL;
+        c->tx.hdr_cap = 0;
+    }
+    return 1;
+}
+
+/**
+* describes in 'tx_iov' the next segments to send
+*
+* @returns : the number of iovec used
+*/
+static int fill_iov( conn_t* c ){
+    int n = 0;
+    for(int i=c->tx_seg; i<c->tx.n_seg && n<CONN_IOV_MAX; i++, n++){
+        conn_seg_t* s = &c->tx.seg[i];
+        // a descriptor goes with the first byte of a message
+        if(s->fd >= 0 && n > 0) break;
+        const char* b = s->base ? s->base : c->tx.hdr + s->off;
+        size_t skip = (i == c->tx_seg) ? c->tx_off : 0;
+        c->tx_iov[n].iov_base = (void *) (b + skip);
+        c->tx_iov[n].iov_len = s->len - skip;
+    }
+    return n;
+}
+
+/**
+* sends the pending replies without blocking, up to CONN_IOV_MAX segments
+* with each sendmsg
+*
+* @returns : 1 if the replies have been sent completely
+*            0 if the socket cannot accept more data for now
+*            -1 on error
+*/
+int conn_send( conn_t* c ){
+    while(c->tx_seg < c->tx.n_seg){
+        ssize_t w = sendmsg((int) c->fd, conn_send_msg(c), MSG_NOSIGNAL);
+        if(w == -1){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if(conn_sent(c, w)) return 1;
+    }
+    return 1;
+}
+
+/**
+* prepares the message to send the pending replies with a single sendmsg
+* (it stays valid until conn_sent is called)
+*/
+struct msghdr* conn_send_msg( conn_t* c ){
+    memset(&c->tx_msg, 0, sizeof(struct msghdr));
+    c->tx_msg.msg_iov = c->tx_iov;
+    c->tx_msg.msg_iovlen = fill_iov(c);
+    conn_seg_t* s = &c->tx.seg[c->tx_seg];
+    if(s->fd >= 0 && c->tx_off == 0){
+        c->tx_msg.msg_control = c->tx_ctl.buf;
+        c->tx_msg.msg_controllen = sizeof(c->tx_ctl.buf);
+        struct cmsghdr* cm = CMSG_FIRSTHDR(&c->tx_msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cm), &s->fd, sizeof(int));
+    }
+    return &c->tx_msg;
+}
+
+int conn_has_output( conn_t* c ){
+    return c->tx_seg < c->tx.n_seg;
+}
+
+/**
+* adds 'size' bytes to the reply of the current request (the socket is not used)
+*
+* @returns : 1 on success, -1 if the memory is over
+*/
+int conn_writen( conn_t* c, const void* buf, size_t size ){
+    if(size == 0) return 1;
+    conn_reply_t* r = &c->out;
+    if(grow_buffer(&r->hdr, r->hdr_len, &r->hdr_cap, size) == -1) return -1;
+    memcpy(r->hdr + r->hdr_len, buf, size);
+    // the bytes that follow the last segment of the header buffer extend it
+    // (also if it carries a descriptor: they are sent after it)
+    conn_seg_t* last = (r->n_seg > 0) ? &r->seg[r->n_seg-1] : NULL;
+    if(last && !last->base && last->off + last->len == r->hdr_len){
+        last->len += size;
+    }else{
+        if(grow_segments(r, 1) == -1) return -1;
+        conn_seg_t* s = &r->seg[r->n_seg++];
+        memset(s, 0, sizeof(conn_seg_t));
+        s->off = r->hdr_len;
+        s->len = size;
+        s->fd = -1;
+    }
+    r->hdr_len += size;
+    return 1;
+}
+
+/**
+* adds 'size' bytes to the reply without copying them: they are released
+* with 'release(owner)' once sent (also if the function fails)
+*
+* @returns : 1 on success, -1 if the memory is over
+*/
+int conn_write_ref( conn_t* c, const void* buf, size_t size, void (*release)( void* ), void* owner ){
+    if(size < CONN_COPY_MAX){
+        int err = conn_writen(c, buf, size);
+        if(release) release(owner);
+        return err;
+    }
+    if(grow_segments(&c->out, 1) == -1){
+        if(release) release(owner);
+        return -1;
+    }
+    conn_seg_t* s = &c->out.seg[c->out.n_seg++];
+    s->base = (const char *) buf;
+    s->off = 0;
+    s->len = size;
+    s->fd = -1;
+    s->release = release;
+    s->owner = owner;
+    return 1;
+}
+
+int conn_write_pathname( conn_t* c, const char* pathname, size_t sz_p ){
+    if(conn_writen(c, &sz_p, sizeof(size_t)) == -1) return -1;
+    if(conn_writen(c, pathname, sz_p) == -1) return -1;
+    return 0;
+}
+
+int conn_write_reason( conn_t* c, const char* reason ){
+    size_t sz_r = strlen(reason)+1;
+    if(conn_writen(c, &sz_r, sizeof(size_t)) == -1) return -1;
+    if(conn_writen(c, reason, sz_r) == -1) return -1;
+    return 0;
+}
+
+int conn_write_data( conn_t* c, const void* data, size_t sz_d ){
+    if(conn_writen(c, &sz_d, sizeof(size_t)) == -1) return -1;
+    if(conn_writen(c, data, sz_d) == -1) return -1;
+    return 0;
+}
+
+/**
+* like conn_write_data, but the contents are referenced (see conn_write_ref)
+*/
+int conn_write_data_ref( conn_t* c, const void* data, size_t sz_d, void (*release)( void* ), void* owner ){
+    if(conn_writen(c, &sz_d, sizeof(size_t)) == -1){
+        if(release) release(owner);
+        return -1;
+    }
+    if(conn_write_ref(c, data, sz_d, release, owner) == -1) return -1;
+    return 0;
+}
+
+/**
+* writes the contents of a file for a mapped read: if 'fd' is a memfd
+* with the contents it is passed to the client with the header
+* (DATA_IN_FD, size), otherwise the bytes follow the header (DATA_IN_LINE)
+* as in conn_write_data_ref; 'owner' keeps the descriptor open until sent
+*/
+int conn_write_data_fd( conn_t* c, const void* data, size_t sz_d, int fd, void (*release)( void* ), void* owner ){
+    int mode = (fd >= 0) ? DATA_IN_FD : DATA_IN_LINE;
+    if(mode == DATA_IN_LINE){
+        if(conn_writen(c, &mode, sizeof(int)) == -1){
+            if(release) release(owner);
+            return -1;
+        }
+        return conn_write_data_ref(c, data, sz_d, release, owner);
+    }
+
+    // the header starts a new segment, which carries the descriptor
+    conn_reply_t* r = &c->out;
+    if(grow_buffer(&r->hdr, r->hdr_len, &r->hdr_cap, sizeof(int) + sizeof(size_t)) == -1
+        || grow_segments(r, 1) == -1){
+        if(release) release(owner);
+        return -1;
+    }
+    conn_seg_t* s = &r->seg[r->n_seg++];
+    s->base = NULL;
+    s->off = r->hdr_len;
+    s->len = sizeof(int) + sizeof(size_t);
+    s->fd = fd;
+    s->release = release;
+    s->owner = owner;
+    memcpy(r->hdr + r->hdr_len, &mode, sizeof(int));
+    memcpy(r->hdr + r->hdr_len + sizeof(int), &sz_d, sizeof(size_t));
+    r->hdr_len += s->len;
+    return 0;
+}
+
+/**
+* writes the contents of a file on a connection with the shared-memory
+* rings: the header (DATA_IN_SHM, size) goes in the socket and the bytes in
+* the response ring if they fit, otherwise the bytes follow the header
+* (DATA_IN_LINE) as in conn_write_data_ref
+*/
+int conn_write_data_shm( conn_t* c, const void* data, size_t sz_d, void (*release)( void* ), void* owner ){
+    int mode = DATA_IN_LINE;
+    if(sz_d >= SHM_RING_MIN && putShmRing(c->shm, SHM_RING_RESPONSE, data, sz_d) == 0) mode = DATA_IN_SHM;
+    if(conn_writen(c, &mode, sizeof(int)) == -1){
+        if(release) release(owner);
+        return -1;
+    }
+    if(mode == DATA_IN_LINE) return conn_write_data_ref(c, data, sz_d, release, owner);
+    // the bytes have been copied in the ring
+    if(release) release(owner);
+    if(conn_writen(c, &sz_d, sizeof(size_t)) == -1) return -1;
+    return 0;
+}
+
+/**
+* writes the files ejected from the server: the contents of the i-th file
+* are released with 'release(owner[i])' once sent (also on failure)
+*/
+int conn_write_file_eject( conn_t* c, int n, char** pathname, size_t* size_p, void** data, size_t* size_d,
+                                void (*release)( void* ), void** owner ){
+    int err = 0;
+    if(conn_writen(c, &n, sizeof(int)) == -1) err = -1;
+    for(int i=0; i<n; i++){
+        if(err == 0 && conn_write_pathname(c, pathname[i], size_p[i]) == -1) err = -1;
+        if(err == 0){
+            if(conn_write_data_ref(c, data[i], size_d[i], release, owner[i]) == -1) err = -1;
+        }else if(release){
+            release(owner[i]);
+        }
+    }
+    return err;
+}
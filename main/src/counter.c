@@ -0,0 +1,116 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file counter.c
+ *
+ * Implementation of the sharded counters
+ *
+ * Each thread receives a number the first time it updates a counter and
+ * uses the shard with that number (modulo the shards) of every counter.
+ * The adds are atomic, so the threads that share a shard (when they are
+ * more than the shards) do not lose updates either.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "counter.h"
+
+// number of the next thread that updates a counter
+static unsigned long next_id = 0;
+
+// number of the thread, -1 until its first update
+static __thread long my_id = -1;
+
+
+/************************** utility functions ************************/
+
+static inline Counter_t* allocCounter( void ){
+    return malloc(sizeof(Counter_t));
+}
+
+static inline unsigned long idCounter( void ){
+    if(my_id == -1) my_id = (long) __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    return (unsigned long) my_id;
+}
+
+
+/************************** counter interface ***********************/
+
+/**
+* @param n : number of shards (the threads that update the counter)
+*
+* @returns : the counter at zero, NULL on failure and errno is set
+*/
+Counter_t* initCounter( unsigned long n ){
+    if(n == 0){
+        errno = EINVAL;
+        return NULL;
+    }
+    Counter_t* c = allocCounter();
+    if(!c) return NULL;
+    void* p = NULL;
+    if((errno = posix_memalign(&p, COUNTER_LINE, n * sizeof(CellN_t))) != 0){
+        free(c);
+        return NULL;
+    }
+    c->shard = (CellN_t *) p;
+    c->n = n;
+    unsigned long i;
+    for(i=0; i<n; i++){
+        c->shard[i].v = 0;
+    }
+    return c;
+}
+
+void deleteCounter( Counter_t* c ){
+    if(!c) return;
+    free(c->shard);
+    free(c);
+}
+
+/**
+* adds 'delta' (also negative) to the counter
+*/
+void addCounter( Counter_t* c, long delta ){
+    __atomic_add_fetch(&c->shard[idCounter() % c->n].v, delta, __ATOMIC_RELAXED);
+}
+
+/**
+* @returns : the value of the counter, the sum of the shards
+*/
+long readCounter( Counter_t* c ){
+    unsigned long i;
+    long r = 0;
+    for(i=0; i<c->n; i++){
+        r += __atomic_load_n(&c->shard[i].v, __ATOMIC_RELAXED);
+    }
+    return r;
+}
@@ -0,0 +1,254 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file dispatch.c
+ *
+ * Implementation of the run queues of the workers with work stealing
+ *
+ * A worker sleeps only after finding all the queues empty, and who pushes an
+ * element wakes up a worker only if someone is sleeping: while all the
+ * workers are busy, pushing and taking an element touches only the queue
+ * where it is.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "utils.h"
+#include "buffer.h"
+#include "dispatch.h"
+
+
+/************************** utility functions ************************/
+
+static inline Dispatch_t* allocDispatch( void ){
+    return calloc(1, sizeof(Dispatch_t));
+}
+
+/**
+* @returns : 1 if there is no element in any queue
+*/
+static int isEmptyDispatch( Dispatch_t* d ){
+    unsigned long i;
+    for(i=0; i<d->n; i++){
+        if(lengthBuffer(d->local[i]) > 0) return 0;
+    }
+    return 1;
+}
+
+/**
+* takes an element from the queue of the worker or, if it is empty,
+* steals the oldest element of another queue
+*
+* @returns : the element, NULL if all the queues are empty
+*/
+static void* takeDispatch( Dispatch_t* d, unsigned long w ){
+    void* data = tryPopBuffer(d->local[w]);
+    unsigned long k;
+    // the victims are visited starting from the next worker,
+    // so the thieves do not all go to the same queue
+    for(k=1; data == NULL && k<d->n; k++){
+        if((data = tryPopBuffer(d->local[(w + k) % d->n])) != NULL) d->n_stolen[w]++;
+    }
+    return data;
+}
+
+/**
+* the worker 'w' waits for an element
+*/
+static void sleepDispatch( Dispatch_t* d, unsigned long w ){
+    LOCK(&d->lock);
+    d->sleeping[w] = 1;
+    __atomic_add_fetch(&d->n_idle, 1, __ATOMIC_SEQ_CST);
+    // an element pushed before n_idle was incremented has not woken anyone
+    if(!d->stop && isEmptyDispatch(d)) WAIT(&d->cond[w], &d->lock);
+    d->sleeping[w] = 0;
+    __atomic_sub_fetch(&d->n_idle, 1, __ATOMIC_SEQ_CST);
+    UNLOCK(&d->lock);
+}
+
+/**
+* wakes up the worker 'w' if it is sleeping, otherwise another worker
+* that is sleeping, which will steal the element
+*
+* the flag is cleared here, so that the next elements pushed before the
+* worker runs wake up another worker instead of the same one
+*/
+static void wakeDispatch( Dispatch_t* d, unsigned long w ){
+    unsigned long k;
+    LOCK(&d->lock);
+    for(k=0; k<d->n; k++){
+        unsigned long i = (w + k) % d->n;
+        if(d->sleeping[i]){
+            d->sleeping[i] = 0;
+            SIGNAL(&d->cond[i]);
+            break;
+        }
+    }
+    UNLOCK(&d->lock);
+}
+
+
+/************************** dispatch interface ***********************/
+
+/**
+* @param n : number of workers
+* @param size : elements that each queue can hold
+*
+* @returns : the dispatcher, NULL on failure and errno is set
+*/
+Dispatch_t* initDispatch( unsigned long n, unsigned long size ){
+    unsigned long i;
+    if(n == 0){
+        errno = EINVAL;
+        return NULL;
+    }
+    Dispatch_t* d = allocDispatch();
+    if(!d) return NULL;
+    d->n = n;
+    if((d->local = calloc(n, sizeof(Buffer_t *))) == NULL
+        || (d->sleeping = calloc(n, sizeof(int))) == NULL
+        || (d->cond = calloc(n, sizeof(pthread_cond_t))) == NULL
+        || (d->n_stolen = calloc(n, sizeof(unsigned long))) == NULL
+        || pthread_mutex_init(&d->lock, NULL) != 0){
+        free(d->local);
+        free(d->sleeping);
+        free(d->cond);
+        free(d->n_stolen);
+        free(d);
+        return NULL;
+    }
+    for(i=0; i<n; i++){
+        if((d->local[i] = initBuffer(size)) == NULL) break;
+        if(pthread_cond_init(&d->cond[i], NULL) != 0){
+            deleteBuffer(d->local[i]);
+            break;
+        }
+    }
+    if(i < n){
+        // the queues created so far are released by deleteDispatch
+        d->n = i;
+        deleteDispatch(d);
+        return NULL;
+    }
+    return d;
+}
+
+/**
+* the elements still in the queues are not released: they belong to who pushed them
+*/
+void deleteDispatch( Dispatch_t* d ){
+    unsigned long i;
+    if(!d) return;
+    for(i=0; i<d->n; i++){
+        deleteBuffer(d->local[i]);
+        pthread_cond_destroy(&d->cond[i]);
+    }
+    pthread_mutex_destroy(&d->lock);
+    free(d->local);
+    free(d->sleeping);
+    free(d->cond);
+    free(d->n_stolen);
+    free(d);
+}
+
+/**
+* adds an element to the queue of a worker (can be called by several threads)
+*
+* @param data : the element (not NULL)
+* @param worker : the worker that should take it, -1 for any worker
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+int pushDispatch( Dispatch_t* d, void* data, long worker ){
+    if(!d || !data){
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned long k, w = (unsigned long) worker;
+    if(worker < 0 || w >= d->n) w = __atomic_fetch_add(&d->rr, 1, __ATOMIC_RELAXED) % d->n;
+    // if the queue is full the element goes to the next one
+    for(k=0; k<d->n; k++){
+        if(pushBuffer(d->local[(w + k) % d->n], data) == 0) break;
+        if(errno != EAGAIN) return -1;
+    }
+    if(k == d->n) return -1;
+    // pairs with the increment of n_idle in sleepDispatch
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&d->n_idle, __ATOMIC_SEQ_CST) > 0) wakeDispatch(d, w);
+    return 0;
+}
+
+/**
+* takes the next element for the worker 'worker', waiting if there is none
+*
+* @returns : the element, NULL after stopDispatch when all the queues are empty
+*/
+void* popDispatch( Dispatch_t* d, unsigned long worker ){
+    if(!d || worker >= d->n){
+        errno = EINVAL;
+        return NULL;
+    }
+    for(;;){
+        void* data = takeDispatch(d, worker);
+        if(data != NULL) return data;
+        if(__atomic_load_n(&d->stop, __ATOMIC_ACQUIRE)) return NULL;
+        sleepDispatch(d, worker);
+    }
+}
+
+/**
+* wakes up all the workers: popDispatch returns NULL once the queues are empty
+*/
+void stopDispatch( Dispatch_t* d ){
+    unsigned long i;
+    if(!d) return;
+    LOCK(&d->lock);
+    __atomic_store_n(&d->stop, 1, __ATOMIC_RELEASE);
+    for(i=0; i<d->n; i++){
+        SIGNAL(&d->cond[i]);
+    }
+    UNLOCK(&d->lock);
+}
+
+/**
+* @returns : the elements taken from the queue of another worker
+*            (to call when the workers have finished)
+*/
+unsigned long getStolenDispatch( Dispatch_t* d ){
+    unsigned long i, r = 0;
+    if(!d) return 0;
+    for(i=0; i<d->n; i++){
+        r += d->n_stolen[i];
+    }
+    return r;
+}
@@ -0,0 +1,180 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file drr.c
+ *
+ * Implementation of the deficit round-robin scheduler
+ *
+ * A flow receives the quantum only when its credit is not enough for its
+ * request, so the clients with small requests do not accumulate credit.
+ * When no flow can be served in the current round, the rounds in which
+ * all of them would only receive the quantum are skipped at once: a large
+ * request alone does not cost a visit for every quantum of its size.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "drr.h"
+
+
+/************************** utility functions ************************/
+
+static inline Drr_t* allocDrr( void ){
+    return calloc(1, sizeof(Drr_t));
+}
+
+static void linkDrr( Drr_t* d, NodeD_t* node ){
+    node->prev = d->tail;
+    node->next = NULL;
+    if(d->tail) d->tail->next = node;
+    else d->head = node;
+    d->tail = node;
+}
+
+static void unlinkDrr( Drr_t* d, NodeD_t* node ){
+    if(node->prev) node->prev->next = node->next;
+    else d->head = node->next;
+    if(node->next) node->next->prev = node->prev;
+    else d->tail = node->prev;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+/**
+* @returns : the rounds the flow still has to wait to be served
+*/
+static inline size_t roundsDrr( Drr_t* d, NodeD_t* node ){
+    if(node->deficit >= node->cost) return 0;
+    return (node->cost - node->deficit + d->quantum - 1) / d->quantum;
+}
+
+/**
+* gives at once to every flow the credit of the rounds in which none
+* of them could be served
+*/
+static void skipRoundsDrr( Drr_t* d ){
+    NodeD_t* node = NULL;
+    size_t k, rounds = roundsDrr(d, d->head);
+    for(node=d->head->next; node!=NULL && rounds>1; node=node->next){
+        if((k = roundsDrr(d, node)) < rounds) rounds = k;
+    }
+    if(rounds <= 1) return;
+    for(node=d->head; node!=NULL; node=node->next){
+        node->deficit += (rounds - 1) * d->quantum;
+    }
+}
+
+
+/************************** drr interface ***********************/
+
+/**
+* @param quantum : credit given to a flow at each round (bytes)
+* @param max_flight : requests that can be in the hands of the workers
+*
+* @returns : the scheduler, NULL on failure and errno is set
+*/
+Drr_t* initDrr( size_t quantum, unsigned long max_flight ){
+    if(quantum == 0 || max_flight == 0){
+        errno = EINVAL;
+        return NULL;
+    }
+    Drr_t* d = allocDrr();
+    if(!d) return NULL;
+    d->quantum      = quantum;
+    d->max_flight   = max_flight;
+    return d;
+}
+
+/**
+* the flows still active are not released: they belong to the connections
+*/
+void deleteDrr( Drr_t* d ){
+    if(d) free(d);
+}
+
+/**
+* the flow has a request ready: it waits for its turn
+*
+* @param cost : cost of the request (bytes)
+*/
+void pushDrr( Drr_t* d, NodeD_t* node, size_t cost ){
+    if(!d || !node || node->active) return;
+    node->cost      = cost;
+    node->active    = 1;
+    linkDrr(d, node);
+}
+
+/**
+* visits the flows in round-robin and takes the first one whose
+* credit is enough for its request
+*
+* @returns : the flow to serve, NULL if there is none or
+*            the workers already have max_flight requests
+*/
+NodeD_t* popDrr( Drr_t* d ){
+    if(!d || d->head == NULL || d->in_flight >= d->max_flight) return NULL;
+    skipRoundsDrr(d);
+    for(;;){
+        NodeD_t* node = d->head;
+        unlinkDrr(d, node);
+        if(node->deficit < node->cost) node->deficit += d->quantum;
+        if(node->deficit >= node->cost){
+            node->deficit   -= node->cost;
+            node->active    = 0;
+            d->in_flight++;
+            return node;
+        }
+        linkDrr(d, node);
+    }
+}
+
+/**
+* removes a flow that is waiting (the connection is closed)
+*/
+void removeDrr( Drr_t* d, NodeD_t* node ){
+    if(!d || !node || !node->active) return;
+    unlinkDrr(d, node);
+    node->active = 0;
+}
+
+/**
+* a worker has finished a request taken with popDrr
+*/
+void doneDrr( Drr_t* d ){
+    if(d && d->in_flight > 0) d->in_flight--;
+}
+
+/**
+* the flow has no more requests: the credit left is not kept
+*/
+void idleDrr( NodeD_t* node ){
+    if(node) node->deficit = 0;
+}
@@ -0,0 +1,260 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+/**
+ * @file ebr.c
+ *
+ * Implementation of the epoch-based reclamation
+ *
+ * A thread takes a record the first time it uses the domain and gives it
+ * back when it exits (destructor of the key of the domain): its objects
+ * not yet released go to the orphans. The records are never released
+ * before the domain, so the list of the records is only ever prepended.
+ *
+ * Every EBR_RETIRE_SCAN objects retired, a thread tries to advance the
+ * global epoch and releases its objects (and the orphans) old enough.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "ebr.h"
+
+
+/************************** utility functions ************************/
+
+static void releaseList( NodeE_t* node ){
+    while(node != NULL){
+        NodeE_t* next = node->next;
+        node->release(node);
+        node = next;
+    }
+}
+
+/**
+* the thread that owned the record has exited: its objects go to the
+* orphans and the record can be taken by another thread
+*/
+static void exitThread( void* arg ){
+    EbrThread_t* t = (EbrThread_t *) arg;
+    Ebr_t* e = t->domain;
+    __atomic_store_n(&t->epoch, 0, __ATOMIC_RELEASE);
+    t->nest = 0;
+    if(t->retired != NULL){
+        NodeE_t* last = t->retired;
+        while(last->next != NULL) last = last->next;
+        pthread_mutex_lock(&e->lock);
+        last->next = e->orphans;
+        e->orphans = t->retired;
+        pthread_mutex_unlock(&e->lock);
+        t->retired = NULL;
+        t->n_retired = 0;
+    }
+    __atomic_store_n(&t->used, 0, __ATOMIC_RELEASE);
+}
+
+/**
+* @returns : the record of the calling thread, taken at its first use
+*/
+static EbrThread_t* threadEbr( Ebr_t* e ){
+    EbrThread_t* t = (EbrThread_t *) pthread_getspecific(e->key);
+    if(t != NULL) return t;
+
+    // a record left by a thread that has exited
+    for(t = __atomic_load_n(&e->threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next){
+        int expected = 0;
+        if(__atomic_load_n(&t->used, __ATOMIC_RELAXED) == 0 &&
+                __atomic_compare_exchange_n(&t->used, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+    if(t == NULL){
+        void* p = NULL;
+        if(posix_memalign(&p, EBR_LINE, sizeof(EbrThread_t)) != 0)
+            goto fatal;
+        t = (EbrThread_t *) p;
+        memset(t, 0, sizeof(EbrThread_t));
+        t->used = 1;
+        t->domain = e;
+        t->next = __atomic_load_n(&e->threads, __ATOMIC_RELAXED);
+        while(!__atomic_compare_exchange_n(&e->threads, &t->next, t, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    if(pthread_setspecific(e->key, t) == 0)
+        return t;
+
+    fatal:
+    // without a record the thread could read released objects
+    fprintf(stderr, "FATAL ERROR: record of the epochs\n");
+    pthread_exit((void*) EXIT_FAILURE);
+}
+
+/**
+* advances the global epoch if all the threads inside a read section have seen it
+*
+* @returns : the global epoch
+*/
+static uint64_t advanceEbr( Ebr_t* e ){
+    uint64_t g = __atomic_load_n(&e->epoch, __ATOMIC_SEQ_CST);
+    EbrThread_t* t;
+    for(t = __atomic_load_n(&e->threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next){
+        uint64_t v = __atomic_load_n(&t->epoch, __ATOMIC_SEQ_CST);
+        if((v & 1) && (v >> 1) != g)
+            return g;
+    }
+    if(__atomic_compare_exchange_n(&e->epoch, &g, g + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        return g + 1;
+    // advanced by another thread
+    return g;
+}
+
+/**
+* releases the objects of the thread and the orphans retired at least two epochs ago
+*/
+static void reclaimThread( Ebr_t* e, EbrThread_t* t ){
+    NodeE_t *old = NULL, *keep = NULL, *node, *next;
+    uint64_t g;
+
+    // a second step is often possible at once: the readers are short
+    advanceEbr(e);
+    g = advanceEbr(e);
+    if(t != NULL){
+        // newest first: the objects old enough are at the end
+        NodeE_t** p = &t->retired;
+        while(*p != NULL && (*p)->epoch + 2 > g) p = &(*p)->next;
+        old = *p;
+        *p = NULL;
+        t->n_retired = 0;
+        releaseList(old);
+    }
+    if(pthread_mutex_trylock(&e->lock) == 0){
+        old = NULL;
+        for(node = e->orphans; node != NULL; node = next){
+            next = node->next;
+            if(node->epoch + 2 <= g){
+                node->next = old;
+                old = node;
+            }else{
+                node->next = keep;
+                keep = node;
+            }
+        }
+        e->orphans = keep;
+        pthread_mutex_unlock(&e->lock);
+        releaseList(old);
+    }
+}
+
+
+/************************** epoch reclamation ************************/
+
+/**
+* @returns : the domain, NULL on failure and errno is set
+*/
+Ebr_t* initEbr( void ){
+    Ebr_t* e = calloc(1, sizeof(Ebr_t));
+    if(!e) return NULL;
+    if((errno = pthread_mutex_init(&e->lock, NULL)) != 0){
+        free(e);
+        return NULL;
+    }
+    if((errno = pthread_key_create(&e->key, exitThread)) != 0){
+        pthread_mutex_destroy(&e->lock);
+        free(e);
+        return NULL;
+    }
+    return e;
+}
+
+/**
+* releases all the objects retired: no thread must be inside a read section
+*/
+void deleteEbr( Ebr_t* e ){
+    if(!e) return;
+    // the threads still running will not give back their records
+    pthread_key_delete(e->key);
+    EbrThread_t* t = e->threads;
+    while(t != NULL){
+        EbrThread_t* next = t->next;
+        releaseList(t->retired);
+        free(t);
+        t = next;
+    }
+    releaseList(e->orphans);
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+/**
+* enters a read section: the objects reached until the matching exitEbr
+* are not released. The sections can be nested
+*/
+void enterEbr( Ebr_t* e ){
+    if(!e) return;
+    EbrThread_t* t = threadEbr(e);
+    if(t->nest++ == 0){
+        uint64_t g = __atomic_load_n(&e->epoch, __ATOMIC_ACQUIRE);
+        // exchange, not store: the reads of the section must not move
+        // before the epoch is published
+        __atomic_exchange_n(&t->epoch, (g << 1) | 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void exitEbr( Ebr_t* e ){
+    if(!e) return;
+    EbrThread_t* t = (EbrThread_t *) pthread_getspecific(e->key);
+    if(t == NULL || t->nest == 0) return;
+    if(--t->nest == 0)
+        __atomic_store_n(&t->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+* the object that contains 'node', already removed from the structure,
+* is released with 'release' once no thread can still be reading it
+*/
+void retireEbr( Ebr_t* e, NodeE_t* node, void (*release)( NodeE_t* ) ){
+    if(!e || !node || !release) return;
+    EbrThread_t* t = threadEbr(e);
+    node->release = release;
+    node->epoch = __atomic_load_n(&e->epoch, __ATOMIC_SEQ_CST);
+    node->next = t->retired;
+    t->retired = node;
+    if(++t->n_retired >= EBR_RETIRE_SCAN)
+        reclaimThread(e, t);
+}
+
+/**
+* releases the objects of the calling thread (and the orphans) that no
+* thread can still be reading
+*/
+void reclaimEbr( Ebr_t* e ){
+    if(!e) return;
+    reclaimThread(e, (EbrThread_t *) pthread_getspecific(e->key));
+}
@@ -35,7 +35,8 @@
 
 // TODO: riguardare tutte le funzioni : la parte di ritorno di ogni funzione
 
-#define _POSIX_C_SOURCE  200112L  // needed for S_ISSOCK
+#define _POSIX_C_SOURCE  200809L  // needed for S_ISSOCK and strdup
+#define _GNU_SOURCE               // needed for MAP_ANONYMOUS and MSG_CMSG_CLOEXEC
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -55,6 +56,8 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 
@@ -65,6 +68,7 @@
 #include "communication.h"
 #include "read_write_file.h"
 #include "utils.h"
+#include "shmring.h"
 
 extern char* rindex(const char*, int);
 
@@ -72,14 +76,122 @@ extern char* rindex(const char*, int);
 #define PRINT_INFORMATION
 #define PRINT_REASON
 
-static int fd_sock;
-static struct sockaddr_un serv_addr;
-static int operation = -1;
-static int result = -1;
 long bytes_read;
 long bytes_write;
 
+// request sent to the server whose reply has not yet been read
+typedef struct _pending_t {
+    int op;
+    char* pathname;
+    char* dirname;
+} pending_t;
 
+/**
+* connection with the server: everything a request needs is here, so that
+*   each handle can be used by its own thread
+*
+* - fd_sock, serv_addr : the socket and the address of the server
+* - operation, result : the last request sent and the result received
+* - pending, pipe_* : circular queue of the replies to read when the
+*   pipeline is active (pipe_window == 0 if it is not)
+* - shm : shared-memory rings with the server, NULL if not available
+*/
+struct _fss_conn {
+    int                 fd_sock;
+    struct sockaddr_un  serv_addr;
+    int                 operation;
+    int                 result;
+    pending_t*          pending;
+    int                 pipe_window;
+    int                 pipe_head;
+    int                 pipe_count;
+    int                 pipe_failed;
+    ShmRing_t*          shm;
+};
+
+// connection used by the functions without a handle
+static fss_conn conn_default = { -1, { 0 }, -1, -1, NULL, 0, 0, 0, 0, NULL };
+
+static int recv_reply_open( fss_conn* c, const char* pathname );
+static int readn_fd( long fd, void* buf, size_t size, int* rfd );
+
+/**
+* sends a request to the server with a single system call: the operation
+*   followed by the fields that are not NULL, in the order expected by the server
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*/
+static int send_request( fss_conn* c, int op, int* arg, const char* pathname, size_t* sz_p, void* data, size_t* sz_d ){
+    struct iovec iov[6];
+    int n = 0;
+    int in_shm = 0;
+
+    c->operation = op;
+    // the large contents go in the request ring, if there is room
+    if(c->shm && sz_d && *sz_d >= SHM_RING_MIN && putShmRing(c->shm, SHM_RING_REQUEST, data, *sz_d) == 0){
+        in_shm = 1;
+        op |= _SHM_F;
+    }
+    iov[n].iov_base = (void *) &op;
+    iov[n++].iov_len = sizeof(int);
+    if(arg){
+        iov[n].iov_base = (void *) arg;
+        iov[n++].iov_len = sizeof(int);
+    }
+    if(sz_p){
+        iov[n].iov_base = (void *) sz_p;
+        iov[n++].iov_len = sizeof(size_t);
+        iov[n].iov_base = (void *) pathname;
+        iov[n++].iov_len = *sz_p;
+    }
+    if(sz_d){
+        iov[n].iov_base = (void *) sz_d;
+        iov[n++].iov_len = sizeof(size_t);
+        if(!in_shm){
+            iov[n].iov_base = data;
+            iov[n++].iov_len = *sz_d;
+        }
+    }
+    if(writevn(c->fd_sock, iov, n) == -1) return -1;
+    return 0;
+}
+static int recv_reply_write( fss_conn* c, const char* pathname, const char* dirname );
+
+/**
+* asks the server for the shared-memory rings of the connection and maps
+*   them from the memfd it passes: if the server does not offer them, the
+*   contents keep going through the socket
+*
+* @returns : 0 if the rings are available
+*            -1 otherwise
+*/
+static int setup_shm( fss_conn* c ){
+    int mode = DATA_IN_LINE;
+    int fd = -1;
+    size_t size = 0;
+
+    c->operation = _SHM_O;
+    if((writen(c->fd_sock, (void *) &c->operation, sizeof(int))) == -1) return -1;
+
+    c->result = -1;
+    if((readn(c->fd_sock, (void *) &c->result, sizeof(int))) == -1) return -1;
+    if(c->result != SUCCESS_O){
+        // the reason is not printed: the rings are disabled by default
+        char* reason = NULL;
+        if(read_reason(c->fd_sock, &reason) == 0) free(reason);
+        return -1;
+    }
+
+    if(readn_fd(c->fd_sock, &mode, sizeof(int), &fd) <= 0) return -1;
+    if(readn(c->fd_sock, &size, sizeof(size_t)) <= 0 || mode != DATA_IN_FD || fd < 0){
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    // the rings keep the descriptor (closed by deleteShmRing)
+    c->shm = mapShmRing(fd);
+    return (c->shm) ? 0 : -1;
+}
 
 /**
 * An AF_UNIX connection is opened to the socket file sockname
@@ -96,19 +208,19 @@ long bytes_write;
 *   EINVAL => in case of invalid parameter
 *   ETIME => in case of timer expired
 */
-int openConnection( const char* sockname, int msec,
+static int open_conn( fss_conn* c, const char* sockname, int msec,
                                         const struct timespec abstime ){
     if(!sockname || (msec < 0)){
         errno = EINVAL;
         return -1;
     }
 
-    if((fd_sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    if((c->fd_sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
         return -1;
 
-    memset(&serv_addr, '0', sizeof(serv_addr));
-    serv_addr.sun_family = AF_UNIX;
-    strncpy(serv_addr.sun_path, sockname, strlen(sockname)+1);
+    memset(&c->serv_addr, '0', sizeof(c->serv_addr));
+    c->serv_addr.sun_family = AF_UNIX;
+    strncpy(c->serv_addr.sun_path, sockname, strlen(sockname)+1);
 
     struct timespec time_sleep;
     time_sleep.tv_sec = 0;
@@ -121,9 +233,12 @@ int openConnection( const char* sockname, int msec,
     memset(&current_time, '0', sizeof(current_time));
 
     do{
-        if(connect(fd_sock, (struct sockaddr*) &serv_addr,
-                                        sizeof(serv_addr)) != -1)
+        if(connect(c->fd_sock, (struct sockaddr*) &c->serv_addr,
+                                        sizeof(c->serv_addr)) != -1){
+            // the rings are an optimization: without them the client works as usual
+            setup_shm(c);
             return 0;
+        }
 
         nanosleep(&time_sleep, &time_request);
 
@@ -155,7 +270,7 @@ int openConnection( const char* sockname, int msec,
 * errno :
 *   EINVAL => in case of invalid parameter
 */
-int closeConnection( const char* sockname ){
+static int close_conn( fss_conn* c, const char* sockname ){
     if(!sockname){
         #ifdef PRINT_INFORMATION
             fprintf(stderr, "Information: close connection operation failed, reason: wrong socket name\n");
@@ -164,27 +279,23 @@ int closeConnection( const char* sockname ){
         return -1;
     }
 
-    if(strncmp(serv_addr.sun_path, sockname, strlen(sockname)+1) ==  0){
-        operation = _CC_O;
+    if(strncmp(c->serv_addr.sun_path, sockname, strlen(sockname)+1) ==  0){
+        deleteShmRing(c->shm);
+        c->shm = NULL;
+        c->operation = _CC_O;
         // I write the operation to do
-        if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
+        if((writen(c->fd_sock, (void *) &c->operation, sizeof(int))) == -1){
             return -1;
         }
 
         /* receiving the response to the 'closeConnection' request to the server */
-        result = -1;
+        c->result = -1;
 
-        if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
+        if((readn(c->fd_sock, (void *) &c->result, sizeof(int))) == -1){
             return -1;
         }
 
-        if( result == SUCCESS_O){
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information:the connection was successfully closed!\n");
-            #endif
-            errno = EFAULT;
-            return -1;
-        }else{
+        if( c->result != SUCCESS_O){
             #ifdef PRINT_INFORMATION
                 fprintf(stderr, "Information: close connection operation failed!\n");
             #endif
@@ -192,7 +303,13 @@ int closeConnection( const char* sockname ){
             return -1;
         }
 
-        return close(fd_sock);
+        #ifdef PRINT_INFORMATION
+            fprintf(stderr, "Information:the connection was successfully closed!\n");
+        #endif
+        // the descriptor is released even if close fails
+        int err = close(c->fd_sock);
+        c->fd_sock = -1;
+        return err;
     }else{
         #ifdef PRINT_INFORMATION
             fprintf(stderr, "Information: close connection operation failed, reason: wrong socket name\n");
@@ -202,906 +319,154 @@ int closeConnection( const char* sockname ){
     }
 }
 
+int openConnection( const char* sockname, int msec,
+                                        const struct timespec abstime ){
+    return open_conn(&conn_default, sockname, msec, abstime);
+}
+
+int closeConnection( const char* sockname ){
+    return close_conn(&conn_default, sockname);
+}
+
 /**
-* API function that allows the client to ask the server
-*       to create or open a file
-*
+* opens a new connection with the server, independent of the others and of
+*   the one used by the functions without a handle: each handle can be
+*   used by its own thread, but a handle must not be shared between threads
 *
+* @returns : the handle of the connection
+*            NULL if the request fails and errno is set (as openConnection)
+*/
+fss_conn* fss_openConnection( const char* sockname, int msec,
+                                        const struct timespec abstime ){
+    fss_conn* c = (fss_conn *) malloc(sizeof(fss_conn));
+    if(!c) return NULL;
+    memset(c, 0, sizeof(fss_conn));
+    c->fd_sock = -1;
+    c->operation = -1;
+    c->result = -1;
+    if(open_conn(c, sockname, msec, abstime) == -1){
+        int err = errno;
+        if(c->fd_sock != -1) close(c->fd_sock);
+        free(c);
+        errno = err;
+        return NULL;
+    }
+    return c;
+}
+
+/**
+* closes the connection of the handle and releases it, the replies of a
+*   pipeline still active are read first
 *
-* @returns : 0 if successful
-*            -1 if the request fails and errno is set
-*
-* errno :
-*   EINVAL => in case of invalid parameter
-*   EACCES => in case of an error response from the server
+* @returns : 0 if the server closed the connection
+*            -1 otherwise
 */
-int openFile( const char* pathname, int flags ){
-    if(!pathname){
+int fss_closeConnection( fss_conn* c ){
+    if(!c){
         errno = EINVAL;
         return -1;
     }
+    fss_endPipeline(c);
+    int err = close_conn(c, c->serv_addr.sun_path);
+    // the socket is still open if the server did not confirm
+    if(c->fd_sock != -1) close(c->fd_sock);
+    free(c);
+    return err;
+}
 
-    switch( flags ){
-        case O_CREATE:{
-            #ifdef PRINT_INFORMATION
-                //fprintf(stdout, "Information: open file operation with flag 'O_CREATE'\n");
-            #endif
-            break;
-        }
-        case O_LOCK:{
-            #ifdef PRINT_INFORMATION
-                //fprintf(stdout, "Information: open file operation with flag 'O_LOCK'\n");
-            #endif
+/**
+* reads the reply to a request sent while the pipeline was active
+*
+* @returns : 0 if the request was successful, -1 otherwise
+*/
+static int recv_pending_reply( fss_conn* c ){
+    pending_t* p = &c->pending[c->pipe_head];
+    int err = -1;
+    switch(p->op){
+        case _OF_O:{
+            err = recv_reply_open(c, p->pathname);
             break;
         }
-        case O_CREATE_LOCK:{
-            #ifdef PRINT_INFORMATION
-                //fprintf(stdout, "Information: open file operation with flag 'O_CREATE_LOCK'\n");
-            #endif
+        case _WF_O:{
+            err = recv_reply_write(c, p->pathname, p->dirname);
             break;
         }
-        default:{
-            #ifdef PRINT_INFORMATION
-                //fprintf(stderr, "Information: open file operation failed, reason: invalid opening flag (%d)\n", flags);
-            #endif
-            errno = EOPNOTSUPP;
-            return -1;
-        }
-    }
-
-    size_t sz_p = strlen(pathname)+1;
-    if(sz_p <= 1){
-        errno = EINVAL;
-        return -1;
-    }
-
-    /******* sending the 'openFile' request to the server ******/
-
-    operation = _OF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    // I specify the type of operation to be done
-    if((writen(fd_sock, (void *) &flags, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if(sz_p <= 0){
-        errno = EFAULT;
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }
-
-    /*** receiving the response to the 'open File' request to the server ***/
-
-    result = -1;
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if(result == FAILED_O){
-        char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
-            return -1;
-        }
-
-        #ifdef PRINT_REASON
-            fprintf(stderr, "Information: open file operation failed, reason: %s\n", reason);
-        #endif
-
-        free(reason);
-        errno = EACCES;
-        return -1;
-    }
-
-    return 0;
-
-}
-
-int readFile( const char* pathname, void** buf, size_t* size ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _RF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /************* sending the 'readFile' request to the server ************/
-    size_t sz_p = strlen(pathname)+1;
-    if(sz_p <= 1){
-        buf = NULL;
-        *size = 0;
-        errno = EFAULT;
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        *buf = NULL;
-        *size = 0;
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        *buf = NULL;
-        *size = 0;
-        return -1;
-    }
-
-    /***** receiving the response to the 'readFile' request to the server *****/
-    result = -1;
-
-    if((readn(fd_sock, &result, sizeof(int))) == -1){
-        *buf = NULL;
-        *size = 0;
-        return -1;
     }
-    if(result == SUCCESS_O){
-        if((readn(fd_sock, (void *) size, sizeof(size_t))) == -1){
-            *buf = NULL;
-            *size = 0;
-            return -1;
-        }
-
-        *buf = malloc(*size);
-        memset(*buf, '\0', *size);
-        if((readn(fd_sock, (void *) *buf, *size)) == -1){
-            *buf = NULL;
-            *size = 0;
-            return -1;
-        }
-
-    }else{
-        *buf = NULL;
-        *size = 0;
-        char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
-            return -1;
-        }
-
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to read file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        return -1;
+    if(err == -1){
+        fprintf(stderr, "ERROR: Request on file '%s' failed\n", p->pathname);
+        c->pipe_failed = 1;
     }
-
-    return 0;
+    free(p->pathname);
+    if(p->dirname) free(p->dirname);
+    c->pipe_head = (c->pipe_head + 1) % c->pipe_window;
+    c->pipe_count--;
+    return err;
 }
 
-int readNFile( int N, const char* dirname ){
-    /* sending the 'readNFile' request to the server */
-    /* receiving the response to the 'readNFile' request to the server */
-    if(!dirname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _RNF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &N, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /***** receiving the response to the 'readFile' request to the server *****/
-    int n = 0;
-
-    if((readn(fd_sock, &n, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if(n <= 0){
-        char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
-            return -1;
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to read file: %s\n", reason);
-            }
-        #endif
-    }else{
-            char* path_r   = NULL;
-            void* data_r   = NULL;
-            size_t sz_pr   = 0;
-            size_t sz_dr   = 0;
-            int fin = 0;
-            int i = 0;
-            while(i < n){
-                if((readn(fd_sock, (void *) &fin, sizeof(int))) == -1){
-                    return -1;
-                }
-                if(fin) break;
-
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
-                    return -1;
-                }
-
-                path_r = (char *) malloc(sz_pr);
-                memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
-                    if(path_r) free(path_r);
-                    return -1;
-                }
-
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
-                    return -1;
-                }
-
-                data_r = (void *) malloc(sz_dr);
-                memset(data_r, '0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_dr)) == -1){
-                    if(path_r) free(path_r);
-                    if(data_r) free(data_r);
-                    return -1;
-                }
-
-                char* p = NULL;
-                p = getNameFile(path_r);
-                if(p == NULL){
-                    continue;
-                }
-                char* final_p = NULL;
-                final_p = setNameFile(dirname, p);
-                if(write_file(final_p, data_r, sz_dr) == -1){
-
-                }
-                if(final_p) free(final_p);
-                if(path_r) free(path_r);
-                if(data_r) free(data_r);
-
-                i++;
-            }
-    }
-
-    return 0;
-}
-
-int writeFile( const char* pathname, const char* dirname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    size_t sz_p = strlen(pathname)+1;
-    if(sz_p <= 1){
-        errno = EFAULT;
-        return -1;
-    }
-    char *data = NULL;
-    size_t sz_d = 0;
-    if(read_file(pathname, (void **) &data, &sz_d, O_RDONLY) <= 0){
-        if(data) free(data);
-        return -1;
-    }
-
-    if(sz_d <= 0){
-        return -1;
-    }
-
-    operation = _WF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'writeFile' request to the server */
-    if((write_pathname(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }
-    /*if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }*/
-
-    if((write_data(fd_sock, (void *) data, sz_d)) == -1){
-        return -1;
-    }
-
-    /*if((writen(fd_sock, (void *) &sz_d, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) data, sz_d)) == -1){
-        return -1;
-    }*/
-
-    if(data) free(data);
-
-    /* receiving the response to the 'writeFile' request to the server */
-    result = -1;
-
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if(result == SUCCESS_O){
-        int N = 0;
-
-        if((readn(fd_sock, (void *) &N, sizeof(int))) == -1){
-            return -1;
-        }
-        if(N > 0){
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information: the write file operation caused the removal of '%d' files from the server.\n", N);
-            #endif
-            char* path_r   = NULL;
-            char* data_r   = NULL;
-            size_t sz_pr   = 0;
-            size_t sz_dr   = 0;
-
-            for(int i=0; i<N; i++){
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
-                    return -1;
-                }
-                path_r = malloc(sz_pr);
-                memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
-                    free(path_r);
-                    return -1;
-                }
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
-                    free(path_r);
-                    return -1;
-                }
-                data_r = malloc(sz_dr);
-                memset(data_r, '\0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_pr)) == -1){
-                    free(path_r);
-                    free(data_r);
-                    return -1;
-                }
-
-                char* p = getNameFile(path_r);
-                char* f = (char *) malloc(STR_LEN * sizeof(char));
-                memset(f, '\0', STR_LEN);
-                strncpy(f, dirname, STR_LEN-1);
-                strncat(f, "/", 2);
-                strncat(f, p, STR_LEN);
-                write_file(f, data_r, sz_dr);
-                free(path_r);
-                free(data_r);
-                free(p);
-                free(f);
-            }
-        }
-    }else{
-        char* reason = NULL;
-        size_t sz_r  = 0;
-        if((readn(fd_sock, &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        // errno da settare qua
-        return -1;
-    }
-
-    return 0;
-}
-
-int appendToFile( const char* pathname, void* buf, size_t size, const char* dirname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _ATF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'writeFile' request to the server */
-    size_t sz_p = strlen(pathname)+1;
-    if(sz_p <= 1){
-        errno = EFAULT;
-        return -1;
-    }
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) &size, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) buf, size)) == -1){
-        return -1;
-    }
-
-    /* receiving the response to the 'writeFile' request to the server */
-    result = -1;
-
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if(result == SUCCESS_O){
-        int N = 0;
-
-        if((readn(fd_sock, (void *) &N, sizeof(int))) == -1){
-            return -1;
-        }
-        if(N > 0){
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information: the write file operation caused the removal of '%d' files from the server.\n", N);
-            #endif
-            char* path_r   = NULL;
-            char* data_r   = NULL;
-            size_t sz_pr   = 0;
-            size_t sz_dr   = 0;
-
-            for(int i=0; i<N; i++){
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
-                    return -1;
-                }
-                path_r = malloc(sz_pr);
-                memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
-                    free(path_r);
-                    return -1;
-                }
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
-                    free(path_r);
-                    return -1;
-                }
-                data_r = malloc(sz_dr);
-                memset(data_r, '\0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_pr)) == -1){
-                    free(path_r);
-                    free(data_r);
-                    return -1;
-                }
-
-                char* p = getNameFile(path_r);
-                char* f = (char *) malloc(STR_LEN * sizeof(char));
-                memset(f, '\0', STR_LEN);
-                strncpy(f, dirname, STR_LEN-1);
-                strncat(f, "/", 2);
-                strncat(f, p, STR_LEN);
-                write_file(f, data_r, sz_dr);
-                free(path_r);
-                free(data_r);
-                free(p);
-                free(f);
-            }
-        }
-    }else{
-        char* reason = NULL;
-        size_t sz_r  = 0;
-        if((readn(fd_sock, &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-            if(reason) free(reason);
-        // errno da settare qua
-        return -1;
-    }
-
-    return 0;
-}
-
-int lockFile( const char* pathname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _LF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'lockFile' request to the server */
-    size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
-    }
-
-    /* receiving the response to the 'lockFile' request from the server */
-    int result = 0;
-    char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
-
-    }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
-
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        return -1;
-    }
-
-    return 0;
-}
-
-int unlockFile( const char* pathname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _UF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'unlockFile' request to the server */
-    size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
-    }
-
-    /* receiving the response to the 'unlockFile' request from the server */
-    int result = 0;
-    char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
-
-    }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
-
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        return -1;
-    }
-
-    return 0;
-}
-
-int closeFile( const char* pathname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _CF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'closeFile' request to the server */
-    size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
-    }
-
-    /* receiving the response to the 'closeFile' request to the server */
-    int result = 0;
-    char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
-
-    }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
-
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        return -1;
-    }
-
-    return 0;
-}
-
-int removeFile( const char* pathname ){
-    if(!pathname){
-        errno = EINVAL;
-        return -1;
-    }
-
-    operation = _RFI_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'removeFile' request to the server */
-    size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-        return -1;
-    }
-
-    /* receiving the response to the 'removeFile' request from the server */
-    int result = 0;
-    char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
-        return -1;
-    }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
-            if(reason) free(reason);
-            return -1;
-        }
-        #ifdef PRINT_REASON
-            if(reason != NULL){
-                fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
-            }
-        #endif
-        if(reason) free(reason);
-        return -1;
-    }
-
-    return 0;
-}
-/*
-* MIT License
-*
-* Copyright (c) 2021 Adrien Koumgang Tegantchouang
-*
-* Permission is hereby granted, free of charge, to any person obtaining a copy
-* of this software and associated documentation files (the "Software"), to deal
-* in the Software without restriction, including without limitation the rights
-* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-* copies of the Software, and to permit persons to whom the Software is
-* furnished to do so, subject to the following conditions:
-*
-* The above copyright notice and this permission notice shall be included in all
-* copies or substantial portions of the Software.
-*
-* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-* SOFTWARE.
-*/
-
-/**
-* @file interface.c
-*
-* definition of utility functions for client
-*
-* @author adrien koumgang tegantchouang
-* @version 1.0
-* @date 00/05/2021
-*/
-
-
-// TODO: riguardare tutte le funzioni : la parte di ritorno di ogni funzione
-
-#define _POSIX_C_SOURCE  200112L  // needed for S_ISSOCK
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <ctype.h>
-#include <stdarg.h>
-#include <dirent.h>
-#include <time.h>
-#include <fcntl.h>
-#include <errno.h>
-
-#include <pwd.h>
-#include <grp.h>
-#include <stddef.h>
-
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <sys/un.h>
-#include <sys/stat.h>
-#include <sys/time.h>
-
-#include <assert.h>
-
-//#include "utils.h"
-#include "interface.h"
-#include "communication.h"
-#include "read_write_file.h"
-#include "utils.h"
-
-extern char* rindex(const char*, int);
-
-#define PRINT_OPERATION
-#define PRINT_INFORMATION
-#define PRINT_REASON
-
-static int fd_sock;
-static struct sockaddr_un serv_addr;
-static int operation = -1;
-static int result = -1;
-long bytes_read;
-long bytes_write;
-
-
-
 /**
-* An AF_UNIX connection is opened to the socket file sockname
-*
-* @param sockname : name of the socket to connect to
-* @param msec : time to repeat to retry the connection with
-*                       the server if it fails
-* @param abstime : time until you try to connect to the server
-*
-* @returns : 0 if successful
-*            -1 if the request fails and errno is set
+* remembers the reply to be read for a request already sent: if the window
+*   is full, the reply of the oldest request is read first
 *
-* errno :
-*   EINVAL => in case of invalid parameter
-*   ETIME => in case of timer expired
-*/
-int openConnection( const char* sockname, int msec,
-                                        const struct timespec abstime ){
-    if(!sockname || (msec < 0)){
-        errno = EINVAL;
-        return -1;
-    }
-
-    if((fd_sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
-        return -1;
-
-    memset(&serv_addr, '0', sizeof(serv_addr));
-    serv_addr.sun_family = AF_UNIX;
-    strncpy(serv_addr.sun_path, sockname, strlen(sockname)+1);
-
-    struct timespec time_sleep;
-    time_sleep.tv_sec = 0;
-    time_sleep.tv_nsec = msec * 1000000;
-    struct timespec time_request;
-    time_request.tv_sec = 0;
-    time_request.tv_nsec = msec * 1000000;
-
-    struct timespec current_time;
-    memset(&current_time, '0', sizeof(current_time));
-
-    do{
-        if(connect(fd_sock, (struct sockaddr*) &serv_addr,
-                                        sizeof(serv_addr)) != -1)
-            return 0;
-
-        nanosleep(&time_sleep, &time_request);
-
-        if(clock_gettime(CLOCK_REALTIME, &current_time) == -1){
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information: open connection operation failed, reason: problem in calculating the current time (clock_gettime)\n");
-            #endif
-            return -1;
-        }
-
-    }while(current_time.tv_sec < abstime.tv_sec ||
-        current_time.tv_nsec < abstime.tv_nsec);
-
-    #ifdef PRINT_INFORMATION
-        fprintf(stderr, "Information: open connection operation failed, reason: connection test time passed\n");
-    #endif
-    errno =  ETIME;
-    return -1;
-}
-
-/**
-* closes the established connection between the client and the server
-*
-* @params sockname : the name of the socket on which the client was connected
-*
-* @returns : 0 if successful
-*            -1 if the request fails and errno is set
-*
-* errno :
-*   EINVAL => in case of invalid parameter
-*/
-int closeConnection( const char* sockname ){
-    if(!sockname){
-        #ifdef PRINT_INFORMATION
-            fprintf(stderr, "Information: close connection operation failed, reason: wrong socket name\n");
-        #endif
-        errno = EINVAL;
-        return -1;
-    }
-
-    if(strncmp(serv_addr.sun_path, sockname, strlen(sockname)+1) ==  0){
-        operation = _CC_O;
-        // I write the operation to do
-        if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-            return -1;
-        }
-
-        /* receiving the response to the 'closeConnection' request to the server */
-        result = -1;
-
-        if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
-            return -1;
-        }
-
-        if( result == SUCCESS_O){
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information:the connection was successfully closed!\n");
-            #endif
-            errno = EFAULT;
-            return -1;
-        }else{
-            #ifdef PRINT_INFORMATION
-                fprintf(stderr, "Information: close connection operation failed!\n");
-            #endif
-            errno = EFAULT;
-            return -1;
-        }
+* @returns : 0 if successful
+*            -1 if the connection with the server failed
+*/
+static int defer_reply( fss_conn* c, int op, const char* pathname, const char* dirname ){
+    if(c->pipe_count == c->pipe_window){
+        if(recv_pending_reply(c) == -1 && (errno == EPIPE || errno == ECONNRESET)) return -1;
+    }
+    pending_t* p = &c->pending[(c->pipe_head + c->pipe_count) % c->pipe_window];
+    p->op = op;
+    p->pathname = strdup(pathname);
+    p->dirname = dirname ? strdup(dirname) : NULL;
+    c->pipe_count++;
+    return 0;
+}
 
-        return close(fd_sock);
-    }else{
-        #ifdef PRINT_INFORMATION
-            fprintf(stderr, "Information: close connection operation failed, reason: wrong socket name\n");
-        #endif
-        errno = EFAULT;
+/**
+* starts a pipeline: the following 'openFile' and 'writeFile' send their
+*   request without waiting for the reply of the server, until 'window'
+*   requests are waiting; the replies are read in the order of the requests
+*   (no other request can be done before 'endPipeline')
+*
+* @param window : maximum number of requests waiting for their reply
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*
+* errno :
+*   EINVAL => in case of invalid parameter
+*   EBUSY => if a pipeline is already active
+*/
+int fss_beginPipeline( fss_conn* c, int window ){
+    if(window <= 0){
+        errno = EINVAL;
+        return -1;
+    }
+    if(c->pipe_window > 0){
+        errno = EBUSY;
         return -1;
     }
+    if((c->pending = (pending_t *) malloc(window * sizeof(pending_t))) == NULL) return -1;
+    c->pipe_window = window;
+    c->pipe_head = 0;
+    c->pipe_count = 0;
+    c->pipe_failed = 0;
+    return 0;
+}
+
+/**
+* ends the pipeline, reading the replies of all the requests still waiting
+*
+* @returns : 0 if all the requests of the pipeline were successful
+*            -1 otherwise
+*/
+int fss_endPipeline( fss_conn* c ){
+    if(c->pipe_window == 0) return 0;
+    while(c->pipe_count > 0) recv_pending_reply(c);
+    free(c->pending);
+    c->pending = NULL;
+    c->pipe_window = 0;
+    return c->pipe_failed ? -1 : 0;
 }
 
 /**
@@ -1117,7 +482,7 @@ int closeConnection( const char* sockname ){
 *   EINVAL => in case of invalid parameter
 *   EACCES => in case of an error response from the server
 */
-int openFile( const char* pathname, int flags ){
+int fss_openFile( fss_conn* c, const char* pathname, int flags ){
     if(!pathname){
         errno = EINVAL;
         return -1;
@@ -1159,48 +524,32 @@ int openFile( const char* pathname, int flags ){
 
     /******* sending the 'openFile' request to the server ******/
 
-    operation = _OF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    // I specify the type of operation to be done
-    if((writen(fd_sock, (void *) &flags, sizeof(int))) == -1){
+    // the operation, the type of opening and the pathname
+    if(send_request(c, _OF_O, &flags, pathname, &sz_p, NULL, NULL) == -1){
         return -1;
     }
 
-    if(sz_p <= 0){
-        errno = EFAULT;
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }
+    if(c->pipe_window > 0) return defer_reply(c, _OF_O, pathname, NULL);
+    return recv_reply_open(c, pathname);
+}
 
+/**
+* receives the response to the 'openFile' request
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*/
+static int recv_reply_open( fss_conn* c, const char* pathname ){
     /*** receiving the response to the 'open File' request to the server ***/
 
-    result = -1;
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
+    c->result = -1;
+    if((readn(c->fd_sock, (void *) &c->result, sizeof(int))) == -1){
         return -1;
     }
 
-    if(result == FAILED_O){
+    if(c->result == FAILED_O){
         char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
+        if(read_reason(c->fd_sock, &reason) == -1){
             return -1;
         }
 
@@ -1217,50 +566,44 @@ int openFile( const char* pathname, int flags ){
 
 }
 
-int readFile( const char* pathname, void** buf, size_t* size ){
+int fss_readFile( fss_conn* c, const char* pathname, void** buf, size_t* size ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _RF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /************* sending the 'readFile' request to the server ************/
     size_t sz_p = strlen(pathname)+1;
     if(sz_p <= 1){
-        buf = NULL;
-        *size = 0;
-        errno = EFAULT;
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
         *buf = NULL;
         *size = 0;
+        errno = EFAULT;
         return -1;
     }
 
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
+    if(send_request(c, _RF_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
         *buf = NULL;
         *size = 0;
         return -1;
     }
 
     /***** receiving the response to the 'readFile' request to the server *****/
-    result = -1;
+    c->result = -1;
 
-    if((readn(fd_sock, &result, sizeof(int))) == -1){
+    if((readn(c->fd_sock, &c->result, sizeof(int))) == -1){
         *buf = NULL;
         *size = 0;
         return -1;
     }
-    if(result == SUCCESS_O){
-        if((readn(fd_sock, (void *) size, sizeof(size_t))) == -1){
+    if(c->result == SUCCESS_O){
+        // with the rings, the contents can be in the response ring
+        int mode = DATA_IN_LINE;
+        if(c->shm && (readn(c->fd_sock, (void *) &mode, sizeof(int))) == -1){
+            *buf = NULL;
+            *size = 0;
+            return -1;
+        }
+        if((readn(c->fd_sock, (void *) size, sizeof(size_t))) == -1){
             *buf = NULL;
             *size = 0;
             return -1;
@@ -1268,7 +611,14 @@ int readFile( const char* pathname, void** buf, size_t* size ){
 
         *buf = malloc(*size);
         memset(*buf, '\0', *size);
-        if((readn(fd_sock, (void *) *buf, *size)) == -1){
+        if(mode == DATA_IN_SHM){
+            if(takeShmRing(c->shm, SHM_RING_RESPONSE, *buf, *size) == -1){
+                free(*buf);
+                *buf = NULL;
+                *size = 0;
+                return -1;
+            }
+        }else if((readn(c->fd_sock, (void *) *buf, *size)) == -1){
             *buf = NULL;
             *size = 0;
             return -1;
@@ -1278,30 +628,187 @@ int readFile( const char* pathname, void** buf, size_t* size ){
         *buf = NULL;
         *size = 0;
         char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
+        if(read_reason(c->fd_sock, &reason) == -1){
             return -1;
         }
 
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
+        #ifdef PRINT_REASON
+            if(reason != NULL){
+                fprintf(stdout, "failure to read file '%s': %s\n", pathname, reason);
+            }
+        #endif
+        if(reason) free(reason);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+* reads 'size' bytes like readn, receiving the descriptor that the server
+*   may have attached to them (SCM_RIGHTS)
+*
+* @params rfd : the descriptor received, -1 if none
+*
+* @returns : like readn
+*/
+static int readn_fd( long fd, void* buf, size_t size, int* rfd ){
+    union {
+        char    buf[CMSG_SPACE(sizeof(int))];
+        size_t  align;
+    } ctl;
+    struct iovec iov = { buf, size };
+    struct msghdr msg;
+    ssize_t r;
+
+    *rfd = -1;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    while((r = recvmsg((int) fd, &msg, MSG_CMSG_CLOEXEC)) == -1){
+        if(errno != EINTR) return -1;
+    }
+    if(r == 0) return 0;   // EOF
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if(cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS){
+        memcpy(rfd, CMSG_DATA(cm), sizeof(int));
+    }
+    if((size_t) r < size && readn(fd, (char *) buf + r, size - r) <= 0){
+        if(*rfd >= 0) close(*rfd);
+        *rfd = -1;
+        return -1;
+    }
+    return size;
+}
+
+/**
+* receives the contents of a file of a mapped read: they are mapped from
+*   the memfd passed by the server, or read from the socket into an
+*   anonymous mapping; in both cases they are released with munmap
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*/
+static int recv_data_mapped( fss_conn* c, void** buf, size_t* size ){
+    int mode = DATA_IN_LINE;
+    int fd = -1;
+    *buf = NULL;
+    *size = 0;
+    if(readn_fd(c->fd_sock, &mode, sizeof(int), &fd) <= 0) return -1;
+    if(readn(c->fd_sock, size, sizeof(size_t)) <= 0){
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    if(*size == 0){
+        if(fd >= 0) close(fd);
+        return 0;
+    }
+
+    void* map = MAP_FAILED;
+    if(mode == DATA_IN_FD){
+        if(fd < 0){
+            errno = EPROTO;
+            return -1;
+        }
+        // the memfd is sealed: the contents cannot change under the mapping
+        map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED) return -1;
+    }else{
+        if(fd >= 0) close(fd);
+        map = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(map == MAP_FAILED) return -1;
+        if(readn(c->fd_sock, map, *size) <= 0){
+            munmap(map, *size);
             return -1;
         }
+    }
+    *buf = map;
+    return 0;
+}
+
+/**
+* API function that allows the client to read a file without receiving
+*   its contents through the socket: the server passes a sealed memfd
+*   that is mapped in read-only mode (the small files are received as usual)
+*
+* @params buf : the contents of the file, to release with 'releaseFileMapped'
+* @params size : the size of the file
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*
+* errno :
+*   EINVAL => in case of invalid parameter
+*   EACCES => in case of an error response from the server
+*/
+int fss_readFileMapped( fss_conn* c, const char* pathname, void** buf, size_t* size ){
+    if(!pathname || !buf || !size){
+        errno = EINVAL;
+        return -1;
+    }
+    *buf = NULL;
+    *size = 0;
+
+    size_t sz_p = strlen(pathname)+1;
+    if(sz_p <= 1){
+        errno = EINVAL;
+        return -1;
+    }
+    if(send_request(c, _RFM_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
+        return -1;
+    }
 
+    c->result = -1;
+    if((readn(c->fd_sock, &c->result, sizeof(int))) <= 0){
+        return -1;
+    }
+    if(c->result != SUCCESS_O){
+        char* reason = NULL;
+        if(read_reason(c->fd_sock, &reason) == -1){
+            return -1;
+        }
         #ifdef PRINT_REASON
             if(reason != NULL){
                 fprintf(stdout, "failure to read file '%s': %s\n", pathname, reason);
             }
         #endif
         if(reason) free(reason);
+        errno = EACCES;
         return -1;
     }
+    return recv_data_mapped(c, buf, size);
+}
 
-    return 0;
+/**
+* releases the contents returned by 'readFileMapped'
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*/
+int releaseFileMapped( void* buf, size_t size ){
+    if(!buf || size == 0) return 0;
+    return munmap(buf, size);
 }
 
-int readNFile( int N, const char* dirname ){
+static int read_n_files( fss_conn* c, int op, int N, const char* dirname );
+
+int fss_readNFile( fss_conn* c, int N, const char* dirname ){
+    return read_n_files(c, _RNF_O, N, dirname);
+}
+
+/**
+* like 'readNFile', but the contents of the large files are mapped from
+*   the memfds passed by the server instead of being received through
+*   the socket
+*/
+int fss_readNFileMapped( fss_conn* c, int N, const char* dirname ){
+    return read_n_files(c, _RNFM_O, N, dirname);
+}
+
+static int read_n_files( fss_conn* c, int op, int N, const char* dirname ){
     /* sending the 'readNFile' request to the server */
     /* receiving the response to the 'readNFile' request to the server */
     if(!dirname){
@@ -1309,34 +816,20 @@ int readNFile( int N, const char* dirname ){
         return -1;
     }
 
-    operation = _RNF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    if((writen(fd_sock, (void *) &N, sizeof(int))) == -1){
+    if(send_request(c, op, &N, NULL, NULL, NULL, NULL) == -1){
         return -1;
     }
 
     /***** receiving the response to the 'readFile' request to the server *****/
     int n = 0;
 
-    if((readn(fd_sock, &n, sizeof(int))) == -1){
+    if((readn(c->fd_sock, &n, sizeof(int))) == -1){
         return -1;
     }
 
     if(n <= 0){
         char* reason = NULL;
-        size_t sz_r = 0;
-        if((readn(fd_sock, (void *) &sz_r, sizeof(size_t))) == -1){
-            return -1;
-        }
-
-        reason = (char *) malloc(sz_r);
-        memset(reason, '\0', sz_r);
-        if((readn(fd_sock, (void *) reason, sz_r)) == -1){
+        if(read_reason(c->fd_sock, &reason) == -1){
             return -1;
         }
         #ifdef PRINT_REASON
@@ -1344,6 +837,7 @@ int readNFile( int N, const char* dirname ){
                 fprintf(stdout, "failure to read file: %s\n", reason);
             }
         #endif
+        free(reason);
     }else{
             char* path_r   = NULL;
             void* data_r   = NULL;
@@ -1352,32 +846,39 @@ int readNFile( int N, const char* dirname ){
             int fin = 0;
             int i = 0;
             while(i < n){
-                if((readn(fd_sock, (void *) &fin, sizeof(int))) == -1){
+                if((readn(c->fd_sock, (void *) &fin, sizeof(int))) == -1){
                     return -1;
                 }
                 if(fin) break;
 
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
+                if((readn(c->fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
                     return -1;
                 }
 
                 path_r = (char *) malloc(sz_pr);
                 memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
+                if((readn(c->fd_sock, (void *) path_r, sz_pr)) == -1){
                     if(path_r) free(path_r);
                     return -1;
                 }
 
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
-                    return -1;
-                }
-
-                data_r = (void *) malloc(sz_dr);
-                memset(data_r, '0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_dr)) == -1){
-                    if(path_r) free(path_r);
-                    if(data_r) free(data_r);
-                    return -1;
+                if(op == _RNFM_O){
+                    if(recv_data_mapped(c, &data_r, &sz_dr) == -1){
+                        if(path_r) free(path_r);
+                        return -1;
+                    }
+                }else{
+                    if((readn(c->fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
+                        return -1;
+                    }
+
+                    data_r = (void *) malloc(sz_dr);
+                    memset(data_r, '0', sz_dr);
+                    if((readn(c->fd_sock, (void *) data_r, sz_dr)) == -1){
+                        if(path_r) free(path_r);
+                        if(data_r) free(data_r);
+                        return -1;
+                    }
                 }
 
                 char* p = NULL;
@@ -1392,7 +893,8 @@ int readNFile( int N, const char* dirname ){
                 }
                 if(final_p) free(final_p);
                 if(path_r) free(path_r);
-                if(data_r) free(data_r);
+                if(op == _RNFM_O) releaseFileMapped(data_r, sz_dr);
+                else if(data_r) free(data_r);
 
                 i++;
             }
@@ -1401,7 +903,7 @@ int readNFile( int N, const char* dirname ){
     return 0;
 }
 
-int writeFile( const char* pathname, const char* dirname ){
+int fss_writeFile( fss_conn* c, const char* pathname, const char* dirname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
@@ -1423,48 +925,37 @@ int writeFile( const char* pathname, const char* dirname ){
         return -1;
     }
 
-    operation = _WF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /* sending the 'writeFile' request to the server */
-    if((write_pathname(fd_sock, (void *) pathname, sz_p)) == -1){
+    if(send_request(c, _WF_O, NULL, pathname, &sz_p, (void *) data, &sz_d) == -1){
+        free(data);
         return -1;
     }
-    /*if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }*/
-
-    if((write_data(fd_sock, (void *) data, sz_d)) == -1){
-        return -1;
-    }
-
-    /*if((writen(fd_sock, (void *) &sz_d, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) data, sz_d)) == -1){
-        return -1;
-    }*/
 
     if(data) free(data);
 
+    if(c->pipe_window > 0) return defer_reply(c, _WF_O, pathname, dirname);
+    return recv_reply_write(c, pathname, dirname);
+}
+
+/**
+* receives the response to the 'writeFile' request and saves in 'dirname'
+*   the files ejected from the server
+*
+* @returns : 0 if successful
+*            -1 if the request fails and errno is set
+*/
+static int recv_reply_write( fss_conn* c, const char* pathname, const char* dirname ){
     /* receiving the response to the 'writeFile' request to the server */
-    result = -1;
+    c->result = -1;
 
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
+    if((readn(c->fd_sock, (void *) &c->result, sizeof(int))) == -1){
         return -1;
     }
 
-    if(result == SUCCESS_O){
+    if(c->result == SUCCESS_O){
         int N = 0;
 
-        if((readn(fd_sock, (void *) &N, sizeof(int))) == -1){
+        if((readn(c->fd_sock, (void *) &N, sizeof(int))) == -1){
             return -1;
         }
         if(N > 0){
@@ -1477,44 +968,45 @@ int writeFile( const char* pathname, const char* dirname ){
             size_t sz_dr   = 0;
 
             for(int i=0; i<N; i++){
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
+                if((readn(c->fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
                     return -1;
                 }
                 path_r = malloc(sz_pr);
                 memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
+                if((readn(c->fd_sock, (void *) path_r, sz_pr)) == -1){
                     free(path_r);
                     return -1;
                 }
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
+                if((readn(c->fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
                     free(path_r);
                     return -1;
                 }
                 data_r = malloc(sz_dr);
                 memset(data_r, '\0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_pr)) == -1){
+                if((readn(c->fd_sock, (void *) data_r, sz_dr)) == -1){
                     free(path_r);
                     free(data_r);
                     return -1;
                 }
 
-                char* p = getNameFile(path_r);
-                char* f = (char *) malloc(STR_LEN * sizeof(char));
-                memset(f, '\0', STR_LEN);
-                strncpy(f, dirname, STR_LEN-1);
-                strncat(f, "/", 2);
-                strncat(f, p, STR_LEN);
-                write_file(f, data_r, sz_dr);
+                // the name points into 'path_r'
+                char* p = (dirname != NULL) ? getNameFile(path_r) : NULL;
+                if(p != NULL){
+                    char* f = (char *) malloc(STR_LEN * sizeof(char));
+                    memset(f, '\0', STR_LEN);
+                    strncpy(f, dirname, STR_LEN-1);
+                    strncat(f, "/", 2);
+                    strncat(f, p, STR_LEN-strlen(f)-1);
+                    write_file(f, data_r, sz_dr);
+                    free(f);
+                }
                 free(path_r);
                 free(data_r);
-                free(p);
-                free(f);
             }
         }
     }else{
         char* reason = NULL;
-        size_t sz_r  = 0;
-        if((readn(fd_sock, &sz_r, sizeof(size_t))) == -1){
+        if(read_reason(c->fd_sock, &reason) == -1){
             return -1;
         }
         #ifdef PRINT_REASON
@@ -1530,49 +1022,33 @@ int writeFile( const char* pathname, const char* dirname ){
     return 0;
 }
 
-int appendToFile( const char* pathname, void* buf, size_t size, const char* dirname ){
+int fss_appendToFile( fss_conn* c, const char* pathname, void* buf, size_t size, const char* dirname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _ATF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
-    /* sending the 'writeFile' request to the server */
+    /* sending the 'appendToFile' request to the server */
     size_t sz_p = strlen(pathname)+1;
     if(sz_p <= 1){
         errno = EFAULT;
         return -1;
     }
-    if((writen(fd_sock, (void *) &sz_p, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) pathname, sz_p)) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) &size, sizeof(size_t))) == -1){
-        return -1;
-    }
-    if((writen(fd_sock, (void *) buf, size)) == -1){
+    if(send_request(c, _ATF_O, NULL, pathname, &sz_p, buf, &size) == -1){
         return -1;
     }
 
     /* receiving the response to the 'writeFile' request to the server */
-    result = -1;
+    c->result = -1;
 
-    if((readn(fd_sock, (void *) &result, sizeof(int))) == -1){
+    if((readn(c->fd_sock, (void *) &c->result, sizeof(int))) == -1){
         return -1;
     }
 
-    if(result == SUCCESS_O){
+    if(c->result == SUCCESS_O){
         int N = 0;
 
-        if((readn(fd_sock, (void *) &N, sizeof(int))) == -1){
+        if((readn(c->fd_sock, (void *) &N, sizeof(int))) == -1){
             return -1;
         }
         if(N > 0){
@@ -1585,44 +1061,45 @@ int appendToFile( const char* pathname, void* buf, size_t size, const char* dirn
             size_t sz_dr   = 0;
 
             for(int i=0; i<N; i++){
-                if((readn(fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
+                if((readn(c->fd_sock, (void *) &sz_pr, sizeof(size_t))) == -1){
                     return -1;
                 }
                 path_r = malloc(sz_pr);
                 memset(path_r, '\0', sz_pr);
-                if((readn(fd_sock, (void *) path_r, sz_pr)) == -1){
+                if((readn(c->fd_sock, (void *) path_r, sz_pr)) == -1){
                     free(path_r);
                     return -1;
                 }
-                if((readn(fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
+                if((readn(c->fd_sock, (void *) &sz_dr, sizeof(size_t))) == -1){
                     free(path_r);
                     return -1;
                 }
                 data_r = malloc(sz_dr);
                 memset(data_r, '\0', sz_dr);
-                if((readn(fd_sock, (void *) data_r, sz_pr)) == -1){
+                if((readn(c->fd_sock, (void *) data_r, sz_dr)) == -1){
                     free(path_r);
                     free(data_r);
                     return -1;
                 }
 
-                char* p = getNameFile(path_r);
-                char* f = (char *) malloc(STR_LEN * sizeof(char));
-                memset(f, '\0', STR_LEN);
-                strncpy(f, dirname, STR_LEN-1);
-                strncat(f, "/", 2);
-                strncat(f, p, STR_LEN);
-                write_file(f, data_r, sz_dr);
+                // the name points into 'path_r'
+                char* p = (dirname != NULL) ? getNameFile(path_r) : NULL;
+                if(p != NULL){
+                    char* f = (char *) malloc(STR_LEN * sizeof(char));
+                    memset(f, '\0', STR_LEN);
+                    strncpy(f, dirname, STR_LEN-1);
+                    strncat(f, "/", 2);
+                    strncat(f, p, STR_LEN-strlen(f)-1);
+                    write_file(f, data_r, sz_dr);
+                    free(f);
+                }
                 free(path_r);
                 free(data_r);
-                free(p);
-                free(f);
             }
         }
     }else{
         char* reason = NULL;
-        size_t sz_r  = 0;
-        if((readn(fd_sock, &sz_r, sizeof(size_t))) == -1){
+        if(read_reason(c->fd_sock, &reason) == -1){
             return -1;
         }
         #ifdef PRINT_REASON
@@ -1630,7 +1107,7 @@ int appendToFile( const char* pathname, void* buf, size_t size, const char* dirn
                 fprintf(stdout, "failure to write file '%s': %s\n", pathname, reason);
             }
         #endif
-            if(reason) free(reason);
+        if(reason) free(reason);
         // errno da settare qua
         return -1;
     }
@@ -1638,33 +1115,26 @@ int appendToFile( const char* pathname, void* buf, size_t size, const char* dirn
     return 0;
 }
 
-int lockFile( const char* pathname ){
+int fss_lockFile( fss_conn* c, const char* pathname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _LF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /* sending the 'lockFile' request to the server */
     size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
+    if(send_request(c, _LF_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
+        return -1;
     }
 
     /* receiving the response to the 'lockFile' request from the server */
-    int result = 0;
+    c->result = 0;
     char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
+    if(readn(c->fd_sock, &c->result, sizeof(int)) == -1){
 
     }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
+    if(c->result == FAILED_O){
+        if(read_reason(c->fd_sock, &reason) == -1){
 
         }
         #ifdef PRINT_REASON
@@ -1679,33 +1149,26 @@ int lockFile( const char* pathname ){
     return 0;
 }
 
-int unlockFile( const char* pathname ){
+int fss_unlockFile( fss_conn* c, const char* pathname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _UF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /* sending the 'unlockFile' request to the server */
     size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
+    if(send_request(c, _UF_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
+        return -1;
     }
 
     /* receiving the response to the 'unlockFile' request from the server */
-    int result = 0;
+    c->result = 0;
     char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
+    if(readn(c->fd_sock, &c->result, sizeof(int)) == -1){
 
     }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
+    if(c->result == FAILED_O){
+        if(read_reason(c->fd_sock, &reason) == -1){
 
         }
         #ifdef PRINT_REASON
@@ -1720,33 +1183,26 @@ int unlockFile( const char* pathname ){
     return 0;
 }
 
-int closeFile( const char* pathname ){
+int fss_closeFile( fss_conn* c, const char* pathname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _CF_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /* sending the 'closeFile' request to the server */
     size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
-
+    if(send_request(c, _CF_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
+        return -1;
     }
 
     /* receiving the response to the 'closeFile' request to the server */
-    int result = 0;
+    c->result = 0;
     char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
+    if(readn(c->fd_sock, &c->result, sizeof(int)) == -1){
 
     }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
+    if(c->result == FAILED_O){
+        if(read_reason(c->fd_sock, &reason) == -1){
 
         }
         #ifdef PRINT_REASON
@@ -1761,33 +1217,26 @@ int closeFile( const char* pathname ){
     return 0;
 }
 
-int removeFile( const char* pathname ){
+int fss_removeFile( fss_conn* c, const char* pathname ){
     if(!pathname){
         errno = EINVAL;
         return -1;
     }
 
-    operation = _RFI_O;
-
-    // I write the operation to do
-    if((writen(fd_sock, (void *) &operation, sizeof(int))) == -1){
-        return -1;
-    }
-
     /* sending the 'removeFile' request to the server */
     size_t sz_p = strlen(pathname)+1;
-    if(write_pathname(fd_sock, pathname, sz_p) == -1){
+    if(send_request(c, _RFI_O, NULL, pathname, &sz_p, NULL, NULL) == -1){
         return -1;
     }
 
     /* receiving the response to the 'removeFile' request from the server */
-    int result = 0;
+    c->result = 0;
     char* reason = NULL;
-    if(readn(fd_sock, &result, sizeof(int)) == -1){
+    if(readn(c->fd_sock, &c->result, sizeof(int)) == -1){
         return -1;
     }
-    if(result == FAILED_O){
-        if(read_reason(fd_sock, &reason) == -1){
+    if(c->result == FAILED_O){
+        if(read_reason(c->fd_sock, &reason) == -1){
             if(reason) free(reason);
             return -1;
         }
@@ -1802,3 +1251,58 @@ int removeFile( const char* pathname ){
 
     return 0;
 }
+
+
+/******************** functions on the default connection ********************/
+
+int openFile( const char* pathname, int flags ){
+    return fss_openFile(&conn_default, pathname, flags);
+}
+
+int readFile( const char* pathname, void** buf, size_t* size ){
+    return fss_readFile(&conn_default, pathname, buf, size);
+}
+
+int readNFile( int N, const char* dirname ){
+    return fss_readNFile(&conn_default, N, dirname);
+}
+
+int readFileMapped( const char* pathname, void** buf, size_t* size ){
+    return fss_readFileMapped(&conn_default, pathname, buf, size);
+}
+
+int readNFileMapped( int N, const char* dirname ){
+    return fss_readNFileMapped(&conn_default, N, dirname);
+}
+
+int writeFile( const char* pathname, const char* dirname ){
+    return fss_writeFile(&conn_default, pathname, dirname);
+}
+
+int appendToFile( const char* pathname, void* buf, size_t size, const char* dirname ){
+    return fss_appendToFile(&conn_default, pathname, buf, size, dirname);
+}
+
+int lockFile( const char* pathname ){
+    return fss_lockFile(&conn_default, pathname);
+}
+
+int unlockFile( const char* pathname ){
+    return fss_unlockFile(&conn_default, pathname);
+}
+
+int closeFile( const char* pathname ){
+    return fss_closeFile(&conn_default, pathname);
+}
+
+int removeFile( const char* pathname ){
+    return fss_removeFile(&conn_default, pathname);
+}
+
+int beginPipeline( int window ){
+    return fss_beginPipeline(&conn_default, window);
+}
+
+int endPipeline( void ){
+    return fss_endPipeline(&conn_default);
+}
@@ -33,10 +33,15 @@
  */
 
 // #define _POSIX_C_SOURCE 200112L
+#define _GNU_SOURCE // needed for memfd_create
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 #include "my_file.h"
 #include "utils.h"
@@ -60,31 +65,285 @@ static inline void unlockFileAndSignal( file_t* ft ){
     UNLOCK(&ft->flock);
 }
 
+/* openers of a file: the caller holds the lock of the file */
+static inline int* openers_fds( openers_t* o ){
+    return (o->cap) ? o->u.v : o->u.fd;
+}
+
+static inline void openers_init( openers_t* o ){
+    o->n = 0;
+    o->cap = 0;
+}
+
+static inline void openers_free( openers_t* o ){
+    if(o->cap) free(o->u.v);
+    openers_init(o);
+}
+
+/**
+* @returns : the position of 'fd' in the openers, or the one where it
+*            would be inserted
+*/
+static int openers_find( openers_t* o, int fd ){
+    int* v = openers_fds(o);
+    int lo = 0, hi = o->n;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(v[mid] < fd) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int openers_has( openers_t* o, int fd ){
+    int i = openers_find(o, fd);
+    return i < o->n && openers_fds(o)[i] == fd;
+}
+
+/**
+* @returns : 0 on success (also if 'fd' was already there)
+*            -1 if the array cannot grow
+*/
+static int openers_add( openers_t* o, int fd ){
+    int i = openers_find(o, fd);
+    int* v = openers_fds(o);
+    if(i < o->n && v[i] == fd)
+        return 0;
+    if(o->n == ((o->cap) ? o->cap : FILE_OPENERS_INLINE)){
+        int cap = 2 * o->n;
+        int* nv = (o->cap) ? realloc(o->u.v, cap * sizeof(int)) : malloc(cap * sizeof(int));
+        if(!nv) return -1;
+        if(!o->cap) memcpy(nv, o->u.fd, o->n * sizeof(int));
+        o->u.v = nv;
+        o->cap = cap;
+        v = nv;
+    }
+    memmove(&v[i + 1], &v[i], (o->n - i) * sizeof(int));
+    v[i] = fd;
+    o->n++;
+    return 0;
+}
+
+static void openers_remove( openers_t* o, int fd ){
+    int i = openers_find(o, fd);
+    int* v = openers_fds(o);
+    if(i >= o->n || v[i] != fd)
+        return;
+    memmove(&v[i], &v[i + 1], (o->n - i - 1) * sizeof(int));
+    o->n--;
+    // back inside the file only well below the limit: no array
+    // allocated and released at each open and close around it
+    if(o->cap && o->n <= FILE_OPENERS_INLINE / 2){
+        memcpy(o->u.fd, v, o->n * sizeof(int));
+        free(v);
+        o->cap = 0;
+    }
+}
+
+/**
+* @returns : 0 on success, -1 on failure ('dst' is then empty)
+*/
+static int openers_copy( openers_t* dst, openers_t* src ){
+    *dst = *src;
+    if(src->cap){
+        if((dst->u.v = malloc(src->cap * sizeof(int))) == NULL){
+            openers_init(dst);
+            return -1;
+        }
+        memcpy(dst->u.v, src->u.v, src->n * sizeof(int));
+    }
+    return 0;
+}
+
+// writes all the 'size' bytes of 'buf' at the offset 'off' of 'fd', 0 on success and -1 on error
+static int pwriten( int fd, const void* buf, size_t size, off_t off ){
+    const char* p = (const char *) buf;
+    while(size > 0){
+        ssize_t w = pwrite(fd, p, size, off);
+        if(w == -1){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        off += w;
+        size -= w;
+    }
+    return 0;
+}
+
+/**
+* creates a buffer with the concatenation of 'first' and 'second'
+*
+* @returns : the new buffer with a single reference, NULL if the memory is over
+*/
+static fbuf_t* fbuf_concat( const void* first, size_t size_first, const void* second, size_t size_second ){
+    size_t size = size_first + size_second;
+    fbuf_t* b = (fbuf_t *) malloc(sizeof(fbuf_t) + size + 1);
+    if(!b) return NULL;
+    b->refs = 1;
+    b->size = size;
+    b->memfd = -1;
+    b->data = (char *) (b + 1);
+    if(size_first > 0) memcpy(b->data, first, size_first);
+    if(size_second > 0) memcpy(b->data + size_first, second, size_second);
+    // the contents are often printed as strings
+    b->data[b->size] = '\0';
+    return b;
+}
+
+/**
+* replaces the contents of the file with the buffer 'b' (the file takes
+* its reference), the file must be locked
+*
+* @returns : the old buffer, to be released after the unlock
+*/
+static fbuf_t* file_publish( file_t* ft, fbuf_t* b ){
+    fbuf_t* old = ft->buf;
+    ft->buf = b;
+    ft->data = b ? b->data : NULL;
+    ft->size_data = b ? b->size : 0;
+    return old;
+}
+
+/**************************** immutable buffers ****************************/
+
+/**
+* creates an immutable buffer with a copy of 'data'
+*
+* @returns : the new buffer with a single reference, NULL if the memory is over
+*/
+fbuf_t* fbuf_create( const void* data, size_t size ){
+    return fbuf_concat(data, size, NULL, 0);
+}
+
+/**
+* takes a reference to the buffer 'b': it will not be released before
+*   the corresponding fbuf_release
+*/
+fbuf_t* fbuf_pin( fbuf_t* b ){
+    if(b) __atomic_add_fetch(&b->refs, 1, __ATOMIC_RELAXED);
+    return b;
+}
+
+/**
+* leaves a reference to the buffer 'b', which is released by the last holder
+*/
+void fbuf_release( void* p ){
+    fbuf_t* b = (fbuf_t *) p;
+    if(!b || __atomic_sub_fetch(&b->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if(b->memfd >= 0) close(b->memfd);
+    free(b);
+}
+
+/**
+* sealed memfd with a copy of the contents of 'b', for a reader that maps
+*   them: created at the first request and closed with the buffer, so
+*   only the contents read in this way hold a descriptor
+*
+* @returns : the descriptor (owned by the buffer), -1 if the contents are
+*            shorter than FBUF_MEMFD_MIN or the memfd cannot be created
+*/
+int fbuf_memfd( fbuf_t* b ){
+    if(!b || b->size < FBUF_MEMFD_MIN) return -1;
+    int fd = __atomic_load_n(&b->memfd, __ATOMIC_ACQUIRE);
+    if(fd >= 0) return fd;
+
+    if((fd = memfd_create("fss-file", MFD_CLOEXEC | MFD_ALLOW_SEALING)) == -1) return -1;
+    // the terminator of the contents is the last byte of the memfd (zero)
+    if(ftruncate(fd, b->size + 1) == -1
+        || pwriten(fd, b->data, b->size, 0) == -1
+        || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1){
+        close(fd);
+        return -1;
+    }
+    // two readers can create it at the same time: the first one is kept
+    int expected = -1;
+    if(!__atomic_compare_exchange_n(&b->memfd, &expected, fd, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+        close(fd);
+        return expected;
+    }
+    return fd;
+}
+
 // simple hash function
+/* wyhash: 64x64->128 bit multiplications folded on 64 bits */
+static const uint64_t wyp[4] = { 0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+                                 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL };
+
+static inline uint64_t wymix( uint64_t a, uint64_t b ){
+    __extension__ unsigned __int128 r = (unsigned __int128) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+static inline uint64_t wyr8( const uint8_t* p ){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wyr4( const uint8_t* p ){
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t wyr3( const uint8_t* p, size_t k ){
+    return (((uint64_t) p[0]) << 16) | (((uint64_t) p[k >> 1]) << 8) | p[k - 1];
+}
+
  /**
- *  hash function that computes the hash value given to key
+ *  hash function that computes the hash value given to key (wyhash: the
+ *  pathname is read 8 or 16 bytes at a time, no copy)
  *
  * @params key : key to find its hash value
  *
- * @returns : -1 if not valid key
+ * @returns : 0 if not valid key
  *              hash value it is valid key
  */
-unsigned int hash_function_for_file_t(char* key){
+uint64_t hash_function_for_file_t(char* key){
     if(!key)
-        return -1;
-
-    size_t len = strlen(key)+1;
-    if(len <= 1)
-        return -1;
-    char *str_key = (char *) malloc(len * sizeof(char));
-    memset(str_key, '\0', len);
-    strncpy(str_key, key, len);
-
-    unsigned int key_value = 0;
-    for(int i=0; str_key[i] != '\0'; i++)
-        key_value += (unsigned int) str_key[i];
-    free(str_key);
-    return key_value;
+        return 0;
+
+    const uint8_t* p = (const uint8_t *) key;
+    size_t len = strlen(key);
+    uint64_t seed = wymix(wyp[0], wyp[1]);
+    uint64_t a, b;
+
+    if(len <= 16){
+        if(len >= 4){
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }else if(len > 0){
+            a = wyr3(p, len);
+            b = 0;
+        }else{
+            a = b = 0;
+        }
+    }else{
+        size_t i = len;
+        if(i > 48){
+            uint64_t see1 = seed, see2 = seed;
+            do{
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            }while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16){
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= wyp[1];
+    b ^= seed;
+    __extension__ unsigned __int128 r = (unsigned __int128) a * b;
+    return wymix((uint64_t) r ^ wyp[0] ^ len, (uint64_t) (r >> 64) ^ wyp[1]);
 }
 
  // compare function
@@ -120,19 +379,18 @@ file_t* file_create( char* key, size_t size_key, void* data, size_t size_data, i
     new_file->key       = (char *) malloc(size_key);
     strcpy(new_file->key, key);
     new_file->size_key  = size_key;
+    new_file->hash      = 0;        // set by the table that holds the file
+    new_file->buf       = NULL;
     if((data != NULL) && (size_data > 0)){
-        new_file->data      = (void *) malloc(size_data);
-        memset(new_file->data, '0', size_data);
-        memcpy((char *)new_file->data, data, size_data);
-        new_file->size_data = size_data;
+        file_publish(new_file, fbuf_create(data, size_data));
     }else{
-        new_file->data = NULL;
-        new_file->size_data = 0;
+        file_publish(new_file, NULL);
     }
     new_file->log       = -1;
     new_file->next      = NULL;
-    FD_ZERO(&new_file->set);
-    FD_SET(fd, &new_file->set);
+    openers_init(&new_file->openers);
+    // fd < 0: no client has the file open (files restored at startup)
+    if(fd >= 0) openers_add(&new_file->openers, fd);
     pthread_mutex_init(&new_file->flock, NULL);
     pthread_cond_init(&new_file->fcond, NULL);
     return new_file;
@@ -141,7 +399,8 @@ file_t* file_create( char* key, size_t size_key, void* data, size_t size_data, i
 void file_free(file_t* f){
     if(f){
         if(f->key) free(f->key);
-        if(f->data) free(f->data);
+        fbuf_release(f->buf);
+        openers_free(&f->openers);
         pthread_mutex_destroy(&(f->flock));
         pthread_cond_destroy(&(f->fcond));
         free(f);
@@ -154,22 +413,20 @@ file_t* file_update_data(file_t* ft, void* data, size_t size_data ){
     file_t* new_file = (file_t *) malloc(sizeof(file_t));
     if(!new_file) return NULL;
 
-
-    if(ft->data == NULL){
-        new_file->data = (void *) malloc(size_data);
-        memset(new_file->data, '0', size_data);
-        if(memcpy(new_file->data, data, size_data) == NULL) fprintf(stdout, ">>>>>>>> un altro bordello\n");
-    }else{
-        new_file->data = malloc(ft->size_data + size_data + 1);
-        // if( sprintf(new_file->data, "%s%s", (char *)ft->data, (char *)data) < 0) return NULL;
-        if(strncat(new_file->data, (char *)data, size_data) == NULL) fprintf(stdout, ">>>> sono fotuto\n");
-        free(data);
+    // the new file has the old contents followed by 'data'
+    lockFile(ft);
+    new_file->buf = NULL;
+    file_publish(new_file, fbuf_concat(ft->data, ft->size_data, data, size_data));
+    if(openers_copy(&new_file->openers, &ft->openers) == -1){
+        unlockFile(ft);
+        fbuf_release(new_file->buf);
+        free(new_file);
+        return NULL;
     }
+    unlockFile(ft);
 
     new_file->key       = ft->key;
     new_file->size_key  = ft->size_key;
-    new_file->size_data = size_data;
-    new_file->set       = ft->set;
     new_file->log       = ft->log;
     new_file->next      = ft->next;
     pthread_mutex_init(&new_file->flock, NULL);
@@ -183,8 +440,11 @@ int file_take_lock( file_t* ft, int fd_lock ){
 
     lockFile(ft);
     if(ft->log >= 0) unlockFileAndWait(ft);
+    if(openers_add(&ft->openers, fd_lock) == -1){
+        unlockFileAndSignal(ft);
+        return -1;
+    }
     ft->log = fd_lock;
-    FD_SET(fd_lock, &ft->set);
     unlockFile(ft);
     return 0;
 }
@@ -212,18 +472,35 @@ int file_has_lock( file_t* ft, int fd ){
 
 
 int file_read_content( file_t * ft, void** content, size_t* size_content ){
-    lockFile(ft);
-    if(ft->data == NULL || ft->size_data <= 0){
+    fbuf_t* b = NULL;
+    file_pin_content(ft, &b);
+    if(b == NULL || b->size <= 0){
         *content = NULL;
         *size_content = 0;
     }else{
+        // the copy is done without holding the lock of the file
         if(*content) free(*content);
-        *content =  malloc(ft->size_data+1);
-        memset(*content, '0', ft->size_data);
-        if( memcpy(*content, ft->data, ft->size_data) == NULL) return -1;
-        *size_content = ft->size_data;
+        *content =  malloc(b->size+1);
+        memcpy(*content, b->data, b->size+1);
+        *size_content = b->size;
     }
-    unlockFileAndSignal(ft);
+    fbuf_release(b);
+    return 0;
+}
+
+/**
+* takes a reference to the current contents of the file: they stay valid
+*   (and unchanged) until fbuf_release, even if the file is written again
+*   or removed
+*
+* @params buf : the contents, NULL if the file is empty
+*
+* @returns : 0
+*/
+int file_pin_content( file_t* ft, fbuf_t** buf ){
+    lockFile(ft);
+    *buf = fbuf_pin(ft->buf);
+    unlockFile(ft);
     return 0;
 }
 
@@ -252,56 +529,69 @@ int file_read( file_t* ft, char** key, size_t* size_key, void** content, size_t*
 int file_write_content( file_t* ft, void* content, size_t size_content ){
     if(!content || size_content <= 0) return -1;
 
+    // the new buffer is prepared before taking the lock
+    fbuf_t* b = fbuf_create(content, size_content);
+    if(!b) return -1;
     lockFile(ft);
-    if(ft->data) free(ft->data);
-    ft->data = malloc(size_content+1);
-    memset(ft->data, '0', size_content+1);
-    ft->size_data = size_content;
-    if( memcpy(ft->data, content, size_content) == NULL) return -1;
+    fbuf_t* old = file_publish(ft, b);
     unlockFileAndSignal(ft);
+    fbuf_release(old);
     return 0;
 }
 
 int file_append_content( file_t* ft, void* content, size_t size_content ){
     if(!content || size_content <= 0) return -1;
 
+    // the current contents are not modified: the readers that pinned them
+    // keep sending them, the file gets a new buffer with the data appended
     lockFile(ft);
-    void* p = ft->data;
-    //ft->data = malloc(ft->size_data + size_content+1);
-    //strncat(ft->data, content, size_content);
-    // if( sprintf(ft->data, "%s%s", (char *)p, (char *)content) < 0) return -1;
-    ft->data = realloc(ft->data, ft->size_data + size_content+1);
-    strncpy((char *)ft->data, (char *)content, size_content);
-    ft->size_data += size_content;
-    free(p);
+    fbuf_t* b = fbuf_concat(ft->data, ft->size_data, content, size_content);
+    if(!b){
+        unlockFileAndSignal(ft);
+        return -1;
+    }
+    fbuf_t* old = file_publish(ft, b);
     unlockFileAndSignal(ft);
+    fbuf_release(old);
     return 0;
 }
 
 file_t* file_copy( file_t* ft ){
     if(!ft) return NULL;
     lockFile(ft);
-    file_t* cpy_ft = file_create(ft->key, ft->size_key, ft->data, ft->size_data, ft->log);
+    // the copy shares the contents of the file
+    file_t* cpy_ft = file_create(ft->key, ft->size_key, NULL, 0, ft->log);
+    if(cpy_ft){
+        cpy_ft->hash = ft->hash;
+        file_publish(cpy_ft, fbuf_pin(ft->buf));
+    }
     unlockFileAndSignal(ft);
     return cpy_ft;
 }
 
-void file_add_fd( file_t* ft, int fd ){
+/**
+* @returns : 0 on success
+*            -1 if 'fd' is not valid or there is no memory to record it
+*/
+int file_add_fd( file_t* ft, int fd ){
+    int r;
+    if(fd < 0) return -1;
     lockFile(ft);
-    FD_SET(fd, &(ft->set));
+    r = openers_add(&ft->openers, fd);
     unlockFile(ft);
+    return r;
 }
 
 void file_remove_fd( file_t* ft, int fd ){
     lockFile(ft);
-    FD_CLR(fd, &(ft->set));
+    openers_remove(&ft->openers, fd);
     unlockFile(ft);
 }
 
 int file_has_fd( file_t* ft, int fd ){
     int r = 0;
     lockFile(ft);
-    if(FD_ISSET(fd, &(ft->set))) r = 1;
+    r = openers_has(&ft->openers, fd);
     unlockFile(ft);
     return r;
 }
@@ -34,10 +34,12 @@
  */
 
 // #define _POSIX_C_SOURCE 200112L
+#define _GNU_SOURCE // needed for pthread_rwlockattr_setkind_np
 
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
+ #include <stddef.h>
  #include <errno.h>
  #include <limits.h>
  #include <sys/types.h>
@@ -47,42 +49,387 @@
  #include "my_file.h"
  #include "utils.h"
 
-/* for hash_t */
-static inline void lockHash( hash_t* ht ){
-    LOCK(&ht->hlock);
-}
-
-static inline void unlockHash( hash_t* ht ){
-    UNLOCK(&ht->hlock);
+/* for the tables of hash_t */
+static inline void enterHash( hash_t* ht ){
+    if(pthread_rwlock_rdlock(&ht->tlock) != 0){
+        fprintf(stderr, "FATAL ERROR: read lock\n");
+        pthread_exit((void*) EXIT_FAILURE);
+    }
 }
 
-static inline void unlockHashAndWait( hash_t* ht ){
-    WAIT(&ht->hcond, &ht->hlock);
+static inline void enterHashWrite( hash_t* ht ){
+    if(pthread_rwlock_wrlock(&ht->tlock) != 0){
+        fprintf(stderr, "FATAL ERROR: write lock\n");
+        pthread_exit((void*) EXIT_FAILURE);
+    }
 }
 
-static inline void unlockHashAndSignal( hash_t* ht ){
-    SIGNAL(&ht->hcond);
-    UNLOCK(&ht->hlock);
+static inline void exitHash( hash_t* ht ){
+    if(pthread_rwlock_unlock(&ht->tlock) != 0){
+        fprintf(stderr, "FATAL ERROR: unlock\n");
+        pthread_exit((void*) EXIT_FAILURE);
+    }
 }
 
-/* for node_h */
+/* for node_h: the lock is the stripe of the bucket */
 static inline void lockNodeHash( node_h* nh ){
-    LOCK(&nh->nhlock);
+    LOCK(nh->nhlock);
 }
 
 static inline void unlockNodeHash( node_h* nh ){
-    UNLOCK(&nh->nhlock);
+    UNLOCK(nh->nhlock);
+}
+
+
+/**
+ * releases the buckets of a table, their lists must be empty
+ */
+static void free_buckets( node_h** table, int size ){
+    for(int i=0; i<size; i++)
+        free(table[i]);
+    free(table);
+}
+
+/* releases of the objects retired through the epochs */
+static void release_item( NodeE_t* node ){
+    file_free((data_hash_t *) ((char *) node - offsetof(data_hash_t, retire)));
 }
 
-static inline void unlockNodeHashAndWait( node_h* nh ){
-    WAIT(&nh->nhcond, &nh->nhlock);
+static void release_tab( NodeE_t* node ){
+    free((char *) node - offsetof(hash_tab, retire));
 }
 
-static inline void unlockNodeHashAndSignal( node_h* nh ){
-    SIGNAL(&nh->nhcond);
-    UNLOCK(&nh->nhlock);
+// the old buckets go with the last tables that showed them
+static void release_tab_old( NodeE_t* node ){
+    hash_tab* t = (hash_tab *) ((char *) node - offsetof(hash_tab, retire));
+    free_buckets(t->old_table, t->old_size);
+    free(t);
 }
 
+static hash_tab* new_tab( int size, node_h** table, int old_size, node_h** old_table ){
+    hash_tab* t = (hash_tab *) malloc(sizeof(hash_tab));
+    if(!t)
+        return NULL;
+    t->size = size;
+    t->table = table;
+    t->old_size = old_size;
+    t->old_table = old_table;
+    return t;
+}
+
+/**
+ * allocates a table of 'size' empty buckets, on the stripes of the table
+ *
+ * @returns : the table, NULL on failure
+ */
+static node_h** alloc_buckets( hash_t* ht, int size ){
+    node_h** table = (node_h **) calloc(size, sizeof( node_h* ));
+    if(!table)
+        return NULL;
+    for(int i=0; i<size; i++){
+        table[i] = (node_h *) malloc(sizeof(node_h));
+        if(!table[i]){
+            free_buckets(table, i);
+            return NULL;
+        }
+        table[i]->n = 0;
+        table[i]->moved = 0;
+        table[i]->seq = 0;
+        table[i]->list = NULL;
+        table[i]->nhlock = &ht->stripe[i & (ht->n_stripes - 1)].lock;
+    }
+    return table;
+}
+
+/**
+ * moves the bucket 'i' of the old table to the new one (nothing if it has
+ * already been moved); the caller holds the table in read mode
+ *
+ * @returns : 1 if it was the last bucket to move
+ *            0 otherwise
+ */
+static int move_bucket( hash_t* ht, int i ){
+    node_h* old = ht->old_table[i];
+    lockNodeHash(old);
+    if(old->moved){
+        unlockNodeHash(old);
+        return 0;
+    }
+    // the lookups that walk the bucket meanwhile will look again: the
+    // links below are stored with release, who reads one sees 'seq' odd
+    __atomic_store_n(&old->seq, old->seq + 1, __ATOMIC_RELAXED);
+    data_hash_t* ptr = old->list;
+    while(ptr != NULL){
+        data_hash_t* next = ptr->next;
+        // the hash value is kept in the item: no need to compute it again
+        node_h* ptr_n = ht->table[ptr->hash & (ht->size - 1)];
+        // with fewer stripes than old buckets it is the stripe already held
+        int own = (ptr_n->nhlock != old->nhlock);
+        if(own) lockNodeHash(ptr_n);
+        __atomic_store_n(&ptr->next, ptr_n->list, __ATOMIC_RELEASE);
+        __atomic_store_n(&ptr_n->list, ptr, __ATOMIC_RELEASE);
+        ptr_n->n++;
+        if(own) unlockNodeHash(ptr_n);
+        ptr = next;
+    }
+    __atomic_store_n(&old->list, NULL, __ATOMIC_RELEASE);
+    old->n = 0;
+    __atomic_store_n(&old->moved, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&old->seq, old->seq + 1, __ATOMIC_RELEASE);
+    unlockNodeHash(old);
+    return __atomic_add_fetch(&ht->migrated, 1, __ATOMIC_ACQ_REL) == ht->old_size;
+}
+
+/**
+ * moves the next HASH_MIGRATE_STEP buckets of the old table
+ *
+ * @returns : 1 if the last bucket has been moved
+ *            0 otherwise
+ */
+static int help_resize( hash_t* ht ){
+    int last = 0;
+    for(int k=0; k<HASH_MIGRATE_STEP; k++){
+        int i = __atomic_fetch_add(&ht->migrate_next, 1, __ATOMIC_RELAXED);
+        if(i >= ht->old_size)
+            break;
+        last |= move_bucket(ht, i);
+    }
+    return last;
+}
+
+/**
+ * bucket of the new table that holds the key of hash value 'h': during a resize the old bucket
+ * of the key is moved first, and a few more with it; the caller holds the
+ * table in read mode
+ *
+ * @param last : set to 1 if the resize can be ended
+ */
+static node_h* bucket_of( hash_t* ht, uint64_t h, int* last ){
+    if(ht->old_table != NULL){
+        if(move_bucket(ht, h & (ht->old_size - 1)))
+            *last = 1;
+        if(help_resize(ht))
+            *last = 1;
+    }
+    return ht->table[h & (ht->size - 1)];
+}
+
+/**
+ * drops the old table once all its buckets have been moved
+ */
+static void end_resize( hash_t* ht ){
+    hash_tab* prev = NULL;
+
+    enterHashWrite(ht);
+    if(ht->old_table != NULL && __atomic_load_n(&ht->migrated, __ATOMIC_ACQUIRE) == ht->old_size){
+        ht->old_table = NULL;
+        ht->old_size = 0;
+        prev = ht->tab;
+        __atomic_store_n(&ht->tab, ht->tab_end, __ATOMIC_RELEASE);
+        ht->tab_end = NULL;
+    }
+    exitHash(ht);
+    // the lookups can still be walking the old buckets
+    if(prev != NULL){
+        retireEbr(ht->ebr, &prev->retire, &release_tab_old);
+        __atomic_store_n(&ht->resizing, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * leaves the table taken in read mode with enterHash
+ */
+static inline void leaveHash( hash_t* ht, int last ){
+    exitHash(ht);
+    if(last)
+        end_resize(ht);
+}
+
+/**
+ * installs a table twice as large: the buckets of the current one are
+ * moved by the operations that follow. Only one resize at a time, and
+ * the new buckets are allocated before taking the lock
+ */
+static void start_resize( hash_t* ht ){
+    int expected = 0;
+    if(!__atomic_compare_exchange_n(&ht->resizing, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+
+    enterHash(ht);
+    int size = ht->size;
+    exitHash(ht);
+    // the size does not change while 'resizing' is set
+    node_h** table = alloc_buckets(ht, 2 * size);
+    hash_tab* tab = new_tab(2 * size, table, 0, NULL);
+    hash_tab* tab_end = new_tab(2 * size, table, 0, NULL);
+    if(!table || !tab || !tab_end){
+        if(table) free_buckets(table, 2 * size);
+        free(tab);
+        free(tab_end);
+        __atomic_store_n(&ht->resizing, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    enterHashWrite(ht);
+    ht->old_table = ht->table;
+    ht->old_size = ht->size;
+    ht->table = table;
+    ht->size = 2 * size;
+    __atomic_store_n(&ht->migrate_next, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ht->migrated, 0, __ATOMIC_RELAXED);
+    // the lookups look in both tables until the end of the resize
+    tab->old_size = ht->old_size;
+    tab->old_table = ht->old_table;
+    hash_tab* prev = ht->tab;
+    __atomic_store_n(&ht->tab, tab, __ATOMIC_RELEASE);
+    ht->tab_end = tab_end;
+    exitHash(ht);
+    retireEbr(ht->ebr, &prev->retire, &release_tab);
+}
+
+/**
+ * looks for the key in the bucket without locks
+ *
+ * @param f : the item found, NULL if the key is not in the bucket
+ *
+ * @returns : 1 if 'f' is the result of the lookup
+ *            0 if the bucket has been moved to a new table
+ */
+static int search_bucket( hash_t* ht, node_h* b, char* key, uint64_t h, data_hash_t** f ){
+    for(;;){
+        unsigned int seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+        if(seq & 1){
+            // the move holds the lock of the bucket until it is over
+            lockNodeHash(b);
+            unlockNodeHash(b);
+            continue;
+        }
+        if(__atomic_load_n(&b->moved, __ATOMIC_ACQUIRE))
+            return 0;
+        data_hash_t* ptr = __atomic_load_n(&b->list, __ATOMIC_ACQUIRE);
+        while(ptr != NULL){
+            if(ptr->hash == h && ht->hash_key_compare(ptr->key, key) == 0){
+                *f = ptr;
+                return 1;
+            }
+            ptr = __atomic_load_n(&ptr->next, __ATOMIC_ACQUIRE);
+        }
+        // not found: certain only if the bucket has not been moved meanwhile
+        // (the links are read with acquire, 'seq' is read after them)
+        if(__atomic_load_n(&b->seq, __ATOMIC_ACQUIRE) == seq){
+            *f = NULL;
+            return 1;
+        }
+    }
+}
+
+/**
+ * lookup without locks, inside a read section
+ */
+static data_hash_t* find_item( hash_t* ht, char* key, uint64_t h ){
+    data_hash_t* f = NULL;
+    for(;;){
+        hash_tab* t = __atomic_load_n(&ht->tab, __ATOMIC_ACQUIRE);
+        // during a resize the key stays in its old bucket until that is moved
+        if(t->old_table != NULL && search_bucket(ht, t->old_table[h & (t->old_size - 1)], key, h, &f))
+            return f;
+        if(search_bucket(ht, t->table[h & (t->size - 1)], key, h, &f))
+            return f;
+        // a new resize has started: its tables have been published
+    }
+}
+
+/**
+ * counts a new item, added to a bucket that now holds 'n' items: the
+ * shards are summed only if the bucket is longer than HASH_LOAD_FACTOR,
+ * which is frequent as soon as the table is that full
+ *
+ * @returns : 1 if the table must grow
+ *            0 otherwise
+ */
+static int count_new_item( hash_t* ht, long n ){
+    addCounter(ht->count, 1);
+    if(ht->old_table != NULL || n <= HASH_LOAD_FACTOR)
+        return 0;
+    return readCounter(ht->count) > (long) ht->size * HASH_LOAD_FACTOR;
+}
+
+/* tables with an open-addressing index */
+static data_hash_t* swiss_find( hash_t* ht, char* key, uint64_t h ){
+    enterHash(ht);
+    data_hash_t* f = findSwiss(ht->index, key, h, ht->hash_key_compare);
+    exitHash(ht);
+    return f;
+}
+
+static data_hash_t* swiss_insert( hash_t* ht, char* key, uint64_t h, size_t size_key, void* data, size_t size_data, int fd ){
+    data_hash_t* f = NULL;
+    enterHashWrite(ht);
+    if(findSwiss(ht->index, key, h, ht->hash_key_compare) == NULL &&
+            (f = file_create(key, size_key, data, size_data, fd)) != NULL){
+        f->hash = h;
+        if(insertSwiss(ht->index, f) == -1){
+            file_free(f);
+            f = NULL;
+        }
+    }
+    exitHash(ht);
+    return f;
+}
+
+/**
+ * initializes the locks of a new table
+ *
+ * @returns : 0 on success, -1 on failure
+ */
+static int init_locks( hash_t* ht ){
+    pthread_rwlockattr_t attr;
+
+    // the lookups never stop: without preference a resize could wait forever
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    if(pthread_rwlock_init(&(ht->tlock), &attr) != 0){
+        perror("pthread_rwlock_init");
+        pthread_rwlockattr_destroy(&attr);
+        return -1;
+    }
+    pthread_rwlockattr_destroy(&attr);
+    return 0;
+}
+
+/**
+ * allocates 'n' locks for the buckets, rounded up to a power of two
+ *
+ * @returns : 0 on success, -1 on failure
+ */
+static int init_stripes( hash_t* ht, int n ){
+    void* p = NULL;
+
+    ht->n_stripes = 1;
+    while(ht->n_stripes < n)
+        ht->n_stripes *= 2;
+    if((errno = posix_memalign(&p, HASH_LINE, ht->n_stripes * sizeof(hash_stripe))) != 0){
+        perror("posix_memalign");
+        return -1;
+    }
+    ht->stripe = (hash_stripe *) p;
+    for(int i=0; i<ht->n_stripes; i++){
+        if(pthread_mutex_init(&ht->stripe[i].lock, NULL) != 0){
+            perror("pthread_mutex_init");
+            while(i-- > 0)
+                pthread_mutex_destroy(&ht->stripe[i].lock);
+            free(ht->stripe);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void free_stripes( hash_t* ht ){
+    for(int i=0; i<ht->n_stripes; i++)
+        pthread_mutex_destroy(&ht->stripe[i].lock);
+    free(ht->stripe);
+}
 
 /**
  * Create a new hash table
@@ -96,51 +443,108 @@ static inline void unlockNodeHashAndSignal( node_h* nh ){
  *
  * @exceptions: if there are problems allocating the table in memory, it returns NULL
  */
-hash_t* hash_create( const int size, unsigned int (*hash_function)(char *),
+hash_t* hash_create( const int size, uint64_t (*hash_function)(char *),
                     int (*hash_key_compare)(char *, char *) ){
-     if(size <= 0)
+    return hash_create_striped(size, HASH_LOCK_STRIPES, hash_function, hash_key_compare);
+}
+
+/**
+ * as hash_create, with the number of locks shared by the buckets
+ *
+ * @param stripes : number of locks (rounded up to a power of two), it
+ *                  does not change when the table grows
+ *
+ * @returns : - pointer to new hash table
+ *            - NULL if size <= 0, stripes <= 0 or on failure
+ */
+hash_t* hash_create_striped( const int size, const int stripes, uint64_t (*hash_function)(char *),
+                    int (*hash_key_compare)(char *, char *) ){
+     if(size <= 0 || stripes <= 0)
         return NULL;
 
      hash_t *ht;
-     int i;
 
      ht = (hash_t *) malloc(sizeof(hash_t));
      if(!ht)
          return NULL;
      memset(ht, '\0', sizeof(hash_t));
-     ht->size = size;
-     ht->number_of_item = 0;
-     ht->table = (node_h **) malloc(size * sizeof( node_h* ));
+     // the buckets are chosen with a mask
+     ht->size = 1;
+     while(ht->size < size)
+        ht->size *= 2;
+    if(init_stripes(ht, stripes) != 0){
+        free(ht);
+        return NULL;
+    }
+     ht->table = alloc_buckets(ht, ht->size);
      if(!ht->table)
-         return NULL;
-    if(pthread_mutex_init(&(ht->hlock), NULL) != 0){
-        perror("pthread_mutex_init");
+         goto fail_table;
+    if((ht->count = initCounter(HASH_COUNT_SHARDS)) == NULL)
+        goto fail_count;
+    if((ht->tab = new_tab(ht->size, ht->table, 0, NULL)) == NULL)
+        goto fail_tab;
+    if((ht->ebr = initEbr()) == NULL)
+        goto fail_ebr;
+    if(init_locks(ht) != 0)
+        goto fail_locks;
+    ht->hash_function = hash_function;
+    ht->hash_key_compare = hash_key_compare;
+
+    return ht;
+
+fail_locks:
+    deleteEbr(ht->ebr);
+fail_ebr:
+    free(ht->tab);
+fail_tab:
+    deleteCounter(ht->count);
+fail_count:
+    free_buckets(ht->table, ht->size);
+fail_table:
+    free_stripes(ht);
+    free(ht);
+    return NULL;
+ }
+
+/**
+ * Create a new hash table that keeps the files in an open-addressing
+ * index (swiss.h) instead of the lists of the buckets
+ *
+ * @param size : number of files the table holds before growing
+ * @param hash_function : pointer to the hashing function to be used
+ * @param hash_key_compare : pointer to the hash key comparison function to be used
+ *
+ * @returns : - pointer to new hash table
+ *            - NULL if size <= 0 or on failure
+ */
+hash_t* hash_create_swiss( const int size, uint64_t (*hash_function)(char *),
+                    int (*hash_key_compare)(char *, char *) ){
+    if(size <= 0)
+        return NULL;
+
+    hash_t* ht = (hash_t *) calloc(1, sizeof(hash_t));
+    if(!ht)
+        return NULL;
+    if((ht->index = initSwiss(size)) == NULL){
+        free(ht);
         return NULL;
     }
-    if(pthread_cond_init(&(ht->hcond), NULL) != 0){
-        perror("pthread_cond_init");
-        pthread_mutex_destroy(&ht->hlock);
+    if((ht->ebr = initEbr()) == NULL){
+        deleteSwiss(ht->index);
+        free(ht);
         return NULL;
     }
-    for(i=0; i<ht->size; i++){
-        ht->table[i] = (node_h *) malloc(sizeof(node_h));
-        ht->table[i]->n = 0;
-        ht->table[i]->list = NULL;
-        if(pthread_mutex_init(&(ht->table[i]->nhlock), NULL) != 0){
-            perror("pthread_mutex_init");
-            return NULL;
-        }
-        if(pthread_cond_init(&(ht->table[i]->nhcond), NULL) != 0){
-            perror("pthread_cond_init");
-            pthread_mutex_destroy(&(ht->table[i]->nhlock));
-            return NULL;
-        }
+    if(init_locks(ht) != 0){
+        deleteEbr(ht->ebr);
+        deleteSwiss(ht->index);
+        free(ht);
+        return NULL;
     }
     ht->hash_function = hash_function;
     ht->hash_key_compare = hash_key_compare;
 
     return ht;
- }
+}
 
 
 /**
@@ -152,33 +556,32 @@ hash_t* hash_create( const int size, unsigned int (*hash_function)(char *),
  * @returns : - pointer to the data corresponding to the key.
  *            - If the key was not found, return NULL.
  */
-data_hash_t* hash_find( const hash_t* ht, char* key ){
+data_hash_t* hash_find( hash_t* ht, char* key ){
+    if(!ht || !key)
+        return NULL;
+    return hash_find_h(ht, key, (* ht->hash_function)(key));
+}
+
+/**
+ * as hash_find, with the hash value of the key already computed; the
+ * item is valid until the end of the read section of the caller
+ * (hash_read_end)
+ *
+ * @param h : hash value of the key (hash_function)
+ */
+data_hash_t* hash_find_h( hash_t* ht, char* key, uint64_t h ){
       if(!ht || !key)
          return NULL;
+      if(ht->index)
+         return swiss_find(ht, key, h);
 
-     node_h *ptr_n;
      data_hash_t* ptr;
-     unsigned int key_hash;
 
-     key_hash = (* ht->hash_function)(key) % ht->size;
-
-     ptr_n = ht->table[key_hash];
-     lockNodeHash(ptr_n);
-     if(ptr_n->n <= 0){
-         unlockNodeHash(ptr_n);
-         return NULL;
-     }
-     ptr = ptr_n->list;
-     while(ptr != NULL){
-        if(ht->hash_key_compare(ptr->key, key) == 0){
-            unlockNodeHash(ptr_n);
-            return ptr;
-        }
-         ptr = ptr->next;
-     }
-     unlockNodeHash(ptr_n);
+     enterEbr(ht->ebr);
+     ptr = find_item(ht, key, h);
+     exitEbr(ht->ebr);
 
-     return NULL;
+     return ptr;
   }
 
  /**
@@ -194,23 +597,35 @@ data_hash_t* hash_find( const hash_t* ht, char* key ){
  * @exceptions : if one of the given parameters is NULL it returns NULL
  */
 data_hash_t* hash_insert( hash_t* ht, char* key, size_t size_key, void* data, size_t size_data, int fd ){
+    if(!ht || !key)
+        return NULL;
+    return hash_insert_h(ht, key, (* ht->hash_function)(key), size_key, data, size_data, fd);
+}
+
+/**
+ * as hash_insert, with the hash value of the key already computed
+ *
+ * @param h : hash value of the key (hash_function)
+ */
+data_hash_t* hash_insert_h( hash_t* ht, char* key, uint64_t h, size_t size_key, void* data, size_t size_data, int fd ){
       if(!ht || !key)
          return NULL;
+      if(ht->index)
+         return swiss_insert(ht, key, h, size_key, data, size_data, fd);
 
-     unsigned int key_hash;
+     int last = 0, grow = 0;
 
-     key_hash = (* ht->hash_function)(key) % ht->size;
- fprintf(stdout, "key = %s and hash_key = %d\n", key, key_hash);
-
-    node_h* ptr_n = ht->table[key_hash];
+    enterHash(ht);
+    node_h* ptr_n = bucket_of(ht, h, &last);
     lockNodeHash(ptr_n);
      // check if the data is already present in the table
      data_hash_t *ptr = NULL;
      if(ptr_n->n > 0){
          ptr = ptr_n->list;
          while( ptr != NULL ){
-             if(ht->hash_key_compare(ptr->key, key) == 0){
+             if(ptr->hash == h && ht->hash_key_compare(ptr->key, key) == 0){
                  unlockNodeHash(ptr_n);
+                 leaveHash(ht, last);
                  return NULL;
              }
              ptr=ptr->next;
@@ -221,15 +636,18 @@ data_hash_t* hash_insert( hash_t* ht, char* key, size_t size_key, void* data, si
     data_hash_t* new_item = file_create(key, size_key, data, size_data, fd);
     if(new_item == NULL){
         unlockNodeHash(ptr_n);
+        leaveHash(ht, last);
         return NULL;
     }
+    new_item->hash = h;
     new_item->next = ptr_n->list;
-    ptr_n->list = new_item;
-    ptr_n->n++;
+    __atomic_store_n(&ptr_n->list, new_item, __ATOMIC_RELEASE);
+    long n = ++ptr_n->n;
     unlockNodeHash(ptr_n);
-    lockHash(ht);
-    ht->number_of_item++;
-    unlockHashAndSignal(ht);
+    grow = count_new_item(ht, n);
+    leaveHash(ht, last);
+    if(grow)
+        start_resize(ht);
 
     return new_item;
 }
@@ -246,53 +664,61 @@ data_hash_t* hash_insert( hash_t* ht, char* key, size_t size_key, void* data, si
  * @exceptions : if one of the given parameters is NULL it returns NULL
  */
 data_hash_t* hash_update_insert( hash_t* ht, char* key, size_t size_key, void* data, size_t size_data, int fd ){
-      if(!ht || !data)
+      if(!ht || !key || !data)
          return NULL;
 
-      data_hash_t *curr = NULL, *prev = NULL;
+      data_hash_t *curr = NULL;
       data_hash_t *old_data = NULL;
-      unsigned int key_hash;
-
-      key_hash = (* ht->hash_function)(key) % ht->size;
+      uint64_t h = (* ht->hash_function)(key);
+      int last = 0, grow = 0;
+      long n = 0;
+
+      if(ht->index){
+         enterHashWrite(ht);
+         old_data = findSwiss(ht->index, key, h, ht->hash_key_compare);
+         if(old_data != NULL){
+            file_update_data(old_data, data, size_data);
+         }else if((curr = file_create(key, size_key, data, size_data, fd)) != NULL){
+            curr->hash = h;
+            if(insertSwiss(ht->index, curr) == -1)
+               file_free(curr);
+         }
+         exitHash(ht);
+         return old_data;
+      }
 
-      node_h* ptr_n = ht->table[key_hash];
+      enterHash(ht);
+      node_h* ptr_n = bucket_of(ht, h, &last);
       lockNodeHash(ptr_n);
       // I look for the value to replace
-      prev=NULL;
       curr=ptr_n->list;
       while( curr!=NULL ){
-         if(ht->hash_key_compare(curr->key, key) == 0){
-
-             if(prev == NULL) // if the item searched for at the top of the list
-                 ptr_n->list = curr->next;
-             else
-                 prev->next = curr->next;
-
+         if(curr->hash == h && ht->hash_key_compare(curr->key, key) == 0){
              old_data = curr;
              curr = NULL;
          }else{
-            prev=curr;
             curr=curr->next;
         }
      }
 
-    data_hash_t* new_item = NULL;
+    // the item stays where it is: the lookups walking the list do not lose the others
     if(old_data == NULL){
-        new_item = file_create(key, size_key, data, size_data, fd);
-        ptr_n->n++;
+        data_hash_t* new_item = file_create(key, size_key, data, size_data, fd);
+        if(new_item != NULL){
+            new_item->hash = h;
+            new_item->next = ptr_n->list;
+            __atomic_store_n(&ptr_n->list, new_item, __ATOMIC_RELEASE);
+            n = ++ptr_n->n;
+        }
     }else{
-        new_item = file_update_data(old_data, data, size_data);
-        old_data->next = NULL;
+        file_update_data(old_data, data, size_data);
     }
-
-    new_item->next = ptr_n->list;
-    ptr_n->list = new_item;
     unlockNodeHash(ptr_n);
-    if(!old_data){
-        lockHash(ht);
-        ht->number_of_item++;
-        unlockHash(ht);
-    }
+    if(n > 0)
+        grow = count_new_item(ht, n);
+    leaveHash(ht, last);
+    if(grow)
+        start_resize(ht);
 
     return old_data;
 }
@@ -306,49 +732,52 @@ data_hash_t* hash_update_insert( hash_t* ht, char* key, size_t size_key, void* d
   * @returns : - pointer to the data corresponding to the key.
   *            - If the key was not found, return NULL.
   */
-data_hash_t* hash_update_insert_append( const hash_t* ht, char* key, size_t size_key, void* data, size_t size_data, int fd ){
+data_hash_t* hash_update_insert_append( hash_t* ht, char* key, size_t size_key, void* data, size_t size_data, int fd ){
     if(!ht || !key || !data)
         return NULL;
+    return hash_update_insert_append_h(ht, key, (* ht->hash_function)(key), size_key, data, size_data, fd);
+}
 
-     data_hash_t *ptr = NULL;
-     unsigned int key_hash;
-
-     key_hash = (* ht->hash_function)(key) % ht->size;
+/**
+ * as hash_update_insert_append, with the hash value of the key already computed
+ *
+ * @param h : hash value of the key (hash_function)
+ */
+data_hash_t* hash_update_insert_append_h( hash_t* ht, char* key, uint64_t h, size_t size_key, void* data, size_t size_data, int fd ){
+    if(!ht || !key || !data)
+        return NULL;
 
-     node_h* ptr_n = ht->table[key_hash];
-     lockNodeHash(ptr_n);
-     ptr = ptr_n->list;
-     while(ptr != NULL){
-        if(ht->hash_key_compare(ptr->key, key) == 0){
-            if(file_has_lock(ptr, fd)){
-                file_append_content(ptr, data, size_data);
-                unlockNodeHash(ptr_n);
-                return ptr;
-            }else{
-                return NULL;
-            }
-         }
-        ptr = ptr->next;
+    // the contents are appended under the lock of the file
+    enterEbr(ht->ebr);
+    data_hash_t* ptr = hash_find_h(ht, key, h);
+    if(ptr != NULL){
+        if(file_has_lock(ptr, fd))
+            file_append_content(ptr, data, size_data);
+        else
+            ptr = NULL;
     }
-    unlockNodeHash(ptr_n);
+    exitEbr(ht->ebr);
 
-    return NULL;
+    return ptr;
 }
 
 int hash_size( hash_t* ht ){
     int sz = 0;
-    lockHash(ht);
-    sz = ht->size;
-    unlockHashAndSignal(ht);
+    enterHash(ht);
+    sz = (ht->index) ? (int) ht->index->cap : ht->size;
+    exitHash(ht);
     return sz;
 }
 
 int hash_length( hash_t* ht ){
     int sz = 0;
-    lockHash(ht);
-    sz = ht->number_of_item;
-    unlockHashAndSignal(ht);
-    return sz;
+    if(ht->index){
+        enterHash(ht);
+        sz = (int) ht->index->n;
+        exitHash(ht);
+        return sz;
+    }
+    return (int) readCounter(ht->count);
 }
 
 /**
@@ -357,7 +786,8 @@ int hash_length( hash_t* ht ){
  * @param key : the key of the element to be removed
  * @param hash_function : pointer to the hashing function to be used
  *
- * @returns: - the old given remorse
+ * @returns: - the old given remorse (to give back with hash_release_item:
+ *             other threads can still be reading it)
  *           - null if it were not there
  *
  * @exceptions : if one of the given parameters is NULL it returns NULL
@@ -365,32 +795,45 @@ int hash_length( hash_t* ht ){
 data_hash_t* hash_remove( hash_t* ht, char* key ){
     if(!ht || !key)
         return NULL;
+    return hash_remove_h(ht, key, (* ht->hash_function)(key));
+}
 
+/**
+ * as hash_remove, with the hash value of the key already computed
+ *
+ * @param h : hash value of the key (hash_function)
+ */
+data_hash_t* hash_remove_h( hash_t* ht, char* key, uint64_t h ){
+    if(!ht || !key)
+        return NULL;
     data_hash_t *curr, *prev;
-    unsigned int key_hash;
+    int last = 0;
 
-    key_hash = (* ht->hash_function)(key) % ht->size;
-
-    if(ht->table[key_hash] == NULL)
-         return NULL;
+    if(ht->index){
+        enterHashWrite(ht);
+        curr = removeSwiss(ht->index, key, h, ht->hash_key_compare);
+        exitHash(ht);
+        return curr;
+    }
 
     // I look for the element with key key
-    node_h* ptr_n = ht->table[key_hash];
+    enterHash(ht);
+    node_h* ptr_n = bucket_of(ht, h, &last);
     lockNodeHash(ptr_n);
     prev=NULL;
     curr=ptr_n->list;
     while( curr!=NULL ){
-        if(ht->hash_key_compare(curr->key, key) == 0){
+        if(curr->hash == h && ht->hash_key_compare(curr->key, key) == 0){
+            // 'next' of the item is kept: a lookup on it goes on in the list
             if(prev == NULL)
-                ptr_n->list = curr->next;
+                __atomic_store_n(&ptr_n->list, curr->next, __ATOMIC_RELEASE);
             else
-                prev->next = curr->next;
+                __atomic_store_n(&prev->next, curr->next, __ATOMIC_RELEASE);
 
             ptr_n->n--;
             unlockNodeHash(ptr_n);
-            lockHash(ht);
-            ht->number_of_item--;
-            unlockHash(ht);
+            leaveHash(ht, last);
+            addCounter(ht->count, -1);
             return curr;
         }
 
@@ -398,9 +841,24 @@ data_hash_t* hash_remove( hash_t* ht, char* key ){
         curr=curr->next;
     }
     unlockNodeHash(ptr_n);
+    leaveHash(ht, last);
     return NULL;
 }
 
+/**
+ * bucket 'j' of the new table, once the old bucket that feeds it has been
+ * moved; the caller holds the table in read mode
+ */
+static node_h* settled_bucket( hash_t* ht, int j, int* last ){
+    if(ht->old_table != NULL && move_bucket(ht, j & (ht->old_size - 1)))
+        *last = 1;
+    return ht->table[j];
+}
+
+/**
+ * copy of the file that follows the position (l, c) : bucket, place in the
+ * bucket; a resize between two calls can repeat or skip a few files
+ */
 data_hash_t* get_copy_file_hash(hash_t* ht, int* l, int* c){
     if(!ht || !l || !c || *l<0 || *c < 1)
         return NULL;
@@ -409,16 +867,32 @@ data_hash_t* get_copy_file_hash(hash_t* ht, int* l, int* c){
     node_h* ptr_n = NULL;
     int i = 1;
     int is_new = 0;
+    int last = 0;
+
+    if(ht->index){
+        // (l) is the next slot of the index to look at
+        long pos = *l;
+        enterHash(ht);
+        if((d = nextSwiss(ht->index, &pos)) != NULL)
+            r = file_copy(d);
+        exitHash(ht);
+        *l = (int) pos;
+        return r;
+    }
 
+    enterHash(ht);
     back_begin:
-        if(*l < hash_size(ht)){
-            ptr_n = ht->table[*l];
+        if(*l < ht->size){
+            ptr_n = settled_bucket(ht, *l, &last);
             lockNodeHash(ptr_n);
             while(ptr_n->list == NULL){
                 unlockNodeHash(ptr_n);
                 (*l)++;
-                if(*l >= hash_size(ht)) return NULL;
-                ptr_n = ht->table[*l];
+                if(*l >= ht->size){
+                    leaveHash(ht, last);
+                    return NULL;
+                }
+                ptr_n = settled_bucket(ht, *l, &last);
                 lockNodeHash(ptr_n);
             }
             d = ptr_n->list;
@@ -441,6 +915,7 @@ data_hash_t* get_copy_file_hash(hash_t* ht, int* l, int* c){
             }
             unlockNodeHash(ptr_n);
         }
+    leaveHash(ht, last);
 
     return r;
 }
@@ -459,37 +934,112 @@ int hash_delete( hash_t* ht, char *key ){
         return -1;
 
     data_hash_t *curr = NULL, *prev = NULL;
-    unsigned int key_hash = -1;
-
-    key_hash = (* ht->hash_function)(key) % ht->size;
+    uint64_t h = (* ht->hash_function)(key);
+    int last = 0;
+
+    if(ht->index){
+        if((curr = hash_remove_h(ht, key, h)) == NULL)
+            return -1;
+        hash_release_item(ht, curr);
+        return 0;
+    }
 
-    node_h* ptr_n = ht->table[key_hash];
+    enterHash(ht);
+    node_h* ptr_n = bucket_of(ht, h, &last);
     lockNodeHash(ptr_n);
     prev = NULL;
     curr=ptr_n->list;
     while( curr!=NULL ){
-        if(ht->hash_key_compare(curr->key, key) == 0){
+        if(curr->hash == h && ht->hash_key_compare(curr->key, key) == 0){
             if(prev == NULL){
-                ptr_n->list = curr->next;
+                __atomic_store_n(&ptr_n->list, curr->next, __ATOMIC_RELEASE);
             }else{
-                prev->next = curr->next;
+                __atomic_store_n(&prev->next, curr->next, __ATOMIC_RELEASE);
             }
             ptr_n->n--;
             unlockNodeHash(ptr_n);
-            lockHash(ht);
-            ht->number_of_item--;
-            unlockHash(ht);
-            file_free(curr);
+            leaveHash(ht, last);
+            addCounter(ht->count, -1);
+            hash_release_item(ht, curr);
             return 0;
         }
         prev = curr;
         curr = curr->next;
     }
     unlockNodeHash(ptr_n);
+    leaveHash(ht, last);
 
     return -1;
   }
 
+/**
+* moves all the buckets of a resize still running and drops the old table:
+* afterwards all the items are in 'table'
+*
+* @param ht : the hash table
+*/
+void hash_finish_resize( hash_t* ht ){
+    // an index grows in one go
+    if(!ht || ht->index)
+        return;
+
+    int last = 0;
+    enterHash(ht);
+    if(ht->old_table != NULL){
+        for(int i=0; i<ht->old_size; i++)
+            last |= move_bucket(ht, i);
+    }
+    leaveHash(ht, last);
+}
+
+/**
+* next item of a visit of all the table, without locks: nobody must change
+* the table in the meantime
+*
+* @param pos : next bucket (or slot of the index) to look at, 0 to start
+* @param item : item returned by the previous call, NULL to start
+*
+* @returns : the next item, NULL at the end of the table
+*/
+data_hash_t* hash_next_item( hash_t* ht, long* pos, data_hash_t* item ){
+    if(!ht || !pos)
+        return NULL;
+    if(ht->index)
+        return nextSwiss(ht->index, pos);
+    if(item != NULL && item->next != NULL)
+        return item->next;
+    while(*pos < ht->size){
+        data_hash_t* list = ht->table[(*pos)++]->list;
+        if(list != NULL)
+            return list;
+    }
+    return NULL;
+}
+
+/**
+* enters a read section: the items found until hash_read_end are not
+* released, even if another thread removes them. The sections can be nested
+*/
+void hash_read_begin( hash_t* ht ){
+    if(ht)
+        enterEbr(ht->ebr);
+}
+
+void hash_read_end( hash_t* ht ){
+    if(ht)
+        exitEbr(ht->ebr);
+}
+
+/**
+* releases an item removed from the table (hash_remove) once no thread
+* can still be reading it
+*/
+void hash_release_item( hash_t* ht, data_hash_t* item ){
+    if(!ht || !item)
+        return;
+    retireEbr(ht->ebr, &item->retire, &release_item);
+}
+
 /**
 * Free hash table structures
 *
@@ -505,7 +1055,19 @@ int hash_destroy( hash_t* ht ){
     node_h* ptr_n = NULL;
     data_hash_t *ptr_list, *curr, *next;
 
-    lockHash(ht);
+    if(ht->index){
+        long pos = 0;
+        while((curr = nextSwiss(ht->index, &pos)) != NULL){
+            file_free(curr);
+        }
+        deleteSwiss(ht->index);
+        deleteEbr(ht->ebr);
+        pthread_rwlock_destroy(&ht->tlock);
+        free(ht);
+        return 0;
+    }
+
+    hash_finish_resize(ht);
     // deletion of the key and the content of each element in the table
     for(int i=0; i<ht->size; i++){
         ptr_n = ht->table[i];
@@ -520,14 +1082,16 @@ int hash_destroy( hash_t* ht ){
         }
         ptr_n->n = 0;
         unlockNodeHash(ptr_n);
-        pthread_mutex_destroy(&ptr_n->nhlock);
-        pthread_cond_destroy(&ptr_n->nhcond);
         free(ptr_n);
     }
-    unlockHash(ht);
-    pthread_mutex_destroy(&ht->hlock);
-    pthread_cond_destroy(&ht->hcond);
+    // the items removed and the old tables still waiting for the readers
+    deleteEbr(ht->ebr);
+    deleteCounter(ht->count);
+    free_stripes(ht);
+    pthread_rwlock_destroy(&ht->tlock);
     free(ht->table);
+    free(ht->tab);
+    free(ht->tab_end);
     free(ht);
 
      return 0;
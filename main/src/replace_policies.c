@@ -105,8 +105,8 @@ void deleteQueueP( Queue_p* qp ){
         freeNodeP(p);
     }
     qp->qplen = 0;
-    if(&qp->qplock) pthread_mutex_destroy(&qp->qplock);
-    if(&qp->qpcond) pthread_cond_destroy(&qp->qpcond);
+    pthread_mutex_destroy(&qp->qplock);
+    pthread_cond_destroy(&qp->qpcond);
     free((void *) qp);
 }
 
@@ -122,7 +122,7 @@ int push_qp( Queue_p* qp, char* p_key, size_t p_sz ){
 
     n->p_sz     = p_sz;
     n->p_key = malloc(p_sz);
-    memset(p_key, '\0', p_sz);
+    memset(n->p_key, '\0', p_sz);
     strncpy(n->p_key,p_key, p_sz);
     n->next     = NULL;
 
@@ -162,6 +162,32 @@ char* pop_qp( Queue_p* qp ){
     return key;
 }
 
+/**
+* like pop_qp, but does not wait: returns NULL if the queue is empty
+*/
+char* try_pop_qp( Queue_p* qp ){
+    if(qp == NULL){
+        errno = EINVAL;
+        return NULL;
+    }
+
+    lockQueueP(qp);
+    if(qp->head == NULL){
+        unlockQueueP(qp);
+        return NULL;
+    }
+    Node_p* n   = qp->head;
+    qp->head    = qp->head->next;
+    qp->qplen   -= 1;
+    unlockQueueP(qp);
+
+    char* key   = (char *) malloc(n->p_sz);
+    memset(key, '\0', n->p_sz);
+    strncpy(key, n->p_key, n->p_sz);
+    freeNodeP(n);
+    return key;
+}
+
 char* get_put_last_qp( Queue_p* qp ){
     char* str_get = NULL;
     lockQueueP(qp);
@@ -200,6 +226,7 @@ Node_p* findNodeP( Queue_p* qp, char* key ){
         if(strcmp(key, p->p_key) == 0){
             if(prev != NULL) prev->next = p->next;
             else qp->head = p->next;
+            if(qp->tail == p) qp->tail = prev;
             qp->qplen--;
             unlockQueuePAndSignal(qp);
             return p;
@@ -0,0 +1,305 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file restart.c
+ *
+ * Implementation of the hot restart: control socket, arena of the files
+ * and passing of the descriptors between the old and the new server
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "my_hash.h"
+#include "my_file.h"
+#include "restart.h"
+
+// descriptors passed: the listening socket and the arena
+#define RESTART_N_FD 2
+
+// the arena can no longer change once passed
+#define RESTART_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+
+/************************** utility functions ************************/
+
+static int addr_control( const char* path, struct sockaddr_un* addr ){
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr->sun_path)){
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strncpy(addr->sun_path, path, sizeof(addr->sun_path) - 1);
+    return 0;
+}
+
+/**
+* writes in the arena 'base' (NULL to only compute the size) the index
+* and the contents of the files of 'files', in the order of 'order'
+* (the replacement queue) so that the new server keeps it
+*
+* the workers have finished: nobody changes the table in the meantime
+*
+* @returns : the size of the arena
+*/
+static size_t fill_arena( hash_t* files, Queue_p* order, char* base, unsigned long* n_files ){
+    restart_entry_t* entry = (restart_entry_t *) (base + sizeof(restart_hdr_t));
+    unsigned long n = 0;
+    size_t off = 0;
+    Node_p* node = NULL;
+
+    // the names and the contents follow the index
+    if(base != NULL) off = sizeof(restart_hdr_t) + (*n_files) * sizeof(restart_entry_t);
+    for(node = order->head; node != NULL; node = node->next){
+        data_hash_t* f = hash_find(files, node->p_key);
+        fbuf_t* content = NULL;
+        if(f == NULL || file_pin_content(f, &content) == -1) continue;
+        size_t size_data = (content) ? content->size : 0;
+        if(base != NULL && n < *n_files){
+            entry[n].key_off   = off;
+            entry[n].size_key  = f->size_key;
+            memcpy(base + off, f->key, f->size_key);
+            entry[n].data_off  = off + f->size_key;
+            entry[n].size_data = size_data;
+            if(size_data > 0) memcpy(base + entry[n].data_off, content->data, size_data);
+        }
+        off += f->size_key + size_data;
+        n++;
+        if(content) fbuf_release(content);
+    }
+    if(base == NULL){
+        *n_files = n;
+        off += sizeof(restart_hdr_t) + n * sizeof(restart_entry_t);
+    }
+    return off;
+}
+
+
+/************************** restart interface ************************/
+
+/**
+* creates the control socket on which the next server will connect
+*
+* @param path : path of the control socket (an old socket is removed)
+*
+* @returns : the listening socket, -1 on failure and errno is set
+*/
+int restart_listen( const char* path ){
+    struct sockaddr_un addr;
+    int fd = -1;
+    if(!path){
+        errno = EINVAL;
+        return -1;
+    }
+    if(addr_control(path, &addr) == -1) return -1;
+    unlink(path);
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) return -1;
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(fd, 1) == -1){
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+* asks the server listening on the control socket to pass its listening
+* socket and its files, and waits until it has finished serving its clients
+*
+* @param path : path of the control socket
+* @param r : where to write the state received
+*
+* @returns : 0 on success, -1 if there is no old server or on failure
+*            (the new server then starts from scratch)
+*/
+int restart_request( const char* path, restart_t* r ){
+    struct sockaddr_un addr;
+    int fd = -1, fds[RESTART_N_FD] = {-1, -1};
+    restart_hdr_t hdr;
+    ssize_t n = 0;
+
+    if(!path || !r){
+        errno = EINVAL;
+        return -1;
+    }
+    r->fd_listen = -1;
+    r->hdr = NULL;
+    r->entry = NULL;
+    if(addr_control(path, &addr) == -1) return -1;
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) return -1;
+    if(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1){
+        // no server is running
+        close(fd);
+        return -1;
+    }
+
+    union {
+        char            buf[CMSG_SPACE(RESTART_N_FD * sizeof(int))];
+        struct cmsghdr  align;
+    } ctl;
+    struct iovec iov = { &hdr, sizeof(restart_hdr_t) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    while((n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL)) == -1 && errno == EINTR);
+    close(fd);
+    if(n != sizeof(restart_hdr_t) || hdr.magic != RESTART_MAGIC){
+        errno = EPROTO;
+        n = -1;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+        && cmsg->cmsg_len == CMSG_LEN(RESTART_N_FD * sizeof(int))){
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    }else if(n != -1){
+        errno = EPROTO;
+        n = -1;
+    }
+    if(n == -1){
+        if(fds[0] != -1) close(fds[0]);
+        if(fds[1] != -1) close(fds[1]);
+        return -1;
+    }
+
+    r->fd_listen = fds[0];
+    // only a sealed arena is read: the old server can no longer change it
+    if(hdr.n_files > 0 && (fcntl(fds[1], F_GET_SEALS) & RESTART_SEALS) != RESTART_SEALS){
+        fprintf(stderr, "restart: the arena received is not sealed, the files are ignored\n");
+    }else if(hdr.n_files > 0){
+        void* base = mmap(NULL, hdr.size, PROT_READ, MAP_PRIVATE, fds[1], 0);
+        if(base == MAP_FAILED){
+            // the socket is enough to go on, without the files
+            perror("mmap");
+        }else{
+            r->hdr = (const restart_hdr_t *) base;
+            r->entry = (const restart_entry_t *) ((const char *) base + sizeof(restart_hdr_t));
+        }
+    }
+    close(fds[1]);
+    return 0;
+}
+
+/**
+* releases the arena received (the listening socket stays open)
+*/
+void restart_release( restart_t* r ){
+    if(!r || !r->hdr) return;
+    munmap((void *) r->hdr, r->hdr->size);
+    r->hdr = NULL;
+    r->entry = NULL;
+}
+
+/**
+* passes the listening socket and the files to the new server
+*
+* @param fd : connection with the new server on the control socket
+* @param fd_listen : listening socket of the server
+* @param files : the files of the server
+* @param order : the replacement queue of the files (oldest first)
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+int restart_give( int fd, int fd_listen, hash_t* files, Queue_p* order ){
+    restart_hdr_t hdr;
+    int memfd = -1;
+    ssize_t n = 0;
+
+    if(fd < 0 || fd_listen < 0 || !files || !order){
+        errno = EINVAL;
+        return -1;
+    }
+    hdr.magic = RESTART_MAGIC;
+    hdr.n_files = 0;
+    hdr.size = fill_arena(files, order, NULL, &hdr.n_files);
+
+    if((memfd = memfd_create("fss-restart", MFD_CLOEXEC | MFD_ALLOW_SEALING)) == -1) return -1;
+    if(ftruncate(memfd, hdr.size) == -1){
+        close(memfd);
+        return -1;
+    }
+    char* base = mmap(NULL, hdr.size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if(base == MAP_FAILED){
+        close(memfd);
+        return -1;
+    }
+    memcpy(base, &hdr, sizeof(restart_hdr_t));
+    fill_arena(files, order, base, &hdr.n_files);
+    munmap(base, hdr.size);
+    // after munmap: F_SEAL_WRITE fails while a writable mapping exists
+    if(fcntl(memfd, F_ADD_SEALS, RESTART_SEALS) == -1){
+        int e = errno;
+        close(memfd);
+        errno = e;
+        return -1;
+    }
+
+    union {
+        char            buf[CMSG_SPACE(RESTART_N_FD * sizeof(int))];
+        struct cmsghdr  align;
+    } ctl;
+    int fds[RESTART_N_FD] = { fd_listen, memfd };
+    struct iovec iov = { &hdr, sizeof(restart_hdr_t) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(&ctl, 0, sizeof(ctl));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(RESTART_N_FD * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    while((n = sendmsg(fd, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR);
+    int e = errno;
+    close(memfd);
+    errno = e;
+    return (n == sizeof(restart_hdr_t)) ? 0 : -1;
+}
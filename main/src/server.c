@@ -33,6 +33,7 @@
 */
 
 // #define _POSIX_C_SOURCE 200112L
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,22 +47,38 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <sys/uio.h>
 #include <sys/un.h>
+#include <poll.h>
+#include <stdint.h>
 #include <sys/stat.h>
 
 #include <assert.h>
 
 #include "communication.h"
 #include "utils.h"
+#include "counter.h"
 #include "my_hash.h"
 #include "my_file.h"
 //#include "queue.h"
 #include "buffer.h"
+#include "dispatch.h"
+#include "completion.h"
+#include "drr.h"
+#include "wheel.h"
+#include "connection.h"
+#include "uring.h"
+#include "admission.h"
+#include "restart.h"
+#include "shmring.h"
 #include "replace_policies.h"
 
 // definition of the policy to be used for the replacement
@@ -71,18 +88,74 @@
 #define PRINT_LOG
 
 // define for all programs
-#define DIM_HASH_TABLE 103
+#define DIM_HASH_TABLE 128     // initial buckets of the table of the files: it grows with them
 
 #define MAX_FILES_EJECTED 10
 
+// SIZE_MEMORY is given in Mbytes
+#define MBYTE (1024UL * 1024UL)
+
+// maximum number of events collected by a single 'epoll_wait'
+#define MAX_EPOLL_EVENTS 64
+
+// size of the submission ring of a reactor on io_uring
+#define URING_ENTRIES 256
+
+// length of a tick of the timer wheel of a reactor (milliseconds)
+#define TIMER_TICK 100
+
+// milliseconds before accepting again after a lack of descriptors
+#define ACCEPT_RETRY 100
+
+// milliseconds given to the clients connected to receive their replies
+// when the server stops normally (SIGHUP or hot restart)
+#define DRAIN_TIMEOUT 5000
+
+// kinds of wait of a connection, each one with its timeout
+#define TIMEOUT_NONE    (0)
+#define TIMEOUT_IDLE    (1)
+#define TIMEOUT_HEADER  (2)
+#define TIMEOUT_BODY    (3)
+
+// operations of a reactor on io_uring, in the low bits of the user data
+// (the connections are aligned to 8 bytes)
+#define OP_URING_RECV   (1)
+#define OP_URING_SEND   (2)
+#define OP_URING_ACCEPT (3)
+#define OP_URING_DONE   (4)
+#define OP_URING_STOP   (5)
+#define OP_URING_CANCEL (6)
+#define OP_URING_TIMER  (7)
+#define OP_URING_MASK   (7)
+#define URING_DATA( c, op ) ((uint64_t) (uintptr_t) (c) | (op))
+
+// backends of the reactors
+#define IO_BACKEND_EPOLL (0)
+#define IO_BACKEND_URING (1)
+
+// indexes of the table of the files
+#define FILES_INDEX_CHAINED (0)
+#define FILES_INDEX_SWISS   (1)
+
 // define for config server
-#define n_param_config 6
+#define n_param_config 17
 #define t_w "THREAD_WORKERS"
 #define s_m "SIZE_MEMORY"
 #define n_f "NUMBER_OF_FILES"
 #define s_n "SOCKET_NAME"
 #define l_n "LOG_FILE_NAME"
 #define c_c "CONCURRENT_CLIENTS"
+#define i_t "IO_THREADS"
+#define i_b "IO_BACKEND"
+#define a_q "ACCEPT_QUEUE"
+#define w_a "WORKER_AFFINITY"
+#define c_s "CONTROL_SOCKET"
+#define i_o "IDLE_TIMEOUT"
+#define h_o "HEADER_TIMEOUT"
+#define b_o "BODY_TIMEOUT"
+#define s_r "SHM_RING_SIZE"
+#define f_i "FILES_INDEX"
+#define f_l "FILES_LOCK_STRIPES"
 
 // reasons for failure of operations
 #define ERROR_OF_CREATE 101
@@ -121,22 +194,18 @@
 #define R_RFI_LOCK "ERROR 902: the file was not previously locked"
 #define ERROR_SERVER 1000
 #define R_SERVER "ERROR 1000: the server does not recognize the request made"
+#define ERROR_SHM 1100
+#define R_SHM "ERROR 1100: the shared-memory rings are not available"
 
 static unsigned long tempo_dgb = 1;
 FILE* fd_log = NULL;
 time_t tm;
 char str_tm[30];
 
-int n_workers = 1;
-pthread_mutex_t m_workers = PTHREAD_MUTEX_INITIALIZER;
 
 static volatile sig_atomic_t close_server = 0;
 static volatile sig_atomic_t finish_work = 0;
 
-unsigned long client_all_server = 0;
-size_t space_all_server = 0;
-// unsigned long files_all_server = 0;
-
 /**
 * Definition of the structure that will have the server configuration data
 */
@@ -147,16 +216,30 @@ typedef struct _config_for_server{
     unsigned long   number_of_files;
     char*           socket_name;
     char*           log_file_name;
+    unsigned long   io_threads;
+    int             io_backend;
+    unsigned long   accept_queue;
+    unsigned long   worker_affinity;
+    char*           control_socket;
+    unsigned long   idle_timeout;
+    unsigned long   header_timeout;
+    unsigned long   body_timeout;
+    unsigned long   shm_ring_size;
+    int             files_index;
+    unsigned long   files_lock_stripes;
 }cfs;
 
+/**
+* statistics of the server: sharded counters, updated by all the
+* threads without locks (the totals are read at the end of the run)
+*/
 typedef struct _info_server{
-    unsigned long currently_number_threads_workers;
-    unsigned long currently_client_connected;
-    unsigned long currently_space_occupied;
-    unsigned long currently_number_files;
-
-    pthread_mutex_t cntw;
-    pthread_mutex_t cso;
+    Counter_t* currently_number_threads_workers;
+    Counter_t* currently_client_connected;
+    Counter_t* currently_space_occupied;
+    Counter_t* currently_number_files;
+    Counter_t* client_all_server;
+    Counter_t* space_all_server;
 } info_server;
 
 static info_server IS;
@@ -186,8 +269,8 @@ static cfs settings_server = {0, 0, 0, 0, NULL};
 // file containers
 static hash_t *files_server;
 
-// request buffer
-static Buffer_t* buffer_request;
+// run queues of the workers
+static Dispatch_t* dispatch_request;
 
 // list of files in server
 static Queue_p* list_files;
@@ -201,10 +284,6 @@ typedef struct _count_elem{
 } count_elem_t;
 
 
-/******************* pipe for communication Workers -> Master ****************/
-
-static int canale[2];
-
 /********* cleanup function ****/
 void cleanup_socket( void ){
     unlink(settings_server.socket_name);
@@ -237,79 +316,119 @@ void sigterm( int sign ){
 
 /********** *********/
 
+/**
+* creates the counters of the statistics, one shard for each thread
+* that can update them (workers, reactors, control thread)
+*
+* @returns : 0 on success, -1 on failure
+*/
+static int init_info_server( void ){
+    unsigned long n = settings_server.thread_workers + settings_server.io_threads + 1;
+    if((IS.currently_number_threads_workers = initCounter(n)) == NULL
+        || (IS.currently_client_connected = initCounter(n)) == NULL
+        || (IS.currently_space_occupied = initCounter(n)) == NULL
+        || (IS.currently_number_files = initCounter(n)) == NULL
+        || (IS.client_all_server = initCounter(n)) == NULL
+        || (IS.space_all_server = initCounter(n)) == NULL) return -1;
+    return 0;
+}
+
+static void delete_info_server( void ){
+    deleteCounter(IS.currently_number_threads_workers);
+    deleteCounter(IS.currently_client_connected);
+    deleteCounter(IS.currently_space_occupied);
+    deleteCounter(IS.currently_number_files);
+    deleteCounter(IS.client_all_server);
+    deleteCounter(IS.space_all_server);
+}
+
 static void inc_num_threads( void ){
-    LOCK(&IS.cntw);
-    IS.currently_number_threads_workers++;
-    UNLOCK(&IS.cntw);
+    addCounter(IS.currently_number_threads_workers, 1);
 }
 
 static void dec_num_threads( void ){
-    LOCK(&IS.cntw);
-    IS.currently_number_threads_workers--;
-    UNLOCK(&IS.cntw);
+    addCounter(IS.currently_number_threads_workers, -1);
 }
 
 static unsigned long get_num_threads( void ){
-    LOCK(&IS.cntw);
-    unsigned long r = IS.currently_number_threads_workers;
-    UNLOCK(&IS.cntw);
-    return r;
+    return (unsigned long) readCounter(IS.currently_number_threads_workers);
 }
 
 static void inc_num_client( void ){
-    LOCK(&IS.cntw);
-    IS.currently_number_threads_workers++;
-    UNLOCK(&IS.cntw);
-    client_all_server =+ 1;;
+    addCounter(IS.currently_client_connected, 1);
+    addCounter(IS.client_all_server, 1);
 }
 
 static void dec_num_client( void ){
-    LOCK(&IS.cntw);
-    IS.currently_number_threads_workers--;
-    UNLOCK(&IS.cntw);
-}
-
-static unsigned long get_num_client( void ){
-    LOCK(&IS.cntw);
-    unsigned long r = IS.currently_number_threads_workers;
-    UNLOCK(&IS.cntw);
-    return r;
+    addCounter(IS.currently_client_connected, -1);
 }
 
 
-static void incSpaceOccupied( int inc_file, size_t space ){
-    LOCK(&IS.cso);
-    IS.currently_number_files += inc_file;
-    IS.currently_space_occupied += space;
-    UNLOCK(&IS.cso);
-    space_all_server += space;
+/**
+* 'inc_file' files and 'space' bytes (name and contents) more, or less
+* when negative; only what is added counts in the total of the server
+*/
+static void incSpaceOccupied( int inc_file, long space ){
+    addCounter(IS.currently_number_files, inc_file);
+    addCounter(IS.currently_space_occupied, space);
+    if(space > 0) addCounter(IS.space_all_server, space);
 }
 
-/*
 static unsigned long getNumberFiles( void ){
-    LOCK(&IS.cso);
-    unsigned long r = IS.currently_number_files;
-    UNLOCK(&IS.cso);
-    return r;
+    return (unsigned long) readCounter(IS.currently_number_files);
 }
-*/
 
 /*
 static unsigned long getSpaceOccupied( void ){
-    LOCK(&IS.cso);
-    unsigned long r = IS.currently_space_occupied;
-    UNLOCK(&IS.cso);
-    return r;
+    return (unsigned long) readCounter(IS.currently_space_occupied);
 }
 */
 static int hasSpace( size_t sz ){
     int r = 0;
-    LOCK(&IS.cso);
-    if(IS.currently_space_occupied < (settings_server.size_memory+sz)) r = 1;
-    UNLOCK(&IS.cso);
+    if((unsigned long) readCounter(IS.currently_space_occupied) + sz <= settings_server.size_memory * MBYTE) r = 1;
     return r;
 }
 
+// releases a file (a copy or a file ejected) once its contents have been sent
+// to the client: the workers that found an ejected file can still be using it
+static void release_file( void* f ){
+    hash_release_item(files_server, (file_t *) f);
+}
+
+/**
+* removes the oldest files of the replacement queue until 'sz' bytes more
+* (and one more file if 'new_file') fit in the limits of the server
+*
+* the files removed go in 'mf_e', to be sent to the client: when it is
+* full the last one is released and replaced
+*/
+static void eject_files( size_t sz, int new_file, file_t** mf_e, int* n_fe ){
+    while(!hasSpace(sz) || (new_file && getNumberFiles() >= settings_server.number_of_files)){
+        char* pf = NULL;
+        // nothing left to remove: the file is stored over the limit
+        if((pf = try_pop_qp(list_files)) == NULL) break;
+        #ifdef PRINT_LOG
+        tm = time(NULL);
+        memset(str_tm, '\0', 30);
+        assert(asctime_r(localtime(&tm), str_tm));
+        str_tm[strcspn(str_tm, "\n")] = '\0';
+        fprintf(fd_log, "[%s] : [WORKER] : CAPACITY MISS : insufficient space to insert the new file, I remove the file '%s' from the server.\n",
+                            str_tm, pf);
+        #endif
+        // the file may have been removed in the meantime
+        file_t* fe = hash_remove(files_server, pf);
+        free(pf);
+        if(fe == NULL) continue;
+        incSpaceOccupied(-1, -(long) (fe->size_key + fe->size_data));
+        if(*n_fe < MAX_FILES_EJECTED){
+            mf_e[(*n_fe)++] = fe;
+        }else{
+            hash_release_item(files_server, mf_e[MAX_FILES_EJECTED-1]);
+            mf_e[MAX_FILES_EJECTED-1] = fe;
+        }
+    }
+}
+
 /*********** function to initialised the structure for counting elements in mutual exclusion **********/
 
 count_elem_t* init_struct_count_elem( void ){
@@ -434,6 +553,9 @@ void cancel_cfs(){
     if(config->log_file_name)
         free(config->log_file_name);
     config->log_file_name = NULL;
+    if(config->control_socket)
+        free(config->control_socket);
+    config->control_socket = NULL;
 }
 
 /**
@@ -448,6 +570,29 @@ void reset_cfs(){
     config->thread_workers = 0;
     config->concurrent_clients = 0;
     config->size_memory = 0;
+    // optional: by default a single reactor
+    config->io_threads = 1;
+    config->io_backend = IO_BACKEND_EPOLL;
+    // optional: by default the clients beyond the limit wait in the backlog
+    config->accept_queue = 0;
+    // optional: by default the workers run on any CPU
+    config->worker_affinity = 0;
+    // optional: seconds before closing a client that sends nothing (0 = never)
+    config->idle_timeout = 300;
+    // optional: seconds to receive the header of a request (0 = no limit)
+    config->header_timeout = 10;
+    // optional: seconds without receiving any byte of the data of a request (0 = no limit)
+    config->body_timeout = 60;
+    // optional: bytes of each shared-memory ring of a client (0 = no rings)
+    config->shm_ring_size = 0;
+    // optional: by default the files are in the lists of the buckets
+    config->files_index = FILES_INDEX_CHAINED;
+    // optional: locks shared by the buckets of the table of the files
+    config->files_lock_stripes = HASH_LOCK_STRIPES;
+    // optional: by default no hot restart
+    if(config->control_socket)
+        free(config->control_socket);
+    config->control_socket = NULL;
     if(config->socket_name)
         free(config->socket_name);
     config->socket_name = NULL;
@@ -488,6 +633,12 @@ int is_correct_cfs(){
     if(config->log_file_name == NULL || strlen(config->log_file_name) == 0)
         return -1;
 
+    if(config->io_threads <= 0)
+        return -1;
+
+    if(config->files_lock_stripes <= 0 || config->files_lock_stripes > INT_MAX)
+        return -1;
+
     return 0;
 }
 
@@ -508,7 +659,7 @@ void read_config_server(){
                         config->thread_workers);
     fprintf(stdout, "number of concurrent clients = %ld\n",
                         config->concurrent_clients);
-    fprintf(stdout, "size of memory for server = %ld\n",
+    fprintf(stdout, "size of memory for server = %ld Mbytes\n",
                         config->size_memory);
     fprintf(stdout, "max number of files to write on server = %ld\n",
                         config->number_of_files);
@@ -516,6 +667,28 @@ void read_config_server(){
                         config->socket_name);
     fprintf(stdout, "name to use for the log file : %s\n",
                         config->log_file_name);
+    fprintf(stdout, "number of I/O threads = %ld\n",
+                        config->io_threads);
+    fprintf(stdout, "I/O backend : %s\n",
+                        (config->io_backend == IO_BACKEND_URING) ? "io_uring" : "epoll");
+    fprintf(stdout, "clients accepted waiting for a place = %ld\n",
+                        config->accept_queue);
+    fprintf(stdout, "workers pinned to a CPU : %s\n",
+                        (config->worker_affinity) ? "yes" : "no");
+    fprintf(stdout, "control socket for the hot restart : %s\n",
+                        (config->control_socket) ? config->control_socket : "none");
+    fprintf(stdout, "seconds before closing an idle client = %ld\n",
+                        config->idle_timeout);
+    fprintf(stdout, "seconds to receive the header of a request = %ld\n",
+                        config->header_timeout);
+    fprintf(stdout, "seconds to wait for the data of a request = %ld\n",
+                        config->body_timeout);
+    fprintf(stdout, "bytes of the shared-memory rings of a client = %ld\n",
+                        config->shm_ring_size);
+    fprintf(stdout, "index of the files : %s\n",
+                        (config->files_index == FILES_INDEX_SWISS) ? "swiss" : "chained");
+    fprintf(stdout, "locks of the buckets of the files = %ld\n",
+                        config->files_lock_stripes);
     fflush(stdout);
 
     #ifdef PRINT_INFO
@@ -559,6 +732,84 @@ int parsing_str_for_config_server( char* str ){
             if( (config->concurrent_clients = (unsigned long) getNumber(token, 10)) < 0)
                 return -1;
 
+        }else if(strncmp(token, i_t, sizeof(i_t)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->io_threads = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, a_q, sizeof(a_q)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->accept_queue = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, w_a, sizeof(w_a)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->worker_affinity = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, i_o, sizeof(i_o)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->idle_timeout = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, h_o, sizeof(h_o)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->header_timeout = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, b_o, sizeof(b_o)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->body_timeout = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, s_r, sizeof(s_r)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->shm_ring_size = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, f_i, sizeof(f_i)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if(strcmp(token, "swiss") == 0)
+                config->files_index = FILES_INDEX_SWISS;
+            else if(strcmp(token, "chained") == 0)
+                config->files_index = FILES_INDEX_CHAINED;
+            else
+                return -1;
+
+        }else if(strncmp(token, f_l, sizeof(f_l)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if( (config->files_lock_stripes = (unsigned long) getNumber(token, 10)) < 0)
+                return -1;
+
+        }else if(strncmp(token, i_b, sizeof(i_b)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            if(strcmp(token, "io_uring") == 0)
+                config->io_backend = IO_BACKEND_URING;
+            else if(strcmp(token, "epoll") == 0)
+                config->io_backend = IO_BACKEND_EPOLL;
+            else
+                return -1;
+
         }else if(strncmp(token, s_m, sizeof(s_m)) == 0){
             token = strtok_r(NULL, ":", &tmp);
             token[strcspn(token, "\n")] = '\0';
@@ -601,6 +852,20 @@ int parsing_str_for_config_server( char* str ){
             if(!config->log_file_name)
                 return -1;
             strncpy(config->log_file_name, token, n+1);
+        }else if(strncmp(token, c_s, sizeof(c_s)) == 0){
+            token = strtok_r(NULL, ":", &tmp);
+            token[strcspn(token, "\n")] = '\0';
+
+            int n = strlen(token);
+            // if the string is empty
+            if(n <= 1)
+                return -1;
+            if(!config->control_socket)
+                config->control_socket = (char *) malloc((n+1) * sizeof(char));
+            // if the allocation has failed
+            if(!config->control_socket)
+                return -1;
+            strncpy(config->control_socket, token, n+1);
         }
 
         token = strtok_r(NULL, ":", &tmp);
@@ -691,9 +956,8 @@ fprintf(stdout, "[%ld] - [Server] : Reading server configurations from finished
 /****************************** thread workers *******************************/
 
 void* workers( void* args ){
-    pthread_mutex_lock(&m_workers);
-    int id_worker = n_workers++;
-    pthread_mutex_unlock(&m_workers);
+    int id_worker = (int) (intptr_t) args;
+    unsigned long local = (unsigned long) (id_worker - 1);
     #ifdef PRINT_INFO
         fprintf(stdout, "[%ld] - [Thread:%d] : creation of worker n. %d\n", tempo_dgb++, id_worker, id_worker);
     #endif
@@ -702,43 +966,36 @@ void* workers( void* args ){
     int i=0;
     while(!close_server){
         toClose = 0;
-        if(finish_work && (lengthBuffer(buffer_request) == 0)) return NULL;
-        long *fd_client_r = (long *) popBuffer(buffer_request);
-        if(fd_client_r){
-            if(*fd_client_r < 0){
-                free(fd_client_r);
-                dec_num_threads();
-                return NULL;
-            }
-        }else{
-            continue;
-        }
-
-        if(close_server){
-            if(fd_client_r) free(fd_client_r);;
-            dec_num_threads();
-            return NULL;
-        }
-
-        // I read the type of request made by the client
-        if(readn(*fd_client_r, &operation, sizeof(int)) == -1){
-            toClose = 1;
-            goto fine_while;
-        }
+        // NULL when the server stops
+        conn_t* conn = (conn_t *) popDispatch(dispatch_request, local);
+        if(conn == NULL || close_server) break;
+        // the next request of the client goes preferably to this worker
+        conn->worker = (long) local;
+        // the files found while serving the request are not released
+        // until its end, even if another worker ejects them
+        hash_read_begin(files_server);
+
+        // the request has already been received entirely by the master:
+        // the worker takes the pathname and the data and only writes the reply
+        request_t* req = conn->cur;
+        operation = req->op;
 
         file_t* mf = NULL;
         file_t* mf_e[MAX_FILES_EJECTED];
         for(i=0; i<MAX_FILES_EJECTED; i++) mf_e[i] = NULL;
         int n_fe = 0;
         int resp = FAILED_O;
-        char* pathname = NULL;
-        size_t sz_p = 0;
-        void* data = NULL;
-        size_t sz_d = 0;
+        char* pathname = req->pathname;
+        size_t sz_p = req->sz_p;
+        // hash of the pathname: computed once for all the lookups of the request
+        uint64_t hash_p = pathname ? hash_function_for_file_t(pathname) : 0;
+        void* data = req->data;
+        size_t sz_d = req->sz_d;
+        req->pathname = NULL;
+        req->data = NULL;
         int reason_error = 0;
         char reason[STR_LEN];
         memset(reason, '\0', STR_LEN);
-        size_t sz = 0;
         switch(operation){
             case _CC_O:{
                 #ifdef PRINT_INFO
@@ -753,23 +1010,15 @@ void* workers( void* args ){
                 #endif
                 toClose = 1;
                 resp = SUCCESS_O;
-                writen(*fd_client_r, (void *) &resp, sizeof(int));
+                conn_writen(conn, (void *) &resp, sizeof(int));
                 break;
             }
             case _OF_O:{ // if it's an 'open file' request
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : Management of the request to open/create a file\n", tempo_dgb++, id_worker);
                 #endif
-                int flag = 0;
-                if((err = readn(*fd_client_r, (void *) &flag, sizeof(int))) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
+                int flag = req->arg;
 
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
                 #ifdef PRINT_LOG
                     tm = time(NULL);
                     memset(str_tm, '\0', 30);
@@ -790,43 +1039,19 @@ void* workers( void* args ){
 
                         // if the 'create' flag has been specified,
                         // the file must not already be present in the db
-                        if(hash_find(files_server, pathname) != NULL){
+                        if(hash_find_h(files_server, pathname, hash_p) != NULL){
                             reason_error = ERROR_OF_CREATE;
                             resp = FAILED_O;
                         }else{
-                            sz = sz_p;
-                            while(!hasSpace(sz)){
-                                char* pf = NULL;
-                                while((pf = pop_qp(list_files)) == NULL);
-                                #ifdef PRINT_LOG
-                                    tm = time(NULL);
-                                    memset(str_tm, '\0', 30);
-                                    assert(asctime_r(localtime(&tm), str_tm));
-                                    str_tm[strcspn(str_tm, "\n")] = '\0';
-                                    fprintf(fd_log, "[%s] : [WORKER] : CAPACITY MISS : insufficient space to insert the new file, I remove the file '%s' from the server.\n",
-                                                        str_tm, pf);
-                                #endif
-                                int index = 0;
-                                if(n_fe < MAX_FILES_EJECTED){
-                                    index = n_fe;
-                                    n_fe++;
-                                }else
-                                    index = MAX_FILES_EJECTED;
-                                if((mf_e[index] = hash_remove(files_server, pf)) != NULL){
-                                    incSpaceOccupied(1, mf_e[n_fe]->size_key + mf_e[n_fe]->size_data);
-                                }
-                                sz -= (mf_e[index]->size_key + mf_e[index]->size_data);
-                            }
-                            if((mf = hash_insert(files_server, pathname, sz_p, NULL, 0, *fd_client_r)) != NULL){
-                                if(flag == O_CREATE_LOCK) file_take_lock(mf, *fd_client_r);
+                            eject_files(sz_p, 1, mf_e, &n_fe);
+                            if((mf = hash_insert_h(files_server, pathname, hash_p, sz_p, NULL, 0, conn->fd)) != NULL){
+                                if(flag == O_CREATE_LOCK) file_take_lock(mf, conn->fd);
                                 resp = SUCCESS_O;
+                                incSpaceOccupied(1, sz_p);
                                 push_qp(list_files, pathname, sz_p);
                             }else{
                                 resp = FAILED_O;
                             }
-                            for(i=0; i<n_fe; i++){
-                                file_free(mf_e[i]);
-                            }
                         }
                         break;
                     }
@@ -841,10 +1066,10 @@ void* workers( void* args ){
 
                         // if the 'create' flag has not been specified,
                         // the file must already exist in the db
-                        if((mf = hash_find(files_server, pathname)) == NULL)
+                        if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL)
                             resp = FAILED_O;
                         else{
-                            if(file_take_lock(mf, *fd_client_r) == -1)
+                            if(file_take_lock(mf, conn->fd) == -1)
                                 resp = FAILED_O;
                             else{
                                 resp = SUCCESS_O;
@@ -858,7 +1083,7 @@ void* workers( void* args ){
                     default:{
                         // if the 'create' flag has not been specified,
                         // the file must already exist in the db
-                        if((mf = hash_find(files_server, pathname)) == NULL){
+                        if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                             reason_error = ERROR_OF_CREATE;
                             resp = FAILED_O;
                         }else{
@@ -885,11 +1110,11 @@ void* workers( void* args ){
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : Request to open / create the file failed, reason : %s\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((err = writen(*fd_client_r, (void *) &resp, sizeof(int))) == -1){
+                    if((err = conn_writen(conn, (void *) &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
@@ -897,23 +1122,20 @@ void* workers( void* args ){
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : Request to open / create the file successful!\n", tempo_dgb++, id_worker);
                     #endif
-                    if((err = writen(*fd_client_r, (void *) &resp, sizeof(int))) == -1){
+                    if((err = conn_writen(conn, (void *) &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
                 }
                 break;
             }
-            case _RF_O:{ // if it's an 'read file' request
+            case _RF_O: // if it's an 'read file' request
+            case _RFM_O:{ // (or a mapped one: the contents go in a memfd if possible)
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : management of the reading request!\n", tempo_dgb++, id_worker);
                 #endif
 
                 // I read the pathname of the file
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -923,7 +1145,7 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : READ FILE : request to read the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     reason_error = ERROR_RF_EXIST;
                     resp = FAILED_O;
                     strncpy(reason, R_RF_EXIST, STR_LEN-1);
@@ -931,35 +1153,46 @@ void* workers( void* args ){
                         fprintf(stdout, "[%ld] - [Worker:%d] : reading of the file failed, reason : %s\n", tempo_dgb++, id_worker, reason);
                     #endif
 
-                    if((err = writen(*fd_client_r, (void *) &resp, sizeof(int))) == -1){
+                    if((err = conn_writen(conn, (void *) &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
 
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }else{
-                    void* buf_data = NULL;
-                    size_t sz_bd = 0;
-                    file_read_content(mf, &buf_data, &sz_bd);
+                    // the contents are pinned, not copied: a write that
+                    // arrives meanwhile publishes a new buffer
+                    fbuf_t* content = NULL;
+                    file_pin_content(mf, &content);
                     resp = SUCCESS_O;
                     #ifdef _LRU_POLICY_
                         repositionNodeP(list_files, mf->key, mf->size_key);
                     #endif
 
-                    if((err = writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((err = conn_writen(conn, &resp, sizeof(int))) == -1){
+                        fbuf_release(content);
                         toClose = 1;
                         goto fine_while;
                     }
 
-                    if((err = write_data(*fd_client_r, buf_data, sz_bd)) == -1){
-                        if(buf_data) free(buf_data);
+                    // the reference is left once the contents have been sent
+                    if(operation == _RFM_O){
+                        err = conn_write_data_fd(conn, content ? content->data : NULL, content ? content->size : 0,
+                                                    fbuf_memfd(content), fbuf_release, content);
+                    }else if(conn->shm){
+                        err = conn_write_data_shm(conn, content ? content->data : NULL, content ? content->size : 0,
+                                                    fbuf_release, content);
+                    }else{
+                        err = conn_write_data_ref(conn, content ? content->data : NULL, content ? content->size : 0,
+                                                    fbuf_release, content);
+                    }
+                    if(err == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(buf_data) free(buf_data);
 
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : successful reading of the file!\n", tempo_dgb++, id_worker);
@@ -968,15 +1201,12 @@ void* workers( void* args ){
                 }
                 break;
             }
-            case _RNF_O:{ // if it's an 'read n file' request
+            case _RNF_O: // if it's an 'read n file' request
+            case _RNFM_O:{ // (or a mapped one: the contents go in memfds if possible)
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : reading 'N' files to server\n", tempo_dgb++, id_worker);
                 #endif
-                int N = 0;
-                if(readn(*fd_client_r, &N, sizeof(int)) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
+                int N = req->arg;
                 #ifdef PRINT_LOG
                     tm = time(NULL);
                     memset(str_tm, '\0', 30);
@@ -992,7 +1222,7 @@ void* workers( void* args ){
                     le = hash_size(files_server);
                 }
 
-                if((writen(*fd_client_r, (void *) &le, sizeof(int))) == -1){
+                if((conn_writen(conn, (void *) &le, sizeof(int))) == -1){
                     toClose = 1;
                     goto fine_while;
                 }
@@ -1001,28 +1231,30 @@ void* workers( void* args ){
                     char* str_finish = NULL;
                     int n = 0;
                     int finish = 0;
-                    Node_p* np = list_files->head;
                     int l = 0, c = 1;
                     while( (n < le) && ((fr = get_copy_file_hash(files_server, &l, &c)) != NULL) ){
-                        if((writen(*fd_client_r, (void *) &finish, sizeof(int))) == -1){
+                        if((conn_writen(conn, (void *) &finish, sizeof(int))) == -1
+                            || (conn_write_pathname(conn, fr->key, fr->size_key)) == -1){
                             file_free(fr);
+                            toClose = 1;
                             goto fine_while;
                         }
-                        if((write_pathname(*fd_client_r, fr->key, fr->size_key)) == -1){
-
-                        }
-                        if((write_data(*fd_client_r, fr->data, fr->size_data)) == -1){
-
+                        // on failure the contents (and 'fr') are already released
+                        int err_w = (operation == _RNFM_O)
+                            ? conn_write_data_fd(conn, fr->data, fr->size_data, fbuf_memfd(fr->buf), release_file, fr)
+                            : conn_write_data_ref(conn, fr->data, fr->size_data, release_file, fr);
+                        if(err_w == -1){
+                            toClose = 1;
+                            goto fine_while;
                         }
-                        if(fr) file_free(fr);
                         n++;
                     }
                     if(str_finish) free(str_finish);
                     if(n != le){
                         finish = 1;
-                        if((writen(*fd_client_r, (void *) &finish, sizeof(int))) == -1){
-                                np = np->next;
-                                continue;
+                        if((conn_writen(conn, (void *) &finish, sizeof(int))) == -1){
+                                toClose = 1;
+                                goto fine_while;
                             }
                     }
                 }else{
@@ -1033,7 +1265,7 @@ void* workers( void* args ){
                         fprintf(stdout, "[%ld] - [Worker:%d] : reading of the N file failed, reason : %s\n", tempo_dgb++, id_worker, reason);
                     #endif
 
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
@@ -1046,14 +1278,6 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : handling of the request to write a file to the server!\n", tempo_dgb++, id_worker);
                 #endif
-                if((read_pathname(*fd_client_r, &pathname, &sz_p)) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
-                if((read_data(*fd_client_r, (void **) &data, &sz_d)) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1063,72 +1287,50 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : WRITE FILE : request to write the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     resp = FAILED_O;
                     strncpy(reason, R_WF_EXIST, STR_LEN-1);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failed to write file to server, reason: %s\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }
 
-                    if(!file_has_lock(mf, *fd_client_r)){
+                    if(!file_has_lock(mf, conn->fd)){
                         resp = FAILED_O;
                         strncpy(reason, R_WF_OPEN, STR_LEN-1);
                         #ifdef PRINT_INFO
                             fprintf(stdout, "[%ld] - [Worker:%d] : failed to write file to server, reason: %s\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if((write_reason(*fd_client_r, reason)) == -1){
+                        if((conn_write_reason(conn, reason)) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
 
-                    size_t sz_aux = sz_d;
-                    while(!hasSpace(sz_aux)){
-                        char* pf = NULL;
-                        while((pf = pop_qp(list_files)) == NULL);
-                        #ifdef PRINT_LOG
-                            tm = time(NULL);
-                            memset(str_tm, '\0', 30);
-                            assert(asctime_r(localtime(&tm), str_tm));
-                            str_tm[strcspn(str_tm, "\n")] = '\0';
-                            fprintf(fd_log, "[%s] : [WORKER] : CAPACITY MISS : insufficient space to insert the new file, I remove the file '%s' from the server.\n",
-                                    str_tm, pf);
-                        #endif
-                        int index = 0;
-                        if(n_fe < MAX_FILES_EJECTED){
-                            index = n_fe;
-                            n_fe++;
-                        } else{
-                            index = MAX_FILES_EJECTED-1;
-                        }
-                        if((mf_e[index] = hash_remove(files_server, pf)) != NULL){
-                            IS.currently_space_occupied -= (mf_e[n_fe]->size_key + mf_e[n_fe]->size_data);
-                        }
-                        sz_aux -= mf_e[index]->size_data;
-                    }
-                    if((mf = hash_update_insert_append(files_server, pathname, sz_p, data, sz_d, *fd_client_r)) == NULL){
+                    eject_files(sz_d, 0, mf_e, &n_fe);
+                    if((mf = hash_update_insert_append_h(files_server, pathname, hash_p, sz_p, data, sz_d, conn->fd)) == NULL){
                         toClose = 1;
                         goto fine_while;
                     }
+                    incSpaceOccupied(0, sz_d);
                     resp = SUCCESS_O;
                     repositionNodeP(list_files, mf->key, mf->size_key);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : successful writing of the file to the server!\n", tempo_dgb++, id_worker);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
@@ -1143,15 +1345,18 @@ void* workers( void* args ){
                             array_szp[i]    = mf_e[i]->size_key;
                             array_szd[i]    = mf_e[i]->size_data;
                         }
-                        if(write_file_eject(*fd_client_r, n_fe, array_p, array_szp, (void **) array_d, array_szd) == -1){
+                        // the ejected files are released once sent
+                        if(conn_write_file_eject(conn, n_fe, array_p, array_szp, (void **) array_d, array_szd, release_file, (void **) mf_e) == -1){
                             toClose = 1;
                         }
-                        for(i=0; i<n_fe; i++){
-                            file_free(mf_e[i]);
-                        }
+                        n_fe = 0;
+                        free(array_p);
+                        free(array_d);
+                        free(array_szp);
+                        free(array_szd);
                         goto fine_while;
                     }else{
-                        if(writen(*fd_client_r, &n_fe, sizeof(int)) == -1){
+                        if(conn_writen(conn, &n_fe, sizeof(int)) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
@@ -1162,17 +1367,7 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                 fprintf(stdout, "[%ld] - [Worker:%d] : handling of the append request to the file!\n", tempo_dgb++, id_worker);
                 #endif
-                char* data = NULL;
-                size_t sz_d = 0;
-                if((read_pathname(*fd_client_r, &pathname, &sz_p)) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
-                if((read_data(*fd_client_r, (void **) &data, &sz_d)) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1182,63 +1377,41 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : APPEND TO FILE : request to append data to the file '%s'\n", str_tm, pathname);
                 #endif
 
-                    size_t sz_aux = sz_d;
-                    while(!hasSpace(sz_aux)){
-                        char* pf = NULL;
-                        while((pf = pop_qp(list_files)) == NULL);
-                        #ifdef PRINT_LOG
-                        tm = time(NULL);
-                        memset(str_tm, '\0', 30);
-                        assert(asctime_r(localtime(&tm), str_tm));
-                        str_tm[strcspn(str_tm, "\n")] = '\0';
-                        fprintf(fd_log, "[%s] : [WORKER] : CAPACITY MISS : insufficient space to insert the new file, I remove the file '%s' from the server.\n",
-                                str_tm, pf);
-                        #endif
-                        if(n_fe < MAX_FILES_EJECTED){
-                            if((mf_e[n_fe] = hash_remove(files_server, pf)) != NULL){
-                                incSpaceOccupied(0, mf_e[n_fe]->size_key + mf_e[n_fe]->size_data);
-                            }
-                        }
-                        else if((mf_e[MAX_FILES_EJECTED-1] = hash_remove(files_server, pf)) != NULL){
-                                incSpaceOccupied(0, mf_e[MAX_FILES_EJECTED-1]->size_key + mf_e[MAX_FILES_EJECTED-1]->size_data);
-                        }
-                        sz_aux -= mf_e[n_fe]->size_data;
-                        n_fe++;
-                    }
+                    eject_files(sz_d, 0, mf_e, &n_fe);
 
-                    if((mf = hash_find(files_server, pathname)) == NULL){
+                    if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                         resp = FAILED_O;
                         strncpy(reason, R_WF_EXIST, STR_LEN-1);
                         #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failure to concatenate files, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if((write_reason(*fd_client_r, reason)) == -1){
+                        if((conn_write_reason(conn, reason)) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
 
-                    if(!file_has_lock(mf, *fd_client_r)){
+                    if(!file_has_lock(mf, conn->fd)){
                         resp = FAILED_O;
                         strncpy(reason, R_WF_OPEN, STR_LEN-1);
                         #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failure to concatenate files, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if(write_reason(*fd_client_r, reason) == -1){
+                        if(conn_write_reason(conn, reason) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
 
-                    if((mf = hash_update_insert_append(files_server, pathname, sz_p, data, sz_d, *fd_client_r)) == NULL){
+                    if((mf = hash_update_insert_append_h(files_server, pathname, hash_p, sz_p, data, sz_d, conn->fd)) == NULL){
                         toClose = 1;
                         goto fine_while;
                     }
@@ -1248,6 +1421,11 @@ void* workers( void* args ){
                     #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : successful file chaining operation!\n", tempo_dgb++, id_worker);
                     #endif
+                    // the result goes first, even when no file was ejected
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
+                        toClose = 1;
+                        goto fine_while;
+                    }
                     if(n_fe > 0){
                         char** array_p = (char **) malloc(n_fe * sizeof(char*));
                         char** array_d = (char **) malloc(n_fe * sizeof(char*));
@@ -1259,19 +1437,18 @@ void* workers( void* args ){
                             array_szp[i]    = mf_e[i]->size_key;
                             array_szd[i]    = mf_e[i]->size_data;
                         }
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
-                            toClose = 1;
-                            goto fine_while;
-                        }
-                        if(write_file_eject(*fd_client_r, n_fe, array_p, array_szp, (void **) array_d, array_szd) == -1){
+                        // the ejected files are released once sent
+                        if(conn_write_file_eject(conn, n_fe, array_p, array_szp, (void **) array_d, array_szd, release_file, (void **) mf_e) == -1){
                             toClose = 1;
                         }
-                        for(i=0; i<n_fe; i++){
-                            file_free(mf_e[i]);
-                        }
+                        n_fe = 0;
+                        free(array_p);
+                        free(array_d);
+                        free(array_szp);
+                        free(array_szd);
                         goto fine_while;
                     }else{
-                        if(writen(*fd_client_r, &n_fe, sizeof(int)) == -1){
+                        if(conn_writen(conn, &n_fe, sizeof(int)) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
@@ -1282,10 +1459,6 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : management of the file lock request!\n", tempo_dgb++, id_worker);
                 #endif
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1295,25 +1468,25 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : LOCK FILE : request to lock the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     resp = FAILED_O;
                     strncpy(reason, R_LF_EXIST, STR_LEN-1);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failed to lock file, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }else{
-                    if(!file_has_lock(mf, *fd_client_r))
-                        file_take_lock(mf, *fd_client_r);
+                    if(!file_has_lock(mf, conn->fd))
+                        file_take_lock(mf, conn->fd);
                     resp = SUCCESS_O;
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                     }
                     #ifdef _LRU_POLICY_
@@ -1330,10 +1503,6 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : management of the file unlock request!\n", tempo_dgb++, id_worker);
                 #endif
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1343,39 +1512,39 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : UNLOCK FILE : request to unlock the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     resp = FAILED_O;
                     strncpy(reason, R_UF_EXIST, STR_LEN-1);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failed to unlock file:, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }else{
-                    if(!file_has_lock(mf, *fd_client_r)){
+                    if(!file_has_lock(mf, conn->fd)){
                         resp = FAILED_O;
                         strncpy(reason, R_UF_LOCK, STR_LEN-1);
                         #ifdef PRINT_INFO
                             fprintf(stdout, "[%ld] - [Worker:%d] : failed to unlock file:, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if(write_reason(*fd_client_r, reason) == -1){
+                        if(conn_write_reason(conn, reason) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
-                    file_leave_lock(mf, *fd_client_r);
+                    file_leave_lock(mf, conn->fd);
                     resp = SUCCESS_O;
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                     }
                     #ifdef _LRU_POLICY_
@@ -1392,10 +1561,6 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                     fprintf(stdout, "[%ld] - [Worker:%d] : management of request to close files\n", tempo_dgb++, id_worker);
                 #endif
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1405,26 +1570,26 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : CLOSE FILE : request to close the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     resp = FAILED_O;
                     strncpy(reason, R_LF_EXIST, STR_LEN-1);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : failed to close file:, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }else{
-                    file_remove_fd(mf, *fd_client_r);
-                    if(file_has_lock(mf, *fd_client_r))
-                        file_leave_lock(mf, *fd_client_r);
+                    file_remove_fd(mf, conn->fd);
+                    if(file_has_lock(mf, conn->fd))
+                        file_leave_lock(mf, conn->fd);
                     resp = SUCCESS_O;
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                     }
                     #ifdef _LRU_POLICY_
@@ -1441,10 +1606,6 @@ void* workers( void* args ){
                 #ifdef PRINT_INFO
                 fprintf(stdout, "[%ld] - [Worker:%d] : handling of file removal requests\n", tempo_dgb++, id_worker);
                 #endif
-                if(read_pathname(*fd_client_r, &pathname, &sz_p) == -1){
-                    toClose = 1;
-                    goto fine_while;
-                }
 
                 #ifdef PRINT_LOG
                     tm = time(NULL);
@@ -1454,55 +1615,56 @@ void* workers( void* args ){
                     fprintf(fd_log, "[%s] : REQUEST : REMOVE FILE : request to remove the file '%s'\n", str_tm, pathname);
                 #endif
 
-                if((mf = hash_find(files_server, pathname)) == NULL){
+                if((mf = hash_find_h(files_server, pathname, hash_p)) == NULL){
                     resp = FAILED_O;
                     strncpy(reason, R_RFI_EXIST, STR_LEN-1);
                     #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : file removal failed, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                     #endif
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                         goto fine_while;
                     }
-                    if(write_reason(*fd_client_r, reason) == -1){
+                    if(conn_write_reason(conn, reason) == -1){
                         toClose = 1;
                     }
                     goto fine_while;
                 }else{
-                    if(!file_has_lock(mf, *fd_client_r)){
+                    if(!file_has_lock(mf, conn->fd)){
                         resp = FAILED_O;
                         strncpy(reason, R_RFI_LOCK, STR_LEN-1);
                         #ifdef PRINT_INFO
                         fprintf(stdout, "[%ld] - [Worker:%d] : file removal failed, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if(write_reason(*fd_client_r, reason) == -1){
+                        if(conn_write_reason(conn, reason) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
 
-                    if((mf = hash_remove(files_server, pathname)) == NULL){
+                    if((mf = hash_remove_h(files_server, pathname, hash_p)) == NULL){
                         resp = FAILED_O;
                         strncpy(reason, R_LF_EXIST, STR_LEN-1);
                         #ifdef PRINT_INFO
                             fprintf(stdout, "[%ld] - [Worker:%d] : file removal failed, reason: '%s'\n", tempo_dgb++, id_worker, reason);
                         #endif
-                        if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                        if((conn_writen(conn, &resp, sizeof(int))) == -1){
                             toClose = 1;
                             goto fine_while;
                         }
-                        if(write_reason(*fd_client_r, reason) == -1){
+                        if(conn_write_reason(conn, reason) == -1){
                             toClose = 1;
                         }
                         goto fine_while;
                     }
 
+                    incSpaceOccupied(-1, -(long) (mf->size_key + mf->size_data));
                     resp = SUCCESS_O;
-                    if((writen(*fd_client_r, &resp, sizeof(int))) == -1){
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
                         toClose = 1;
                     }
                     #ifdef PRINT_INFO
@@ -1511,10 +1673,54 @@ void* workers( void* args ){
                     #ifdef _LRU_POLICY_
                         repositionNodeP(list_files, mf->key);
                     #endif
+                    hash_release_item(files_server, mf);
                     goto fine_while;
                 }
                 break;
             }
+            case _SHM_O:{// if it's a request for the shared-memory rings
+                #ifdef PRINT_LOG
+                    tm = time(NULL);
+                    memset(str_tm, '\0', 30);
+                    assert(asctime_r(localtime(&tm), str_tm));
+                    str_tm[strcspn(str_tm, "\n")] = '\0';
+                    fprintf(fd_log, "[%s] : REQUEST : SHARED MEMORY : request of the rings of the client\n", str_tm);
+                #endif
+
+                ShmRing_t* shm = NULL;
+                if(settings_server.shm_ring_size == 0 || conn->shm != NULL ||
+                        (shm = initShmRing(settings_server.shm_ring_size)) == NULL){
+                    resp = FAILED_O;
+                    strncpy(reason, R_SHM, STR_LEN-1);
+                    #ifdef PRINT_INFO
+                        fprintf(stdout, "[%ld] - [Worker:%d] : shared-memory rings not offered to the client\n", tempo_dgb++, id_worker);
+                    #endif
+                    if((conn_writen(conn, &resp, sizeof(int))) == -1){
+                        toClose = 1;
+                        goto fine_while;
+                    }
+                    if(conn_write_reason(conn, reason) == -1){
+                        toClose = 1;
+                    }
+                    goto fine_while;
+                }
+
+                // the master reads the rings while parsing the next requests
+                __atomic_store_n(&conn->shm, shm, __ATOMIC_RELEASE);
+                resp = SUCCESS_O;
+                if((conn_writen(conn, &resp, sizeof(int))) == -1){
+                    toClose = 1;
+                    goto fine_while;
+                }
+                // the client maps the rings from the memfd
+                if(conn_write_data_fd(conn, NULL, settings_server.shm_ring_size, getFdShmRing(shm), NULL, NULL) == -1){
+                    toClose = 1;
+                }
+                #ifdef PRINT_INFO
+                fprintf(stdout, "[%ld] - [Worker:%d] : shared-memory rings of the client created\n", tempo_dgb++, id_worker);
+                #endif
+                goto fine_while;
+            }
             default:{
                 #ifdef PRINT_INFO
                 fprintf(stdout, "[%ld] - [Worker:%d] : ERROR: request not recognized --> disconnection with the client!\n", tempo_dgb++, id_worker);
@@ -1525,6 +1731,11 @@ void* workers( void* args ){
         }
 
         fine_while:
+            // the files ejected and not handed to the connection
+            // (the request failed before sending them) are released here
+            for(i=0; i<n_fe; i++){
+                hash_release_item(files_server, mf_e[i]);
+            }
             if(pathname){
                 free(pathname);
                 pathname = NULL;
@@ -1533,202 +1744,1205 @@ void* workers( void* args ){
                 free(data);
                 data = NULL;
             }
-            if(finish_work){
-                if(fd_client_r) free(fd_client_r);
-                continue;
-            }
-            SYSCALL_EXIT_EQ("write", err, write(canale[1], fd_client_r, sizeof(long)), -1, "");
-            SYSCALL_EXIT_EQ("write", err, write(canale[1], &toClose, sizeof(int)), -1, "");
-            if(fd_client_r) free(fd_client_r);
+            hash_read_end(files_server);
+            // the reply is in the send buffer of the connection:
+            // the master sends it and waits for the next request
+            conn->done.toClose = toClose;
+            SYSCALL_EXIT_EQ("pushCompletion", err, pushCompletion(conn->completion, &conn->done), -1, "");
     }
 
+    dec_num_threads();
     return NULL;
 }
 
 /******************************* thread master *******************************/
 
 /**
-* master: function of the server that starts the server
+* registers 'fd' in the epoll instance of the master
+*
+* @param fd_epoll : epoll instance
+* @param fd : file descriptor to watch
+* @param ptr : value returned with the events of 'fd' (listener, completion queue or connection)
+* @param events : events to watch (EPOLLIN, EPOLLONESHOT, ...)
+*
+* @returns : 0 on success, -1 on failure and errno is set
 */
-void master( void ){
-    cleanup_socket();
-    int i, err;
-
-    #ifdef PRINT_INFO
-    fprintf(stdout, "[%ld] - [Master] : Creating a file descriptor container.\n", tempo_dgb++);
-    #endif
-    fd_set set, tmpset;
-    FD_ZERO(&set);
-    FD_ZERO(&tmpset);
-
-    #ifdef PRINT_INFO
-    fprintf(stdout, "[%ld] - [Master] : Creation and configuration of the server communication channel with clients in progress...\n", tempo_dgb++);
-    #endif
-    struct sockaddr_un server_addr;
-    memset(&server_addr, '0', sizeof(server_addr));
-    server_addr.sun_family = AF_UNIX;
-    strncpy(server_addr.sun_path, settings_server.socket_name, strlen(settings_server.socket_name)+1);
+static int epoll_add_fd( int fd_epoll, int fd, void* ptr, unsigned int events ){
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = ptr;
+    return epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev);
+}
 
-    int fd_socket = -1;
-    SYSCALL_EXIT_EQ("socket", fd_socket, socket(AF_UNIX, SOCK_STREAM, 0), -1, "");
+/**
+* re-arms a client registered with EPOLLONESHOT:
+* after the event has been delivered the client stays disabled
+* until the master has finished with it
+*
+* @param fd_epoll : epoll instance
+* @param c : connection of the client
+* @param events : EPOLLIN to wait for the next request, EPOLLOUT to finish sending a reply
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+static int epoll_rearm_conn( int fd_epoll, conn_t* c, unsigned int events ){
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events | EPOLLONESHOT;
+    ev.data.ptr = (void *) c;
+    return epoll_ctl(fd_epoll, EPOLL_CTL_MOD, (int) c->fd, &ev);
+}
 
-    SYSCALL_EXIT_EQ("bind", err, bind(fd_socket, (struct sockaddr *) &server_addr, sizeof(server_addr)), -1, "");
+/**
+* reactor: event loop of the master that owns a part of the connections
+*
+* every reactor waits on its own epoll instance for the shared listening socket
+* (registered with EPOLLEXCLUSIVE, so a new connection wakes up only one of them),
+* for its clients and for its completion queue, where the workers give back
+* the connections after serving a request
+*
+* with the io_uring backend (ring) the reactor does not wait for readiness:
+* it submits the receives, the sends and the accept, and a single
+* io_uring_enter publishes the whole batch and waits for the results
+*
+* the requests received wait in the scheduler of the reactor (drr), which
+* decides the order in which they pass to the workers
+*
+* the deadlines of the connections are in the timer wheel of the reactor
+* (wheel), the timerfd (fd_timer) is armed for the next tick to process,
+* or earlier to accept again after a lack of descriptors (retry_at)
+*
+* at the normal shutdown the reactor drains (draining): it no longer accepts
+* nor receives, serves the requests already received and stops when all its
+* clients have their replies, or at the latest at drain_at
+*/
+typedef struct _reactor_t{
+    int             id;
+    int             fd_epoll;
+    Uring_t*        ring;
+    int             accepting;
+    uint64_t        n_done;
+    Completion_t*   completion;
+    Drr_t*          drr;
+    Wheel_t*        wheel;
+    int             fd_timer;
+    uint64_t        timer_at;
+    uint64_t        retry_at;
+    int             draining;
+    uint64_t        drain_at;
+    conn_t*         list_conn;
+    conn_t*         list_dead;
+    pthread_t       tid;
+} reactor_t;
+
+// reactors of the server (the first one is run by the main thread)
+static reactor_t* reactors = NULL;
+
+// listening socket shared by all the reactors
+static int fd_socket = -1;
+
+// written at shutdown to wake up all the reactors
+static int fd_stop = -1;
+
+// signals of the server, handled only by the main thread
+static sigset_t sig_server;
+
+// attributes of the threads workers
+static pthread_attr_t thread_attr;
+
+// threads workers, created at startup and joined at shutdown
+static pthread_t* pool = NULL;
+static unsigned long n_pool = 0;
+
+// places of the clients connected at the same time
+static Admission_t* admission = NULL;
+
+// hot restart: control socket, its thread and the connection of the new server
+static int fd_control = -1;
+static int fd_restart = -1;
+static pthread_t control_tid;
+
+static void accept_next_uring( reactor_t* r );
+static int serve_conn_uring( reactor_t* r, conn_t* c );
+static void start_conn( reactor_t* r, long connfd );
 
-    SYSCALL_EXIT_EQ("listen", err, listen(fd_socket, settings_server.concurrent_clients), -1, "");
+/**
+* @returns : the time in milliseconds (monotonic clock)
+*/
+static uint64_t now_ms( void ){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
 
-    FD_SET(fd_socket, &set);
+static void link_conn( reactor_t* r, conn_t* c ){
+    c->prev = NULL;
+    c->next = r->list_conn;
+    if(r->list_conn) r->list_conn->prev = c;
+    r->list_conn = c;
+}
 
-    #ifdef PRINT_INFO
-    fprintf(stdout, "[%ld] - [Master] : finished creation and configuration of the server communication channel with clients.\n",tempo_dgb++);
+/**
+* closes the connection with a client
+* (closing the descriptor also removes it from the epoll instance)
+*
+* the memory is released later by free_dead_conns: some events of the
+* connection may still be in the array returned by epoll_wait
+*/
+static void close_conn( reactor_t* r, conn_t* c ){
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Reactor:%d] : Closing connection with client '%ld'!\n", tempo_dgb++, r->id, c->fd);
+    #endif
+    #ifdef PRINT_LOG
+        tm = time(NULL);
+        memset(str_tm, '\0', 30);
+        assert(asctime_r(localtime(&tm), str_tm));
+        str_tm[strcspn(str_tm, "\n")] = '\0';
+        fprintf(fd_log, "[%s] : CLIENT : Closing connection with a client!\n", str_tm);
+    #endif
+    if(c->prev) c->prev->next = c->next;
+    else r->list_conn = c->next;
+    if(c->next) c->next->prev = c->prev;
+    removeDrr(r->drr, &c->sched);
+    removeWheel(r->wheel, &c->timer);
+    close((int) c->fd);
+    c->fd = -1;
+    c->prev = NULL;
+    c->next = r->list_dead;
+    r->list_dead = c;
+    dec_num_client();
+    int running = !close_server && !finish_work;
+    // the place goes to the oldest client waiting in the queue, if any
+    long connfd = leaveAdmission(admission, running);
+    if(connfd != -1){
+        inc_num_client();
+        start_conn(r, connfd);
+    }
+    if(r->ring && running) accept_next_uring(r);
+}
 
-    fprintf(stdout, "[%ld] - [Master] : configuration of the methods of creation and functioning of threads in progress...\n", tempo_dgb++);
+static void free_dead_conns( reactor_t* r ){
+    while(r->list_dead != NULL){
+        conn_t* c = r->list_dead;
+        r->list_dead = c->next;
+        conn_free(c);
+    }
+}
+
+/**
+* the worker has finished serving the current request of the client:
+* its reply will be sent after those of the previous requests
+*/
+static void end_request( reactor_t* r, conn_t* c, int toClose ){
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Reactor:%d] : A thread has finished handling a request of the client '%ld'!\n", tempo_dgb++, r->id, c->fd);
     #endif
+    conn_end_request(c);
+    c->busy = 0;
+    doneDrr(r->drr);
+    if(c->queue_head == NULL) idleDrr(&c->sched);
+    // after a request to close the connection, the following ones are ignored
+    if(toClose) c->closing = 1;
+}
 
-    SYSCALL_EXIT_EQ("pipe", err, pipe(canale), -1, "");
-    FD_SET(canale[0], &set);
+/**
+* the oldest request of the client waits for its turn in the scheduler, if no
+* other worker is serving the connection and the previous reply has already been queued
+*
+* the cost of the request is the number of bytes received with it
+*/
+static void dispatch_conn( reactor_t* r, conn_t* c ){
+    if(c->busy || c->sched.active || c->closing || c->broken || conn_has_reply(c) || c->queue_head == NULL) return;
+    request_t* req = c->queue_head;
+    pushDrr(r->drr, &c->sched, DRR_REQUEST_COST + req->sz_p + req->sz_d);
+}
 
-    pthread_attr_t thread_attr;
-    pthread_t thread_id;
+/**
+* @returns : 1 if the connection can be closed: the client has gone away,
+*            or it asked to close (or the reactor drains and it has no
+*            request left) and all the replies have been sent
+*/
+static int is_over_conn( reactor_t* r, conn_t* c ){
+    if(c->broken) return 1;
+    int ended = c->closing || (r->draining && !c->busy && !c->sched.active && c->queue_head == NULL);
+    return ended && !conn_has_reply(c) && !conn_has_output(c);
+}
 
-    SYSCALL_EXIT_NEQ("pthread_attr_init", err, pthread_attr_init(&thread_attr), 0, "");
-    SYSCALL_EXIT_NEQ("pthread_attr_setdetachstate", err, pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED), 0, "");
+/**
+* @returns : the kind of wait of the connection (TIMEOUT_*): none while
+*            the server has a request or a reply of the client in hand
+*/
+static int kind_timeout( conn_t* c ){
+    if(c->broken || c->closing || c->busy || c->sched.active || c->queue_head != NULL
+        || conn_has_reply(c) || conn_has_output(c)) return TIMEOUT_NONE;
+    if(c->stage == CONN_STAGE_DATA) return TIMEOUT_BODY;
+    if(c->stage == CONN_STAGE_OP && c->got == 0 && !conn_has_input(c)) return TIMEOUT_IDLE;
+    return TIMEOUT_HEADER;
+}
 
+/**
+* sets the deadline of the connection for the kind of wait it is in:
+* the header of a request must arrive within its time from the first
+* byte, while the data can arrive slowly as long as they keep arriving
+*/
+static void arm_timeout( reactor_t* r, conn_t* c ){
+    int kind = kind_timeout(c);
+    unsigned long sec = 0;
+    if(kind == TIMEOUT_IDLE) sec = settings_server.idle_timeout;
+    else if(kind == TIMEOUT_HEADER) sec = settings_server.header_timeout;
+    else if(kind == TIMEOUT_BODY) sec = settings_server.body_timeout;
+    if(sec == 0){
+        removeWheel(r->wheel, &c->timer);
+        c->t_kind = kind;
+        return;
+    }
+    if(kind == c->t_kind && c->timer.slot != NULL && (kind != TIMEOUT_BODY || c->got == c->t_got)) return;
+    c->t_kind = kind;
+    c->t_got = c->got;
+    addWheel(r->wheel, &c->timer, now_ms() + sec * 1000);
+}
 
-    #ifdef PRINT_INFO
-    fprintf(stdout, "[%ld] - [Master] : configuration of the methods of creation and functioning of the finished threads.\n", tempo_dgb++);
+/**
+* advances the connection with a client without blocking:
+* sends the replies already served, receives the requests that the client
+* has already sent (even while a worker serves the previous one) and
+* passes the oldest one to the workers
+*
+* @returns : 0 if the connection stays open, -1 if it must be closed
+*/
+static int serve_conn( reactor_t* r, conn_t* c ){
+    int err = 0;
+    unsigned int events = 0;
+
+    if(!c->busy) conn_flush_reply(c);
+    if(!c->broken && conn_has_output(c) && conn_send(c) == -1) c->broken = 1;
+
+    if(!c->broken && !c->closing){
+        // while draining only the requests already received are taken
+        while(c->queue_len < CONN_PIPELINE_DEPTH && (err = r->draining ? conn_parse_input(c) : conn_recv(c)) == 1){
+            if(conn_push_request(c) == -1){
+                err = -1;
+                break;
+            }
+        }
+        if(err == -1) c->broken = 1;
+    }
+    dispatch_conn(r, c);
+    arm_timeout(r, c);
+
+    if(is_over_conn(r, c)){
+        // a worker still uses the connection: it is closed when it is given back
+        return c->busy ? 0 : -1;
+    }
+
+    if(conn_has_output(c)) events |= EPOLLOUT;
+    if(!c->closing && !r->draining && c->queue_len < CONN_PIPELINE_DEPTH) events |= EPOLLIN;
+    // nothing to do until the worker gives back the connection
+    if(events == 0) return 0;
+    return epoll_rearm_conn(r->fd_epoll, c, events);
+}
+
+/**
+* passes to the workers the requests chosen by the scheduler,
+* until the workers have max_flight requests of the reactor
+*/
+static void schedule_conns( reactor_t* r ){
+    NodeD_t* node = NULL;
+    while((node = popDrr(r->drr)) != NULL){
+        conn_t* c = conn_from_drr(node);
+        #ifdef PRINT_INFO
+        fprintf(stdout, "[%ld] - [Reactor:%d] : A new request from the client of channel '%ld' has arrived!\n", tempo_dgb++, r->id, c->fd);
+        #endif
+        #ifdef PRINT_LOG
+            tm = time(NULL);
+            memset(str_tm, '\0', 30);
+            assert(asctime_r(localtime(&tm), str_tm));
+            str_tm[strcspn(str_tm, "\n")] = '\0';
+            fprintf(fd_log, "[%s] : CLIENT : A new request arrived\n", str_tm);
+        #endif
+        conn_next_request(c);
+        c->busy = 1;
+        if(pushDispatch(dispatch_request, (void *) c, c->worker) == 0) continue;
+        // the request cannot be served: the connection is closed
+        c->busy = 0;
+        c->broken = 1;
+        doneDrr(r->drr);
+        if(r->ring){
+            if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+        }else if(serve_conn(r, c) == -1){
+            close_conn(r, c);
+        }
+    }
+}
+
+/**
+* closes the connections whose deadline has passed
+*/
+static void expire_conns( reactor_t* r ){
+    NodeW_t* node = advanceWheel(r->wheel, now_ms());
+    while(node != NULL){
+        NodeW_t* next = node->next;
+        conn_t* c = conn_from_wheel(node);
+        const char* reason = (c->t_kind == TIMEOUT_IDLE) ? "idle"
+                            : (c->t_kind == TIMEOUT_HEADER) ? "header of a request not received"
+                            : "data of a request not received";
+        #ifdef PRINT_INFO
+        fprintf(stdout, "[%ld] - [Reactor:%d] : Timeout of the client '%ld' (%s)!\n", tempo_dgb++, r->id, c->fd, reason);
+        #endif
+        #ifdef PRINT_LOG
+            tm = time(NULL);
+            memset(str_tm, '\0', 30);
+            assert(asctime_r(localtime(&tm), str_tm));
+            str_tm[strcspn(str_tm, "\n")] = '\0';
+            fprintf(fd_log, "[%s] : CLIENT : TIMEOUT : %s\n", str_tm, reason);
+        #endif
+        c->broken = 1;
+        if(r->ring){
+            if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+        }else{
+            close_conn(r, c);
+        }
+        node = next;
+    }
+}
+
+/**
+* arms the timerfd of the reactor for the next tick with a timer to process
+* (the system call is made only when that tick changes)
+*/
+static void arm_wheel( reactor_t* r ){
+    struct itimerspec its;
+    uint64_t now = now_ms();
+    long next = nextWheel(r->wheel, now);
+    uint64_t at = (next < 0) ? 0 : now + next;
+    if(r->retry_at != 0 && (at == 0 || at > r->retry_at)) at = r->retry_at;
+    if(r->draining && (at == 0 || at > r->drain_at)) at = r->drain_at;
+    if(at == r->timer_at) return;
+    // a zero value disarms the timer
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = at / 1000;
+    its.it_value.tv_nsec = (at % 1000) * 1000000;
+    if(timerfd_settime(r->fd_timer, TFD_TIMER_ABSTIME, &its, NULL) == -1) perror("timerfd_settime");
+    else r->timer_at = at;
+}
+
+/**
+* the timerfd of the reactor has expired
+*/
+static void timer_conns( reactor_t* r ){
+    uint64_t n;
+    while(read(r->fd_timer, &n, sizeof(uint64_t)) == -1 && errno == EINTR);
+    expire_conns(r);
+    if(r->retry_at != 0 && now_ms() >= r->retry_at){
+        r->retry_at = 0;
+        retryAdmission(admission);
+        if(r->ring) accept_next_uring(r);
+    }
+}
+
+/**
+* an accept has failed for lack of descriptors: the clients wait in the
+* backlog until a client leaves or ACCEPT_RETRY milliseconds have passed
+*/
+static void starve_accept( reactor_t* r ){
+    starveAdmission(admission);
+    r->retry_at = now_ms() + ACCEPT_RETRY;
+}
+
+/**
+* normal shutdown: the reactor no longer accepts nor receives, the requests
+* already received are served and each connection is closed as soon as its
+* replies have been sent (the clients that are not waiting for anything at once)
+*/
+static void start_drain( reactor_t* r ){
+    conn_t *c, *next;
+    r->draining = 1;
+    r->drain_at = now_ms() + DRAIN_TIMEOUT;
+    // the event stays readable: it wakes up the other reactors, which drain too
+    eventfd_write(fd_stop, 1);
+    if(r->ring){
+        if(r->accepting) cancelUring(r->ring, URING_DATA(NULL, OP_URING_ACCEPT), URING_DATA(NULL, OP_URING_CANCEL));
+    }else{
+        epoll_ctl(r->fd_epoll, EPOLL_CTL_DEL, fd_socket, NULL);
+        epoll_ctl(r->fd_epoll, EPOLL_CTL_DEL, fd_stop, NULL);
+    }
+    for(c=r->list_conn; c!=NULL; c=next){
+        next = c->next;
+        if(r->ring){
+            if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+        }else if(serve_conn(r, c) == -1){
+            close_conn(r, c);
+        }
+    }
+}
+
+/**
+* @returns : 1 when the reactor has finished draining: all its clients
+*            have been closed, or the time given to them is over
+*/
+static int is_drained( reactor_t* r ){
+    return r->draining && (r->list_conn == NULL || now_ms() >= r->drain_at);
+}
+
+/**
+* pins the next worker to the CPU 'id' among those the server may use
+* (the attributes are changed only by the main thread, before creating it)
+*
+* @returns : 0 on success, -1 on failure
+*/
+static int pin_worker( unsigned long id ){
+    cpu_set_t allowed, set;
+    int cpu, n = 0;
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == -1) return -1;
+    if(CPU_COUNT(&allowed) == 0) return -1;
+    id = id % CPU_COUNT(&allowed);
+    for(cpu=0; cpu<CPU_SETSIZE; cpu++){
+        if(!CPU_ISSET(cpu, &allowed)) continue;
+        if(n++ == id) break;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (pthread_attr_setaffinity_np(&thread_attr, sizeof(cpu_set_t), &set) == 0) ? 0 : -1;
+}
+
+/**
+* creates the THREAD_WORKERS threads of the pool: their number no longer
+* depends on the clients connected, they wait for the requests on dispatch_request
+*
+* @returns : 0 on success, -1 on failure
+*/
+static int start_workers( void ){
+    sigset_t old_mask;
+    if((pool = (pthread_t *) calloc(settings_server.thread_workers, sizeof(pthread_t))) == NULL) return -1;
+    // the workers do not receive the signals: the main thread handles them
+    if(pthread_sigmask(SIG_BLOCK, &sig_server, &old_mask) != 0) return -1;
+    for(n_pool=0; n_pool<settings_server.thread_workers; n_pool++){
+        if(settings_server.worker_affinity && pin_worker(n_pool) == -1)
+            fprintf(stderr, "[Worker:%ld] : unable to set the CPU affinity\n", n_pool + 1);
+        if(pthread_create(&pool[n_pool], &thread_attr, workers, (void *) (intptr_t) (n_pool + 1)) != 0) break;
+        inc_num_threads();
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return (n_pool == settings_server.thread_workers) ? 0 : -1;
+}
 
-    fprintf(stdout, "[%ld] - [Master] : beginning of acceptance of requests.\n", tempo_dgb++);
+/**
+* wakes up the workers and waits for them
+*/
+static void stop_workers( void ){
+    unsigned long j;
+    stopDispatch(dispatch_request);
+    for(j=0; j<n_pool; j++){
+        pthread_join(pool[j], NULL);
+    }
+    free(pool);
+    pool = NULL;
+    n_pool = 0;
+}
+
+static void print_new_conn( reactor_t* r ){
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Reactor:%d] : A new connection request has arrived!\n", tempo_dgb++, r->id);
     #endif
+    #ifdef PRINT_LOG
+        tm = time(NULL);
+        memset(str_tm, '\0', 30);
+        assert(asctime_r(localtime(&tm), str_tm));
+        str_tm[strcspn(str_tm, "\n")] = '\0';
+        fprintf(fd_log, "[%s] : CLIENT : A new connection request has arrived!\n", str_tm);
+    #endif
+}
 
+/**
+* creates the connection with a client accepted by the reactor 'r'
+* (the client has already been counted)
+*/
+static conn_t* new_conn( reactor_t* r, long connfd ){
+    int err = 0;
+    // the reactor never blocks on a client: the requests are
+    // received a piece at a time as the bytes arrive
+    int flags = 0;
+    SYSCALL_EXIT_EQ("fcntl", flags, fcntl(connfd, F_GETFL), -1, "");
+    SYSCALL_EXIT_EQ("fcntl", err, fcntl(connfd, F_SETFL, flags | O_NONBLOCK), -1, "");
+    conn_t* c = NULL;
+    SYSCALL_EXIT_EQ("conn_create", c, conn_create(connfd, r->completion), NULL, "");
+    link_conn(r, c);
+    return c;
+}
 
-    SYSCALL_EXIT_EQ("hash_create", files_server, hash_create( DIM_HASH_TABLE, &hash_function_for_file_t, &hash_key_compare_for_file_t ) , NULL, "")
+/**
+* starts serving a client that has a place on the server
+*/
+static void start_conn( reactor_t* r, long connfd ){
+    int err = 0;
+    conn_t* c = new_conn(r, connfd);
+    if(r->ring){
+        if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+        return;
+    }
+    // one-shot: the client is disabled as soon as a request arrives,
+    // so that only one worker at a time can serve it
+    SYSCALL_EXIT_EQ("epoll_ctl", err, epoll_add_fd(r->fd_epoll, connfd, (void *) c, EPOLLIN | EPOLLONESHOT), -1, "");
+    arm_timeout(r, c);
+}
 
-    SYSCALL_EXIT_EQ("initBuffer", buffer_request, initBuffer(), NULL, "");
+/**
+* a client has just been accepted: it is served if there is a place,
+* otherwise it waits in the queue
+*/
+static void admit_conn( reactor_t* r, long connfd ){
+    if(enterAdmission(admission, connfd) == ADMISSION_QUEUED){
+        #ifdef PRINT_INFO
+        fprintf(stdout, "[%ld] - [Reactor:%d] : No place for the client '%ld', it waits in the queue!\n", tempo_dgb++, r->id, connfd);
+        #endif
+        return;
+    }
+    inc_num_client();
+    start_conn(r, connfd);
+}
 
-    SYSCALL_EXIT_EQ("initQueueP", list_files, initQueueP(), NULL, "");
+/**
+* watches (on = 1) or stops watching (on = 0) the listening socket
+* in all the reactors on epoll
+*
+* while all the places are taken, the socket would stay readable and
+* wake up the reactors continuously: the clients wait in the backlog
+*/
+static void watch_listener( int on ){
+    unsigned long j;
+    // the reactors that drain no longer accept
+    if(on && finish_work) return;
+    for(j=0; j<settings_server.io_threads; j++){
+        reactor_t* r = &reactors[j];
+        if(r->ring || r->fd_epoll == -1) continue;
+        // EPOLLEXCLUSIVE cannot be modified: the socket is removed and added again
+        if(on){
+            if(epoll_add_fd(r->fd_epoll, fd_socket, (void *) &fd_socket, EPOLLIN | EPOLLEXCLUSIVE) == -1 && errno != EEXIST) perror("epoll_ctl");
+        }else{
+            if(epoll_ctl(r->fd_epoll, EPOLL_CTL_DEL, fd_socket, NULL) == -1 && errno != ENOENT) perror("epoll_ctl");
+        }
+    }
+}
 
-    // SYSCALL_EXIT_EQ("init_hash_info_files", err, init_hash_info_files(), -1, "");
+static void accept_conn( reactor_t* r ){
+    long connfd = -1;
+    print_new_conn(r);
+    // the event may precede the moment the last place was taken
+    if(!reserveAdmission(admission)) return;
+
+    // the listener is non-blocking: another reactor may have already taken the client
+    if((connfd = accept(fd_socket, (struct sockaddr *)NULL, NULL)) == -1){
+        cancelAdmission(admission);
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR) return;
+        if(errno == EMFILE || errno == ENFILE){
+            starve_accept(r);
+            return;
+        }
+        perror("accept");
+        exit(errno);
+    }
+    admit_conn(r, connfd);
+}
 
-    int fdmax = canale[0];
+/**
+* event loop of a reactor
+*
+* @param args : the reactor
+*
+* @returns : NULL
+*/
+static void* reactor_loop( void* args ){
+    reactor_t* r = (reactor_t *) args;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int k, n_ev = 0;
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Reactor:%d] : beginning of acceptance of requests.\n", tempo_dgb++, r->id);
+    #endif
+
+    while(!close_server){
+        // normal shutdown: the clients already connected receive their replies
+        if(finish_work && !r->draining) start_drain(r);
+        if(is_drained(r)) break;
 
-    do{
-        tmpset = set;
-        if(select(fdmax+1, &tmpset, NULL, NULL, NULL) == -1){
+        if((n_ev = epoll_wait(r->fd_epoll, events, MAX_EPOLL_EVENTS, -1)) == -1){
             if(errno == EINTR){ // if a signal was caught (see signal(7))
                 continue;
             }else{
-                perror("select");
-                return;
+                perror("epoll_wait");
+                return NULL;
             }
         }
 
-        if(close_server || finish_work) break;
+        if(close_server) break;
 
-        // let's try to understand from which file descriptor we received a request
-        for(i=0; i<= fdmax; i++){
-            if(FD_ISSET(i, &tmpset) && !finish_work){
-                long connfd = -1;
-                // if it is a new connection request
-                if(i == fd_socket){
-                    #ifdef PRINT_INFO
-                    fprintf(stdout, "[%ld] - [Master] : A new connection request has arrived!\n", tempo_dgb++);
-                    #endif
-                    #ifdef PRINT_LOG
-                        tm = time(NULL);
-                        memset(str_tm, '\0', 30);
-                        assert(asctime_r(localtime(&tm), str_tm));
-                        str_tm[strcspn(str_tm, "\n")] = '\0';
-                        fprintf(fd_log, "[%s] : CLIENT : A new connection request has arrived!\n", str_tm);
-                    #endif
-                    // check if I have reached the limit number of clients connected at the same time
+        // only the file descriptors that are ready are returned:
+        // the cost no longer depends on the number of connected clients
+        for(k=0; k<n_ev; k++){
+            void* ptr = events[k].data.ptr;
+            // the shutdown starts at the beginning of the next round
+            if(ptr == (void *) &fd_stop) continue;
 
-                    if(get_num_client() >= settings_server.concurrent_clients){
-                        continue;
-                    }else{
-                        inc_num_client();
-                        int c1 = get_num_client();
-                        SYSCALL_EXIT_EQ("accept", connfd, accept(fd_socket, (struct sockaddr *)NULL, NULL), -1, "");
-                        FD_SET(connfd, &set);
-                        if(connfd > fdmax) fdmax = connfd;
-                        if(get_num_threads() < (c1 + 3)){
-                            if(pthread_create(&thread_id, &thread_attr, workers, (void *) NULL) != 0){
-                                fprintf(stderr, "pthread_create FAILED\n");
-                            }else{
-                                inc_num_threads();
-                            }
-                        }
-                        continue;
-                    }
+            // if it is a new connection request
+            if(ptr == (void *) &fd_socket){
+                if(!r->draining) accept_conn(r);
+                continue;
+            }
+
+            // if the deadline of some clients has passed
+            if(ptr == (void *) &r->fd_timer){
+                timer_conns(r);
+                continue;
+            }
+
+            // if the worker threads have finished handling some client requests
+            if(ptr == (void *) r->completion){
+                NodeC_t* done = popAllCompletion(r->completion);
+                while(done != NULL){
+                    NodeC_t* next = done->next;
+                    conn_t* c = conn_from_completion(done);
+                    end_request(r, c, done->toClose);
+                    // the reply is sent and the requests already received are served
+                    if(serve_conn(r, c) == -1) close_conn(r, c);
+                    done = next;
                 }
+                continue;
+            }
 
-                // if it is the worker thread who has finished handling a client request
-                if(i == canale[0]){
-                    #ifdef PRINT_INFO
-                    fprintf(stdout, "[%ld] - [Master] : Channel '%d' thread has finished handling a client request!\n", tempo_dgb++, i);
-                    #endif
-                    int toClose = 0;
-                    SYSCALL_EXIT_EQ("read", err, read(canale[0], &connfd, sizeof(long)), -1, "");
-                    SYSCALL_EXIT_EQ("read", err, read(canale[0], &toClose, sizeof(int)), -1, "");
-                    if(!toClose){
-                        FD_SET(connfd, &set);
-                        if(connfd > fdmax) fdmax = connfd;
-                    }else{
-                        #ifdef PRINT_INFO
-                        fprintf(stdout, "[%ld] - [Master] : Closing connection with client '%ld'!\n", tempo_dgb++, connfd);
-                        #endif
-                        #ifdef PRINT_LOG
-                            tm = time(NULL);
-                            memset(str_tm, '\0', 30);
-                            assert(asctime_r(localtime(&tm), str_tm));
-                            str_tm[strcspn(str_tm, "\n")] = '\0';
-                            fprintf(fd_log, "[%s] : CLIENT : Closing connection with a client!\n", str_tm);
-                        #endif
-                        dec_num_client();
-                    }
-                    continue;
+            // if it is a generic request from a client
+            conn_t* c = (conn_t *) ptr;
+            // (the connection may have been closed by a previous event)
+            if(c->fd == -1) continue;
+            if(serve_conn(r, c) == -1) close_conn(r, c);
+        }
+        schedule_conns(r);
+        arm_wheel(r);
+        free_dead_conns(r);
+    }
+
+    return NULL;
+}
+
+/**
+* submits the accept of the next client, if the limit of
+* clients connected at the same time has not been reached
+* (otherwise it is submitted again when a client of the reactor leaves)
+*
+* the place stays reserved until the accept ends
+*/
+static void accept_next_uring( reactor_t* r ){
+    if(r->draining || r->accepting || !reserveAdmission(admission)) return;
+    if(acceptUring(r->ring, fd_socket, URING_DATA(NULL, OP_URING_ACCEPT)) == 0) r->accepting = 1;
+    else cancelAdmission(admission);
+}
+
+/**
+* advances the connection with a client on io_uring: submits the send of
+* the replies already served and the receive of the next requests, and
+* passes the oldest request to the workers
+*
+* at most one receive and one send are in progress for each connection:
+* the buffers they use are not touched until their result arrives
+*
+* @returns : 0 if the connection stays open, -1 if it must be closed
+*/
+static int serve_conn_uring( reactor_t* r, conn_t* c ){
+    int err = 0;
+
+    if(!c->busy && !c->send_pending) conn_flush_reply(c);
+    if(!c->broken && !c->send_pending && conn_has_output(c)){
+        if(sendmsgUring(r->ring, (int) c->fd, conn_send_msg(c), URING_DATA(c, OP_URING_SEND)) == -1) c->broken = 1;
+        else c->send_pending = 1;
+    }
+
+    if(!c->broken && !c->closing && !c->recv_pending){
+        while(c->queue_len < CONN_PIPELINE_DEPTH && (err = conn_parse_input(c)) == 1){
+            if(conn_push_request(c) == -1){
+                err = -1;
+                break;
+            }
+        }
+        if(err == -1){
+            c->broken = 1;
+        }else if(c->queue_len < CONN_PIPELINE_DEPTH && !r->draining){
+            char* buf = NULL;
+            size_t len = 0;
+            conn_recv_buffer(c, &buf, &len);
+            if(recvUring(r->ring, (int) c->fd, buf, len, URING_DATA(c, OP_URING_RECV)) == -1) c->broken = 1;
+            else c->recv_pending = 1;
+        }
+    }
+    dispatch_conn(r, c);
+    arm_timeout(r, c);
+
+    if(is_over_conn(r, c)){
+        if(c->busy || c->recv_pending || c->send_pending){
+            // the operations in progress end as soon as the socket is shut down
+            c->broken = 1;
+            shutdown((int) c->fd, SHUT_RDWR);
+            return 0;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+* handles the result of an operation submitted by the reactor 'r'
+*/
+static void complete_uring( reactor_t* r, uint64_t data, int res ){
+    conn_t* c = (conn_t *) (uintptr_t) (data & ~((uint64_t) OP_URING_MASK));
+    switch(data & OP_URING_MASK){
+        case OP_URING_ACCEPT:{
+            r->accepting = 0;
+            if(res >= 0){
+                print_new_conn(r);
+                admit_conn(r, res);
+            }else{
+                cancelAdmission(admission);
+                if(res == -EMFILE || res == -ENFILE){
+                    starve_accept(r);
+                }else if(res != -EAGAIN && res != -EINTR && res != -ECONNABORTED && res != -ECANCELED){
+                    errno = -res;
+                    perror("accept");
                 }
+            }
+            accept_next_uring(r);
+            break;
+        }
+        case OP_URING_DONE:{
+            // the workers have finished handling some client requests
+            NodeC_t* done = popAllCompletion(r->completion);
+            while(done != NULL){
+                NodeC_t* next = done->next;
+                c = conn_from_completion(done);
+                end_request(r, c, done->toClose);
+                if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+                done = next;
+            }
+            readUring(r->ring, getFdCompletion(r->completion), &r->n_done, sizeof(uint64_t), URING_DATA(NULL, OP_URING_DONE));
+            break;
+        }
+        case OP_URING_RECV:{
+            c->recv_pending = 0;
+            if(res > 0) conn_received(c, res);
+            else if(res != -EAGAIN && res != -EINTR) c->broken = 1; // EOF or error
+            if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+            break;
+        }
+        case OP_URING_SEND:{
+            c->send_pending = 0;
+            if(res >= 0) conn_sent(c, res);
+            else if(res != -EAGAIN && res != -EINTR) c->broken = 1;
+            if(serve_conn_uring(r, c) == -1) close_conn(r, c);
+            break;
+        }
+        case OP_URING_TIMER:{
+            // the deadline of some clients has passed
+            timer_conns(r);
+            pollUring(r->ring, r->fd_timer, POLLIN, URING_DATA(NULL, OP_URING_TIMER));
+            break;
+        }
+        default: // OP_URING_STOP, OP_URING_CANCEL: the shutdown flags are checked by the loop
+            break;
+    }
+}
 
-                #ifdef PRINT_INFO
-                fprintf(stdout, "[%ld] - [Master] : A new request from the client of channel '%d' has arrived!\n", tempo_dgb++, i);
-                #endif
-                #ifdef PRINT_LOG
-                    tm = time(NULL);
-                    memset(str_tm, '\0', 30);
-                    assert(asctime_r(localtime(&tm), str_tm));
-                    str_tm[strcspn(str_tm, "\n")] = '\0';
-                    fprintf(fd_log, "[%s] : CLIENT : A new request arrived\n", str_tm);
-                #endif
+/**
+* event loop of a reactor on io_uring
+*
+* @param args : the reactor
+*
+* @returns : NULL
+*/
+static void* reactor_loop_uring( void* args ){
+    reactor_t* r = (reactor_t *) args;
+    struct io_uring_cqe* cqe = NULL;
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Reactor:%d] : beginning of acceptance of requests (io_uring).\n", tempo_dgb++, r->id);
+    #endif
+
+    accept_next_uring(r);
+    readUring(r->ring, getFdCompletion(r->completion), &r->n_done, sizeof(uint64_t), URING_DATA(NULL, OP_URING_DONE));
+    pollUring(r->ring, fd_stop, POLLIN, URING_DATA(NULL, OP_URING_STOP));
+    pollUring(r->ring, r->fd_timer, POLLIN, URING_DATA(NULL, OP_URING_TIMER));
 
-                // if it is a generic request from a client
-                connfd = i;
-                // int* fd_client_request;
-                FD_CLR(connfd, &set);
-                pushBuffer(buffer_request, (void *) &connfd, sizeof(long));
+    while(!close_server){
+        // normal shutdown: the clients already connected receive their replies
+        if(finish_work && !r->draining) start_drain(r);
+        if(is_drained(r)) break;
+
+        // a single system call submits everything prepared in the previous
+        // round and waits for the next results
+        if(submitUring(r->ring, 1) == -1){
+            if(errno == EINTR){ // if a signal was caught (see signal(7))
+                continue;
+            }else{
+                perror("io_uring_enter");
+                break;
             }
         }
 
-    }while(!close_server && !finish_work);
+        if(close_server) break;
+
+        while((cqe = peekCqeUring(r->ring)) != NULL){
+            uint64_t data = cqe->user_data;
+            int res = cqe->res;
+            seenCqeUring(r->ring);
+            complete_uring(r, data, res);
+        }
+        schedule_conns(r);
+        arm_wheel(r);
+        free_dead_conns(r);
+    }
+
+    // the buffers of the connections can be released only when the kernel
+    // no longer uses them: I cancel everything and wait for all the results
+    cancelAllUring(r->ring, URING_DATA(NULL, OP_URING_CANCEL));
+    while(r->ring->inflight > 0){
+        if(submitUring(r->ring, 1) == -1 && errno != EINTR) break;
+        while((cqe = peekCqeUring(r->ring)) != NULL){
+            uint64_t data = cqe->user_data;
+            int res = cqe->res;
+            conn_t* c = (conn_t *) (uintptr_t) (data & ~((uint64_t) OP_URING_MASK));
+            seenCqeUring(r->ring);
+            switch(data & OP_URING_MASK){
+                case OP_URING_ACCEPT: // a client accepted in the meantime is closed immediately
+                    if(res >= 0) close(res);
+                    break;
+                case OP_URING_SEND: // the bytes already sent are not sent again by delete_reactor
+                    c->send_pending = 0;
+                    if(res > 0) conn_sent(c, res);
+                    break;
+                case OP_URING_RECV:
+                    c->recv_pending = 0;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+* starts the event loop of the reactor on its backend
+*/
+static void* run_reactor( void* args ){
+    reactor_t* r = (reactor_t *) args;
+    if(r->ring) return reactor_loop_uring(r);
+    return reactor_loop(r);
+}
+
+/**
+* creates the io_uring or epoll instance and the completion queue of a reactor
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+static int init_reactor( reactor_t* r, int id ){
+    r->id           = id;
+    r->list_conn    = NULL;
+    r->list_dead    = NULL;
+    r->completion   = NULL;
+    r->drr          = NULL;
+    r->wheel        = NULL;
+    r->fd_timer     = -1;
+    r->timer_at     = 0;
+    r->retry_at     = 0;
+    r->draining     = 0;
+    r->drain_at     = 0;
+    r->fd_epoll     = -1;
+    r->ring         = NULL;
+    r->accepting    = 0;
+    if((r->completion = initCompletion()) == NULL) return -1;
+    if((r->drr = initDrr(DRR_QUANTUM, settings_server.thread_workers)) == NULL) return -1;
+    if((r->wheel = initWheel(TIMER_TICK, now_ms())) == NULL) return -1;
+    if((r->fd_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1) return -1;
+    if(settings_server.io_backend == IO_BACKEND_URING){
+        if((r->ring = initUring(URING_ENTRIES)) != NULL) return 0;
+        // the kernel does not allow io_uring: the reactor uses epoll
+        fprintf(stderr, "[Reactor:%d] : io_uring not available, epoll is used\n", id);
+    }
+    if((r->fd_epoll = epoll_create1(EPOLL_CLOEXEC)) == -1) return -1;
+    if(epoll_add_fd(r->fd_epoll, fd_socket, (void *) &fd_socket, EPOLLIN | EPOLLEXCLUSIVE) == -1) return -1;
+    if(epoll_add_fd(r->fd_epoll, getFdCompletion(r->completion), (void *) r->completion, EPOLLIN) == -1) return -1;
+    if(epoll_add_fd(r->fd_epoll, fd_stop, (void *) &fd_stop, EPOLLIN) == -1) return -1;
+    if(epoll_add_fd(r->fd_epoll, r->fd_timer, (void *) &r->fd_timer, EPOLLIN) == -1) return -1;
+    return 0;
+}
+
+/**
+* closes the connections of a reactor (the workers have already finished):
+* the requests given back in the meantime end as in the event loop, so
+* their replies are sent with the others before closing
+*/
+static void delete_reactor( reactor_t* r ){
+    NodeC_t* done = popAllCompletion(r->completion);
+    while(done != NULL){
+        NodeC_t* next = done->next;
+        end_request(r, conn_from_completion(done), done->toClose);
+        done = next;
+    }
+    while(r->list_conn != NULL){
+        conn_t* c = r->list_conn;
+        // last attempt to send the pending replies (the socket does not block)
+        if(!c->broken){
+            if(!c->busy) conn_flush_reply(c);
+            if(conn_has_output(c)) conn_send(c);
+        }
+        close_conn(r, c);
+    }
+    free_dead_conns(r);
+    deleteCompletion(r->completion);
+    deleteDrr(r->drr);
+    deleteWheel(r->wheel);
+    close(r->fd_timer);
+    if(r->ring) deleteUring(r->ring);
+    else close(r->fd_epoll);
+}
+
+/**
+* thread of the control socket: waits for a new server and, when it
+* connects, stops the reactors as SIGHUP does (the files and the
+* listening socket are passed to it by master at the end)
+*/
+static void* control_loop( void* args ){
+    struct pollfd pfd[2];
+    pfd[0].fd = fd_control;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = fd_stop;
+    pfd[1].events = POLLIN;
+    for(;;){
+        if(poll(pfd, 2, -1) == -1){
+            if(errno == EINTR) continue;
+            perror("poll");
+            return NULL;
+        }
+        // the server is stopping for another reason
+        if(pfd[1].revents || close_server || finish_work) return NULL;
+        int fd = accept(fd_control, NULL, NULL);
+        if(fd == -1) continue;
+        #ifdef PRINT_INFO
+        fprintf(stdout, "[%ld] - [Control] : A new server asks for the hot restart!\n", tempo_dgb++);
+        #endif
+        fd_restart = fd;
+        finish_work = 1;
+        eventfd_write(fd_stop, 1);
+        return NULL;
+    }
+}
+
+/**
+* loads the files received from the previous server, oldest first so that
+* the replacement queue keeps its order. When they do not all fit in the
+* limits of this server, the oldest ones are left out
+*/
+static void restore_files( restart_t* prev ){
+    unsigned long i, first, n = 0;
+    size_t space = 0;
+    if(!prev->hdr) return;
+    const char* base = (const char *) prev->hdr;
+    // the newest files that fit
+    for(first = prev->hdr->n_files; first > 0; first--){
+        const restart_entry_t* e = &prev->entry[first - 1];
+        if(n >= settings_server.number_of_files || space + e->size_key + e->size_data > settings_server.size_memory * MBYTE) break;
+        space += e->size_key + e->size_data;
+        n++;
+    }
+    n = 0;
+    for(i=first; i<prev->hdr->n_files; i++){
+        const restart_entry_t* e = &prev->entry[i];
+        char* key = (char *) base + e->key_off;
+        file_t* mf = hash_insert(files_server, key, e->size_key, (void *) (base + e->data_off), e->size_data, -1);
+        if(mf == NULL) continue;
+        push_qp(list_files, key, e->size_key);
+        incSpaceOccupied(1, e->size_key + e->size_data);
+        n++;
+    }
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : %ld files received from the previous server.\n", tempo_dgb++, n);
+    #endif
+    #ifdef PRINT_LOG
+        tm = time(NULL);
+        memset(str_tm, '\0', 30);
+        assert(asctime_r(localtime(&tm), str_tm));
+        str_tm[strcspn(str_tm, "\n")] = '\0';
+        fprintf(fd_log, "[%s] : SERVER : HOT RESTART : %ld files received from the previous server\n", str_tm, n);
+    #endif
+}
+
+/**
+* master: function of the server that starts the server
+*/
+void master( void ){
+    int err;
+    unsigned long j;
+    restart_t prev = { -1, NULL, NULL };
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : Creation and configuration of the server communication channel with clients in progress...\n", tempo_dgb++);
+    #endif
+    // hot restart: a running server passes its listening socket,
+    // the clients that connect in the meantime wait in the backlog
+    if(settings_server.control_socket != NULL && restart_request(settings_server.control_socket, &prev) == 0){
+        fd_socket = prev.fd_listen;
+        #ifdef PRINT_INFO
+        fprintf(stdout, "[%ld] - [Master] : listening socket received from the previous server.\n", tempo_dgb++);
+        #endif
+    }else{
+        cleanup_socket();
+        struct sockaddr_un server_addr;
+        memset(&server_addr, '0', sizeof(server_addr));
+        server_addr.sun_family = AF_UNIX;
+        strncpy(server_addr.sun_path, settings_server.socket_name, strlen(settings_server.socket_name)+1);
+
+        SYSCALL_EXIT_EQ("socket", fd_socket, socket(AF_UNIX, SOCK_STREAM, 0), -1, "");
+
+        SYSCALL_EXIT_EQ("bind", err, bind(fd_socket, (struct sockaddr *) &server_addr, sizeof(server_addr)), -1, "");
+
+        SYSCALL_EXIT_EQ("listen", err, listen(fd_socket, settings_server.concurrent_clients), -1, "");
+    }
+
+    // all the reactors accept from the same socket
+    int flags = 0;
+    SYSCALL_EXIT_EQ("fcntl", flags, fcntl(fd_socket, F_GETFL), -1, "");
+    SYSCALL_EXIT_EQ("fcntl", err, fcntl(fd_socket, F_SETFL, flags | O_NONBLOCK), -1, "");
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : finished creation and configuration of the server communication channel with clients.\n",tempo_dgb++);
+
+    fprintf(stdout, "[%ld] - [Master] : configuration of the methods of creation and functioning of threads in progress...\n", tempo_dgb++);
+    #endif
+
+    SYSCALL_EXIT_NEQ("pthread_attr_init", err, pthread_attr_init(&thread_attr), 0, "");
+    SYSCALL_EXIT_NEQ("pthread_attr_setdetachstate", err, pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE), 0, "");
+
+    sigemptyset(&sig_server);
+    sigaddset(&sig_server, SIGINT);
+    sigaddset(&sig_server, SIGQUIT);
+    sigaddset(&sig_server, SIGHUP);
+    sigaddset(&sig_server, SIGPIPE);
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : configuration of the methods of creation and functioning of the finished threads.\n", tempo_dgb++);
+    #endif
+
+    if(settings_server.files_index == FILES_INDEX_SWISS){
+        SYSCALL_EXIT_EQ("hash_create_swiss", files_server, hash_create_swiss( DIM_HASH_TABLE, &hash_function_for_file_t, &hash_key_compare_for_file_t ) , NULL, "")
+    }else{
+        SYSCALL_EXIT_EQ("hash_create_striped", files_server, hash_create_striped( DIM_HASH_TABLE, (int) settings_server.files_lock_stripes, &hash_function_for_file_t, &hash_key_compare_for_file_t ) , NULL, "")
+    }
+
+    // a client has at most one request in the run queues: a queue never fills up
+    SYSCALL_EXIT_EQ("initDispatch", dispatch_request, initDispatch(settings_server.thread_workers, settings_server.concurrent_clients), NULL, "");
+
+    SYSCALL_EXIT_EQ("initQueueP", list_files, initQueueP(), NULL, "");
+
+    // the files of the previous server are loaded before accepting anyone
+    restore_files(&prev);
+    restart_release(&prev);
+
+    SYSCALL_EXIT_EQ("start_workers", err, start_workers(), -1, "");
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : %ld workers ready.\n", tempo_dgb++, get_num_threads());
+    #endif
+
+    // SYSCALL_EXIT_EQ("init_hash_info_files", err, init_hash_info_files(), -1, "");
+
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : creation of %ld reactors.\n", tempo_dgb++, settings_server.io_threads);
+    #endif
+    SYSCALL_EXIT_EQ("initAdmission", admission, initAdmission(settings_server.concurrent_clients, settings_server.accept_queue, watch_listener), NULL, "");
+    SYSCALL_EXIT_EQ("eventfd", fd_stop, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), -1, "");
+    SYSCALL_EXIT_EQ("calloc", reactors, (reactor_t *) calloc(settings_server.io_threads, sizeof(reactor_t)), NULL, "");
+    for(j=0; j<settings_server.io_threads; j++){
+        SYSCALL_EXIT_EQ("init_reactor", err, init_reactor(&reactors[j], j), -1, "");
+    }
+    if(settings_server.control_socket != NULL && (fd_control = restart_listen(settings_server.control_socket)) == -1)
+        perror("restart_listen");
+    // the other reactors do not receive the signals: the main thread wakes them up
+    sigset_t old_mask;
+    SYSCALL_EXIT_NEQ("pthread_sigmask", err, pthread_sigmask(SIG_BLOCK, &sig_server, &old_mask), 0, "");
+    for(j=1; j<settings_server.io_threads; j++){
+        SYSCALL_EXIT_NEQ("pthread_create", err, pthread_create(&reactors[j].tid, NULL, run_reactor, (void *) &reactors[j]), 0, "");
+    }
+    if(fd_control != -1){
+        SYSCALL_EXIT_NEQ("pthread_create", err, pthread_create(&control_tid, NULL, control_loop, NULL), 0, "");
+    }
+    SYSCALL_EXIT_NEQ("pthread_sigmask", err, pthread_sigmask(SIG_SETMASK, &old_mask, NULL), 0, "");
+
+    run_reactor(&reactors[0]);
 
     #ifdef PRINT_INFO
     if(close_server) fprintf(stdout, "[%ld] - [Master] : Reception of the forced shutdown signal of the server!\n", tempo_dgb++);
     if(finish_work) fprintf(stdout, "[%ld] - [Master] : Reception of the normal shutdown signal of the server!\n", tempo_dgb++);
     #endif
 
-    unsigned long n = get_num_threads();
-    long f = -1;
-    while(n > 0){
-        pushBuffer(buffer_request, (void *) &f, sizeof(long));
-        n--;
+    // the event stays readable, so it wakes up every reactor
+    SYSCALL_EXIT_EQ("eventfd_write", err, eventfd_write(fd_stop, 1), -1, "");
+    for(j=1; j<settings_server.io_threads; j++){
+        SYSCALL_EXIT_NEQ("pthread_join", err, pthread_join(reactors[j].tid, NULL), 0, "");
+    }
+    if(fd_control != -1){
+        SYSCALL_EXIT_NEQ("pthread_join", err, pthread_join(control_tid, NULL), 0, "");
+    }
+
+    stop_workers();
+    for(j=0; j<settings_server.io_threads; j++){
+        delete_reactor(&reactors[j]);
     }
-    while(get_num_threads() > 0);
-    close(canale[0]);
-    close(canale[1]);
+    free(reactors);
+    close(fd_stop);
+
+    // the workers have finished: the files no longer change
+    if(fd_restart != -1){
+        if(restart_give(fd_restart, fd_socket, files_server, list_files) == -1){
+            perror("restart_give");
+        }else{
+            #ifdef PRINT_INFO
+            fprintf(stdout, "[%ld] - [Master] : listening socket and files passed to the new server.\n", tempo_dgb++);
+            #endif
+            #ifdef PRINT_LOG
+                tm = time(NULL);
+                memset(str_tm, '\0', 30);
+                assert(asctime_r(localtime(&tm), str_tm));
+                str_tm[strcspn(str_tm, "\n")] = '\0';
+                fprintf(fd_log, "[%s] : SERVER : HOT RESTART : files passed to the new server\n", str_tm);
+            #endif
+        }
+        close(fd_restart);
+    }else if(fd_control != -1){
+        // the control socket now belongs to the new server, if any
+        unlink(settings_server.control_socket);
+    }
+    if(fd_control != -1) close(fd_control);
+    close(fd_socket);
+
+    unsigned long n_queued = 0, n_rejected = 0;
+    closeAdmission(admission);
+    getStatsAdmission(admission, &n_queued, &n_rejected);
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : clients that waited for a place = %ld, clients rejected = %ld\n", tempo_dgb++, n_queued, n_rejected);
+    #endif
+    #ifdef PRINT_LOG
+        tm = time(NULL);
+        memset(str_tm, '\0', 30);
+        assert(asctime_r(localtime(&tm), str_tm));
+        str_tm[strcspn(str_tm, "\n")] = '\0';
+        fprintf(fd_log, "[%s] : SERVER : ADMISSION : queued = %ld and rejected = %ld\n", str_tm, n_queued, n_rejected);
+    #endif
+    deleteAdmission(admission);
 
     SYSCALL_EXIT_NEQ("pthread_attr_destroy", err, pthread_attr_destroy(&thread_attr), 0, "");
     //destroy_info_files();
     SYSCALL_EXIT_EQ("hash_destroy", err, hash_destroy(files_server), -1, "");
-    //SYSCALL_EXIT_EQ("deleteQueue", err, deleteQueue(buffer_request), void, "");
-    deleteBuffer(buffer_request);
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Master] : requests stolen by an idle worker = %ld\n", tempo_dgb++, getStolenDispatch(dispatch_request));
+    #endif
+    deleteDispatch(dispatch_request);
     deleteQueueP(list_files);
 }
 
@@ -1757,6 +2971,7 @@ int main(int argc, char** argv){
     SYSCALL_EXIT_EQ("config_server", err, config_server(argv[1]), -1,
                             "server configuration failure");
     cleanup_log();
+    SYSCALL_EXIT_EQ("init_info_server", err, init_info_server(), -1, "");
     SYSCALL_EXIT_EQ("fopen", fd_log, fopen(settings_server.log_file_name, "w+"), NULL, "fopen");
 
     #ifdef PRINT_INFO
@@ -1777,8 +2992,14 @@ int main(int argc, char** argv){
         memset(str_tm, '\0', 30);
         assert(asctime_r(localtime(&tm), str_tm));
         str_tm[strcspn(str_tm, "\n")] = '\0';
-        fprintf(fd_log, "[%s] : SERVER : RESUME : client = %ld and space = %ld\n", str_tm, client_all_server, space_all_server);
+        fprintf(fd_log, "[%s] : SERVER : RESUME : client = %ld and space = %ld\n", str_tm, readCounter(IS.client_all_server), readCounter(IS.space_all_server));
+    #endif
+    #ifdef PRINT_INFO
+    fprintf(stdout, "[%ld] - [Server] : clients served = %ld, bytes written = %ld, files stored at the end = %ld (%ld bytes)\n", tempo_dgb++,
+                readCounter(IS.client_all_server), readCounter(IS.space_all_server),
+                readCounter(IS.currently_number_files), readCounter(IS.currently_space_occupied));
     #endif
+    delete_info_server();
 
     cancel_cfs();
 
@@ -0,0 +1,185 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file shmring.c
+ *
+ * Implementation of the shared-memory rings of a connection
+ *
+ * Each ring has a single producer and a single consumer: the bytes are
+ * copied before publishing the new head (release), and who takes them
+ * reads the head (acquire) before copying them, then publishes the new
+ * tail. The memfd is sealed against shrinking: the client cannot make
+ * the mapping of the server fault.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#define _GNU_SOURCE // needed for memfd_create
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shmring.h"
+
+
+/************************** utility functions ************************/
+
+static inline ShmRing_t* allocShmRing( void ){
+    return calloc(1, sizeof(ShmRing_t));
+}
+
+static inline char* dataShmRing( ShmRing_t* r, int ring ){
+    return r->base + SHM_RING_DATA + ring * r->size;
+}
+
+/**
+* maps the memfd 'fd' (2 rings of 'size' bytes after the positions)
+*
+* @returns : the rings, NULL on failure and errno is set
+*/
+static ShmRing_t* attachShmRing( int fd, size_t size ){
+    ShmRing_t* r = allocShmRing();
+    if(!r) return NULL;
+    r->fd = fd;
+    r->size = size;
+    r->map_size = SHM_RING_DATA + 2 * size;
+    r->base = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(r->base == MAP_FAILED){
+        free(r);
+        return NULL;
+    }
+    r->pos = (ShmPos_t *) r->base;
+    return r;
+}
+
+
+/************************** shm ring interface ***********************/
+
+/**
+* creates the rings of a connection (server side)
+*
+* @param size : bytes of each ring
+*
+* @returns : the rings, NULL on failure and errno is set
+*/
+ShmRing_t* initShmRing( size_t size ){
+    if(size < SHM_RING_MIN){
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = memfd_create("fss-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(fd == -1) return NULL;
+    if(ftruncate(fd, SHM_RING_DATA + 2 * size) == -1
+        || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1){
+        close(fd);
+        return NULL;
+    }
+    ShmRing_t* r = attachShmRing(fd, size);
+    if(!r) close(fd);
+    return r;
+}
+
+/**
+* maps the rings received from the server (client side):
+* the descriptor belongs to the rings, also on failure
+*
+* @returns : the rings, NULL on failure and errno is set
+*/
+ShmRing_t* mapShmRing( int fd ){
+    struct stat st;
+    if(fstat(fd, &st) == -1){
+        close(fd);
+        return NULL;
+    }
+    if((size_t) st.st_size <= SHM_RING_DATA){
+        close(fd);
+        errno = EPROTO;
+        return NULL;
+    }
+    ShmRing_t* r = attachShmRing(fd, ((size_t) st.st_size - SHM_RING_DATA) / 2);
+    if(!r) close(fd);
+    return r;
+}
+
+void deleteShmRing( ShmRing_t* r ){
+    if(!r) return;
+    munmap(r->base, r->map_size);
+    close(r->fd);
+    free(r);
+}
+
+int getFdShmRing( ShmRing_t* r ){
+    return r->fd;
+}
+
+/**
+* puts 'len' bytes in the ring 'ring', after those already there
+*
+* @returns : 0 on success, -1 if there is no room (errno = ENOSPC)
+*/
+int putShmRing( ShmRing_t* r, int ring, const void* buf, size_t len ){
+    uint64_t tail = __atomic_load_n(&r->pos[ring].tail, __ATOMIC_ACQUIRE);
+    uint64_t used = r->head[ring] - tail;
+    if(tail > r->head[ring] || len > r->size - used){
+        errno = ENOSPC;
+        return -1;
+    }
+    size_t off = r->head[ring] % r->size;
+    size_t first = (len < r->size - off) ? len : r->size - off;
+    memcpy(dataShmRing(r, ring) + off, buf, first);
+    memcpy(dataShmRing(r, ring), (const char *) buf + first, len - first);
+    r->head[ring] += len;
+    __atomic_store_n(&r->pos[ring].head, r->head[ring], __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+* takes the next 'len' bytes of the ring 'ring'
+*
+* @returns : 0 on success, -1 if the other side has not put them (errno = EPROTO)
+*/
+int takeShmRing( ShmRing_t* r, int ring, void* buf, size_t len ){
+    uint64_t head = __atomic_load_n(&r->pos[ring].head, __ATOMIC_ACQUIRE);
+    if(head < r->tail[ring] || head - r->tail[ring] < len || len > r->size){
+        errno = EPROTO;
+        return -1;
+    }
+    size_t off = r->tail[ring] % r->size;
+    size_t first = (len < r->size - off) ? len : r->size - off;
+    memcpy(buf, dataShmRing(r, ring) + off, first);
+    memcpy((char *) buf + first, dataShmRing(r, ring), len - first);
+    r->tail[ring] += len;
+    __atomic_store_n(&r->pos[ring].tail, r->tail[ring], __ATOMIC_RELEASE);
+    return 0;
+}
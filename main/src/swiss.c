@@ -0,0 +1,289 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+/**
+ * @file swiss.c
+ *
+ * Implementation of the open-addressing index of the files
+ *
+ * The hash of a key gives the first group of its probe sequence (high bits)
+ * and its fingerprint (low 7 bits). The probe sequence visits the groups
+ * at distance 1, 2, 3, ... from the previous one: with a power of 2 of
+ * groups it reaches all of them. A key is always in the first group of
+ * its sequence that had a slot not full when it was inserted, so a lookup
+ * stops at the first group with an empty slot.
+ *
+ * A removed file leaves a deleted slot, which does not stop the lookups,
+ * unless its group has an empty slot already. At most 7/8 of the slots are
+ * used (full or deleted): beyond that the index is rebuilt without the
+ * deleted slots, twice as large if it is more than half full.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "swiss.h"
+
+// slots that can be used (full or deleted) in an index of 'cap' slots
+#define SWISS_MAX_LOAD( cap ) ((cap) - (cap) / 8)
+
+
+/************************** utility functions ************************/
+
+// first group of the probe sequence of a hash
+static inline size_t h1( uint64_t h ){
+    return (size_t) (h >> 7);
+}
+
+// fingerprint of a hash, the control byte of its slot
+static inline uint8_t h2( uint64_t h ){
+    return (uint8_t) (h & 0x7F);
+}
+
+/**
+* @returns : a bit for each byte of the group equal to 'b'
+*/
+static inline unsigned int matchGroup( const uint8_t* g, uint8_t b ){
+#ifdef __SSE2__
+    __m128i ctrl = _mm_load_si128((const __m128i *) g);
+    return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) b)));
+#else
+    unsigned int m = 0;
+    int i;
+    for(i=0; i<SWISS_GROUP; i++)
+        if(g[i] == b) m |= 1u << i;
+    return m;
+#endif
+}
+
+/**
+* @returns : a bit for each slot of the group not full (empty or deleted)
+*/
+static inline unsigned int freeGroup( const uint8_t* g ){
+#ifdef __SSE2__
+    // only the bytes of the slots not full have the high bit set
+    return (unsigned int) _mm_movemask_epi8(_mm_load_si128((const __m128i *) g));
+#else
+    unsigned int m = 0;
+    int i;
+    for(i=0; i<SWISS_GROUP; i++)
+        if(g[i] & 0x80) m |= 1u << i;
+    return m;
+#endif
+}
+
+/**
+* gives to the index 'cap' empty slots (the old ones are not released)
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+static int allocSwiss( Swiss_t* s, size_t cap ){
+    void* ctrl = NULL;
+    file_t** slot = NULL;
+    // the groups are read with aligned loads
+    if((errno = posix_memalign(&ctrl, SWISS_GROUP, cap)) != 0)
+        return -1;
+    if((slot = calloc(cap, sizeof(file_t *))) == NULL){
+        free(ctrl);
+        return -1;
+    }
+    memset(ctrl, SWISS_EMPTY, cap);
+    s->ctrl = (uint8_t *) ctrl;
+    s->slot = slot;
+    s->cap = cap;
+    s->n = 0;
+    s->growth_left = SWISS_MAX_LOAD(cap);
+    return 0;
+}
+
+/**
+* @returns : the first slot not full on the probe sequence of 'h'
+*            (there is always one: at most 7/8 of the slots are used)
+*/
+static size_t freeSlot( Swiss_t* s, uint64_t h ){
+    size_t mask = s->cap / SWISS_GROUP - 1;
+    size_t g = h1(h) & mask;
+    size_t step = 0;
+    for(;;){
+        unsigned int m = freeGroup(s->ctrl + g * SWISS_GROUP);
+        if(m != 0)
+            return g * SWISS_GROUP + __builtin_ctz(m);
+        g = (g + ++step) & mask;
+    }
+}
+
+static void setSlot( Swiss_t* s, size_t i, file_t* f ){
+    if(s->ctrl[i] == SWISS_EMPTY) s->growth_left--;
+    s->ctrl[i] = h2(f->hash);
+    s->slot[i] = f;
+    s->n++;
+}
+
+/**
+* @returns : the slot of the file with key 'key', -1 if it is not in the index
+*/
+static long findSlot( Swiss_t* s, char* key, uint64_t h, int (*compare)(char *, char *) ){
+    size_t mask = s->cap / SWISS_GROUP - 1;
+    size_t g = h1(h) & mask;
+    size_t step = 0;
+    uint8_t fp = h2(h);
+    for(;;){
+        const uint8_t* ctrl = s->ctrl + g * SWISS_GROUP;
+        unsigned int m = matchGroup(ctrl, fp);
+        while(m != 0){
+            size_t i = g * SWISS_GROUP + __builtin_ctz(m);
+            file_t* f = s->slot[i];
+            if(f->hash == h && compare(f->key, key) == 0)
+                return (long) i;
+            m &= m - 1;
+        }
+        if(matchGroup(ctrl, SWISS_EMPTY) != 0 || step == mask)
+            return -1;
+        g = (g + ++step) & mask;
+    }
+}
+
+/**
+* rebuilds the index without the deleted slots, twice as large
+* if it is more than half full
+*
+* @returns : 0 on success, -1 on failure (the index is unchanged)
+*/
+static int rehashSwiss( Swiss_t* s ){
+    Swiss_t old = *s;
+    size_t cap = (2 * s->n >= SWISS_MAX_LOAD(s->cap)) ? 2 * s->cap : s->cap;
+    size_t i;
+    if(allocSwiss(s, cap) == -1)
+        return -1;
+    for(i=0; i<old.cap; i++)
+        if(!(old.ctrl[i] & 0x80))
+            setSlot(s, freeSlot(s, old.slot[i]->hash), old.slot[i]);
+    free(old.ctrl);
+    free(old.slot);
+    return 0;
+}
+
+
+/************************* index of the files ************************/
+
+/**
+* @param size : files the index must hold before growing
+*
+* @returns : the index, NULL on failure and errno is set
+*/
+Swiss_t* initSwiss( size_t size ){
+    size_t cap = SWISS_GROUP;
+    while(SWISS_MAX_LOAD(cap) < size)
+        cap *= 2;
+    Swiss_t* s = calloc(1, sizeof(Swiss_t));
+    if(!s) return NULL;
+    if(allocSwiss(s, cap) == -1){
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/**
+* the files still in the index are not released: they belong to who inserted them
+*/
+void deleteSwiss( Swiss_t* s ){
+    if(!s) return;
+    free(s->ctrl);
+    free(s->slot);
+    free(s);
+}
+
+/**
+* @param h : hash of the key, the one kept in the files (hash)
+* @param compare : comparison of two keys, 0 if they are equal
+*
+* @returns : the file with key 'key', NULL if it is not in the index
+*/
+file_t* findSwiss( Swiss_t* s, char* key, uint64_t h, int (*compare)(char *, char *) ){
+    if(!s || !key) return NULL;
+    long i = findSlot(s, key, h, compare);
+    return (i < 0) ? NULL : s->slot[i];
+}
+
+/**
+* adds a file, with its hash already set (hash); the caller makes sure
+* that there is no file with the same key
+*
+* @returns : 0 on success, -1 on failure and errno is set
+*/
+int insertSwiss( Swiss_t* s, file_t* f ){
+    if(!s || !f){
+        errno = EINVAL;
+        return -1;
+    }
+    if(s->growth_left == 0 && rehashSwiss(s) == -1)
+        return -1;
+    setSlot(s, freeSlot(s, f->hash), f);
+    return 0;
+}
+
+/**
+* @returns : the file removed, NULL if it is not in the index
+*/
+file_t* removeSwiss( Swiss_t* s, char* key, uint64_t h, int (*compare)(char *, char *) ){
+    if(!s || !key) return NULL;
+    long i = findSlot(s, key, h, compare);
+    if(i < 0) return NULL;
+    file_t* f = s->slot[i];
+    // a group with an empty slot already stops the lookups that reach it
+    if(matchGroup(s->ctrl + (i & ~(long) (SWISS_GROUP - 1)), SWISS_EMPTY) != 0){
+        s->ctrl[i] = SWISS_EMPTY;
+        s->growth_left++;
+    }else{
+        s->ctrl[i] = SWISS_DELETED;
+    }
+    s->slot[i] = NULL;
+    s->n--;
+    return f;
+}
+
+/**
+* @param pos : first slot to look at, moved past the file returned
+*
+* @returns : the first file from the slot 'pos', NULL if there are no more
+*/
+file_t* nextSwiss( Swiss_t* s, long* pos ){
+    if(!s || !pos || *pos < 0) return NULL;
+    for(; (size_t) *pos < s->cap; (*pos)++){
+        if(!(s->ctrl[*pos] & 0x80))
+            return s->slot[(*pos)++];
+    }
+    return NULL;
+}
@@ -0,0 +1,251 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/**
+ * @file uring.c
+ *
+ * Implementation of the io_uring instance, without external libraries
+ *
+ * The program is the only producer of the submission ring and the only
+ * consumer of the completion ring: the indexes shared with the kernel are
+ * read with acquire and written with release semantics, everything else
+ * is private to the thread that owns the instance.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+
+/************************** utility functions ************************/
+
+static inline Uring_t* allocUring( void ){
+    return (Uring_t *) malloc(sizeof(Uring_t));
+}
+
+static inline int setupUring( unsigned entries, struct io_uring_params* p ){
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int enterUring( int fd, unsigned to_submit, unsigned min_complete, unsigned flags ){
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void unmapUring( Uring_t* u ){
+    if(u->sqes && u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_size);
+    if(u->cq_ptr && u->cq_ptr != MAP_FAILED && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_size);
+    if(u->sq_ptr && u->sq_ptr != MAP_FAILED) munmap(u->sq_ptr, u->sq_size);
+}
+
+/**
+* next free submission entry, the ring is submitted first if it is full
+*
+* @returns : the entry (cleared), NULL on failure
+*/
+static struct io_uring_sqe* getSqeUring( Uring_t* u ){
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *u->sq_tail + u->sq_pending;
+    if(tail - head >= u->sq_entries){
+        if(submitUring(u, 0) == -1) return NULL;
+        head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        tail = *u->sq_tail;
+        if(tail - head >= u->sq_entries){
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe* sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    u->sq_array[index] = index;
+    u->sq_pending++;
+    u->inflight++;
+    return sqe;
+}
+
+static int prepUring( Uring_t* u, int op, int fd, const void* buf, size_t len, uint64_t data ){
+    struct io_uring_sqe* sqe = getSqeUring(u);
+    if(!sqe) return -1;
+    sqe->opcode     = (__u8) op;
+    sqe->fd         = fd;
+    sqe->addr       = (__u64) (uintptr_t) buf;
+    sqe->len        = (__u32) len;
+    sqe->user_data  = data;
+    return 0;
+}
+
+
+/*************************** uring interface *************************/
+
+/**
+* creates an io_uring instance
+*
+* @param entries : size of the submission ring
+*
+* @returns : the new instance, NULL if io_uring is not available
+*/
+Uring_t* initUring( unsigned entries ){
+    Uring_t* u = allocUring();
+    if(!u) return NULL;
+    memset(u, 0, sizeof(Uring_t));
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if((u->ring_fd = setupUring(entries, &p)) == -1){
+        free(u);
+        return NULL;
+    }
+
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP){
+        if(u->cq_size > u->sq_size) u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    if(u->sq_ptr == MAP_FAILED) goto error;
+    if(p.features & IORING_FEAT_SINGLE_MMAP){
+        u->cq_ptr = u->sq_ptr;
+    }else{
+        u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+        if(u->cq_ptr == MAP_FAILED) goto error;
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe *) mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if(u->sqes == MAP_FAILED) goto error;
+
+    u->sq_entries   = p.sq_entries;
+    u->sq_head      = (unsigned *) ((char *) u->sq_ptr + p.sq_off.head);
+    u->sq_tail      = (unsigned *) ((char *) u->sq_ptr + p.sq_off.tail);
+    u->sq_mask      = (unsigned *) ((char *) u->sq_ptr + p.sq_off.ring_mask);
+    u->sq_array     = (unsigned *) ((char *) u->sq_ptr + p.sq_off.array);
+    u->cq_head      = (unsigned *) ((char *) u->cq_ptr + p.cq_off.head);
+    u->cq_tail      = (unsigned *) ((char *) u->cq_ptr + p.cq_off.tail);
+    u->cq_mask      = (unsigned *) ((char *) u->cq_ptr + p.cq_off.ring_mask);
+    u->cqes         = (struct io_uring_cqe *) ((char *) u->cq_ptr + p.cq_off.cqes);
+    return u;
+
+    error:
+        unmapUring(u);
+        close(u->ring_fd);
+        free(u);
+        return NULL;
+}
+
+void deleteUring( Uring_t* u ){
+    if(!u) return;
+    unmapUring(u);
+    close(u->ring_fd);
+    free(u);
+}
+
+/**
+* submits the prepared operations and waits for 'wait_nr' results
+*
+* @returns : number of operations submitted, -1 on failure and errno is set
+*            (EINTR if a signal arrived while waiting)
+*/
+int submitUring( Uring_t* u, unsigned wait_nr ){
+    unsigned n = u->sq_pending;
+    if(n > 0){
+        __atomic_store_n(u->sq_tail, *u->sq_tail + n, __ATOMIC_RELEASE);
+        u->sq_pending = 0;
+    }
+    int r = enterUring(u->ring_fd, n, wait_nr, (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0);
+    if(r < 0) return -1;
+    return r;
+}
+
+/**
+* @returns : the first result not yet consumed, NULL if there is none
+*/
+struct io_uring_cqe* peekCqeUring( Uring_t* u ){
+    unsigned head = *u->cq_head;
+    if(head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &u->cqes[head & *u->cq_mask];
+}
+
+/**
+* gives back to the kernel the result returned by peekCqeUring
+*/
+void seenCqeUring( Uring_t* u ){
+    u->inflight--;
+    __atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+int recvUring( Uring_t* u, int fd, void* buf, size_t len, uint64_t data ){
+    return prepUring(u, IORING_OP_RECV, fd, buf, len, data);
+}
+
+/**
+* sends the buffers described by 'msg' with a single operation
+* ('msg' and its iovec must stay valid until the result arrives)
+*/
+int sendmsgUring( Uring_t* u, int fd, const struct msghdr* msg, uint64_t data ){
+    return prepUring(u, IORING_OP_SENDMSG, fd, msg, 1, data);
+}
+
+int acceptUring( Uring_t* u, int fd, uint64_t data ){
+    return prepUring(u, IORING_OP_ACCEPT, fd, NULL, 0, data);
+}
+
+int readUring( Uring_t* u, int fd, void* buf, size_t len, uint64_t data ){
+    // offset -1: the current position (the only one for eventfd)
+    if(prepUring(u, IORING_OP_READ, fd, buf, len, data) == -1) return -1;
+    u->sqes[(*u->sq_tail + u->sq_pending - 1) & *u->sq_mask].off = (__u64) -1;
+    return 0;
+}
+
+int pollUring( Uring_t* u, int fd, unsigned events, uint64_t data ){
+    if(prepUring(u, IORING_OP_POLL_ADD, fd, NULL, 0, data) == -1) return -1;
+    u->sqes[(*u->sq_tail + u->sq_pending - 1) & *u->sq_mask].poll32_events = events;
+    return 0;
+}
+
+/**
+* cancels the operation in progress submitted with the user data 'target'
+*/
+int cancelUring( Uring_t* u, uint64_t target, uint64_t data ){
+    return prepUring(u, IORING_OP_ASYNC_CANCEL, -1, (const void *) (uintptr_t) target, 0, data);
+}
+
+/**
+* cancels all the operations still in progress
+*/
+int cancelAllUring( Uring_t* u, uint64_t data ){
+    if(prepUring(u, IORING_OP_ASYNC_CANCEL, -1, NULL, 0, data) == -1) return -1;
+    u->sqes[(*u->sq_tail + u->sq_pending - 1) & *u->sq_mask].cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    return 0;
+}
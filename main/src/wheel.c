@@ -0,0 +1,199 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file wheel.c
+ *
+ * Implementation of the hierarchical timer wheel
+ *
+ * A timer is placed at the lowest level where its expiration is less than
+ * WHEEL_SLOTS slots away from the current one, so it is never in the slot
+ * that is being processed. When the slot of a level passes, its timers
+ * are placed again (cascade): they end up in the level below, until they
+ * reach the level 0, where the slot of a tick holds the timers that expire
+ * in that tick.
+ *
+ * The times are in milliseconds, the timers expire in the first tick
+ * not earlier than their deadline.
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "wheel.h"
+
+// the farthest tick a timer can be placed at (it never reaches the top slot being processed)
+#define WHEEL_SPAN ((uint64_t) (WHEEL_SLOTS - 2) << (WHEEL_BITS * (WHEEL_LEVELS - 1)))
+
+
+/************************** utility functions ************************/
+
+static inline Wheel_t* allocWheel( void ){
+    return calloc(1, sizeof(Wheel_t));
+}
+
+static void linkWheel( NodeW_t** slot, NodeW_t* node ){
+    node->slot = slot;
+    node->prev = NULL;
+    node->next = *slot;
+    if(*slot) (*slot)->prev = node;
+    *slot = node;
+}
+
+static void unlinkWheel( NodeW_t* node ){
+    if(node->prev) node->prev->next = node->next;
+    else *node->slot = node->next;
+    if(node->next) node->next->prev = node->prev;
+    node->slot = NULL;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+/**
+* places the timer at the lowest level where its tick
+* is less than WHEEL_SLOTS slots away from the current one
+*/
+static void placeWheel( Wheel_t* w, NodeW_t* node ){
+    int i;
+    for(i=0; i<WHEEL_LEVELS-1; i++){
+        if((node->expire >> (WHEEL_BITS * i)) - (w->now >> (WHEEL_BITS * i)) < WHEEL_SLOTS) break;
+    }
+    linkWheel(&w->slot[i][(node->expire >> (WHEEL_BITS * i)) & (WHEEL_SLOTS - 1)], node);
+}
+
+/**
+* places again the timers of the slots of the upper levels that pass in the current tick
+*/
+static void cascadeWheel( Wheel_t* w ){
+    int i;
+    for(i=WHEEL_LEVELS-1; i>0; i--){
+        if(w->now & (((uint64_t) 1 << (WHEEL_BITS * i)) - 1)) continue;
+        NodeW_t** slot = &w->slot[i][(w->now >> (WHEEL_BITS * i)) & (WHEEL_SLOTS - 1)];
+        NodeW_t* list = *slot;
+        *slot = NULL;
+        while(list != NULL){
+            NodeW_t* node = list;
+            list = list->next;
+            placeWheel(w, node);
+        }
+    }
+}
+
+
+/************************** wheel interface ***********************/
+
+/**
+* @param tick : length of a tick (milliseconds)
+* @param now : current time (milliseconds)
+*
+* @returns : the wheel, NULL on failure and errno is set
+*/
+Wheel_t* initWheel( unsigned long tick, uint64_t now ){
+    if(tick == 0){
+        errno = EINVAL;
+        return NULL;
+    }
+    Wheel_t* w = allocWheel();
+    if(!w) return NULL;
+    w->tick = tick;
+    w->now  = now / tick;
+    return w;
+}
+
+/**
+* the timers still in the wheel are not released: they belong to who added them
+*/
+void deleteWheel( Wheel_t* w ){
+    if(w) free(w);
+}
+
+/**
+* adds the timer or, if it is already in the wheel, moves it
+*
+* @param expire : deadline (milliseconds)
+*/
+void addWheel( Wheel_t* w, NodeW_t* node, uint64_t expire ){
+    if(!w || !node) return;
+    if(node->slot) removeWheel(w, node);
+    uint64_t t = (expire + w->tick - 1) / w->tick;
+    // the slot of the current tick has already been processed
+    if(t <= w->now) t = w->now + 1;
+    if(t - w->now > WHEEL_SPAN) t = w->now + WHEEL_SPAN;
+    node->expire = t;
+    placeWheel(w, node);
+    w->n++;
+}
+
+void removeWheel( Wheel_t* w, NodeW_t* node ){
+    if(!w || !node || !node->slot) return;
+    unlinkWheel(node);
+    w->n--;
+}
+
+/**
+* processes the ticks up to the time 'now'
+*
+* @returns : the list (next) of the timers expired, already out of the wheel
+*/
+NodeW_t* advanceWheel( Wheel_t* w, uint64_t now ){
+    NodeW_t* expired = NULL;
+    if(!w) return NULL;
+    uint64_t target = now / w->tick;
+    while(w->n > 0 && w->now < target){
+        w->now++;
+        cascadeWheel(w);
+        NodeW_t** slot = &w->slot[0][w->now & (WHEEL_SLOTS - 1)];
+        while(*slot != NULL){
+            NodeW_t* node = *slot;
+            unlinkWheel(node);
+            w->n--;
+            node->next = expired;
+            expired = node;
+        }
+    }
+    // without timers the ticks do not need to be visited
+    if(w->now < target) w->now = target;
+    return expired;
+}
+
+/**
+* @returns : the milliseconds before the wheel must be advanced again,
+*            -1 if there are no timers
+*/
+long nextWheel( Wheel_t* w, uint64_t now ){
+    uint64_t k;
+    if(!w || w->n == 0) return -1;
+    // the first timer of the level 0 or, if it is empty, the next cascade
+    for(k=1; k<WHEEL_SLOTS; k++){
+        if(w->slot[0][(w->now + k) & (WHEEL_SLOTS - 1)] != NULL) break;
+        if(((w->now + k) & (WHEEL_SLOTS - 1)) == 0) break;
+    }
+    uint64_t at = (w->now + k) * w->tick;
+    return (at > now) ? (long) (at - now) : 0;
+}
@@ -0,0 +1,193 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/**
+ * @file bench_buffer.c
+ *
+ * microbenchmark of the queue between reactors and workers: the ring of
+ * buffer.h against the previous implementation (list with a node and a copy
+ * of the element allocated at every push, all under one mutex)
+ *
+ * usage: bench_buffer [elements per producer] [size of the ring]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "utils.h"
+#include "buffer.h"
+
+// element that stops a consumer
+#define STOP ((void *) (uintptr_t) -1)
+
+
+/********************* previous implementation ***********************/
+
+typedef struct NodeL {
+    void*           data;
+    struct NodeL*   next;
+} NodeL_t;
+
+typedef struct List {
+    NodeL_t*        head;
+    NodeL_t*        tail;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} List_t;
+
+static List_t* initList( void ){
+    List_t* l = calloc(1, sizeof(List_t));
+    if(!l) return NULL;
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->cond, NULL);
+    return l;
+}
+
+static void deleteList( List_t* l ){
+    pthread_mutex_destroy(&l->lock);
+    pthread_cond_destroy(&l->cond);
+    free(l);
+}
+
+static int pushList( List_t* l, void* data, size_t size ){
+    NodeL_t* n = malloc(sizeof(NodeL_t));
+    if(!n) return -1;
+    n->data = malloc(size);
+    memcpy(n->data, data, size);
+    n->next = NULL;
+    LOCK(&l->lock);
+    if(l->head == NULL) l->head = n;
+    else l->tail->next = n;
+    l->tail = n;
+    SIGNAL(&l->cond);
+    UNLOCK(&l->lock);
+    return 0;
+}
+
+static void* popList( List_t* l ){
+    LOCK(&l->lock);
+    while(l->head == NULL) WAIT(&l->cond, &l->lock);
+    NodeL_t* n = l->head;
+    l->head = n->next;
+    UNLOCK(&l->lock);
+    void* data = n->data;
+    free(n);
+    return data;
+}
+
+
+/***************************** benchmark *****************************/
+
+typedef struct _bench_t {
+    int             ring;       // 1 for Buffer_t, 0 for the list
+    Buffer_t*       b;
+    List_t*         l;
+    unsigned long   n;          // elements pushed by each producer
+} bench_t;
+
+static void push_elem( bench_t* t, void* data ){
+    if(!t->ring){
+        pushList(t->l, &data, sizeof(void *));
+        return;
+    }
+    // the ring is bounded: the producer waits for a free cell
+    while(pushBuffer(t->b, data) == -1) sched_yield();
+}
+
+static void* pop_elem( bench_t* t ){
+    if(t->ring) return popBuffer(t->b);
+    void** p = (void **) popList(t->l);
+    void* data = *p;
+    free(p);
+    return data;
+}
+
+static void* producer( void* args ){
+    bench_t* t = (bench_t *) args;
+    unsigned long i;
+    for(i=1; i<=t->n; i++) push_elem(t, (void *) (uintptr_t) i);
+    return NULL;
+}
+
+static void* consumer( void* args ){
+    bench_t* t = (bench_t *) args;
+    while(pop_elem(t) != STOP);
+    return NULL;
+}
+
+static double now( void ){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+* @returns : millions of elements per second passed from
+*            'n_prod' producers to 'n_cons' consumers
+*/
+static double run( bench_t* t, int n_prod, int n_cons ){
+    pthread_t tid[64];
+    int i;
+    double start = now();
+    for(i=0; i<n_cons; i++) pthread_create(&tid[i], NULL, consumer, t);
+    for(i=0; i<n_prod; i++) pthread_create(&tid[n_cons + i], NULL, producer, t);
+    for(i=0; i<n_prod; i++) pthread_join(tid[n_cons + i], NULL);
+    for(i=0; i<n_cons; i++) push_elem(t, STOP);
+    for(i=0; i<n_cons; i++) pthread_join(tid[i], NULL);
+    return (t->n * n_prod) / (now() - start) / 1e6;
+}
+
+int main( int argc, char** argv ){
+    unsigned long n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned long size = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1024;
+    int conf[][2] = { {1, 1}, {2, 2}, {4, 4}, {1, 8}, {8, 1}, {16, 16} };
+    size_t k;
+
+    fprintf(stdout, "%6s %6s %14s %14s\n", "prod", "cons", "list Mops/s", "ring Mops/s");
+    for(k=0; k<sizeof(conf)/sizeof(conf[0]); k++){
+        bench_t list = {0, NULL, NULL, n / conf[k][0]};
+        bench_t ring = {1, NULL, NULL, n / conf[k][0]};
+        if((list.l = initList()) == NULL || (ring.b = initBuffer(size)) == NULL){
+            perror("init");
+            return EXIT_FAILURE;
+        }
+        double l = run(&list, conf[k][0], conf[k][1]);
+        double r = run(&ring, conf[k][0], conf[k][1]);
+        fprintf(stdout, "%6d %6d %14.2f %14.2f\n", conf[k][0], conf[k][1], l, r);
+        deleteList(list.l);
+        deleteBuffer(ring.b);
+    }
+    return 0;
+}
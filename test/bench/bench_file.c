@@ -0,0 +1,166 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+
+/**
+ * @file bench_file.c
+ *
+ * memory of the files: the size of file_t and the bytes taken from the
+ * heap by each file (file_t, key, openers), for files opened by a growing
+ * number of clients. The files have no contents and a key of about 40
+ * bytes, as the many small files of a real server.
+ *
+ * The same files are also built with the previous layout (old_file_t,
+ * the openers in an fd_set) to print the two side by side.
+ *
+ * The heap is measured with mallinfo2 before and after creating the files.
+ *
+ * usage: bench_file [files]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "my_file.h"
+
+
+/**
+* the file before the openers_t: the openers in an fd_set
+* (same fields and same allocations as the previous file_create)
+*/
+typedef struct _old_file_t {
+    char*                   key;
+    size_t                  size_key;
+    uint64_t                hash;
+    void*                   data;
+    size_t                  size_data;
+    fbuf_t*                 buf;
+    fd_set                  set;
+    int                     log;
+    pthread_mutex_t         flock;
+    pthread_cond_t          fcond;
+    struct _old_file_t*     next;
+    NodeE_t                 retire;
+} old_file_t;
+
+static old_file_t* old_file_create( char* key, size_t size_key, int fd ){
+    old_file_t* f = (old_file_t *) malloc(sizeof(old_file_t));
+    if(!f) return NULL;
+    if((f->key = (char *) malloc(size_key)) == NULL){
+        free(f);
+        return NULL;
+    }
+    strcpy(f->key, key);
+    f->size_key  = size_key;
+    f->hash      = 0;
+    f->data      = NULL;
+    f->size_data = 0;
+    f->buf       = NULL;
+    f->log       = -1;
+    f->next      = NULL;
+    FD_ZERO(&f->set);
+    FD_SET(fd, &f->set);
+    pthread_mutex_init(&f->flock, NULL);
+    pthread_cond_init(&f->fcond, NULL);
+    return f;
+}
+
+static void old_file_free( old_file_t* f ){
+    free(f->key);
+    pthread_mutex_destroy(&f->flock);
+    pthread_cond_destroy(&f->fcond);
+    free(f);
+}
+
+
+static size_t heap_used( void ){
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+int main( int argc, char** argv ){
+    long n = (argc > 1) ? atol(argv[1]) : 100000;
+    int openers[] = { 1, 4, 8, 64 };
+    char key[256];
+    size_t k;
+
+    if(n <= 0){
+        fprintf(stderr, "usage: %s [files]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    file_t** files = malloc(n * sizeof(file_t *));
+    old_file_t** old_files = malloc(n * sizeof(old_file_t *));
+    if(!files || !old_files){
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "sizeof(file_t) = %zu bytes with fd_set, %zu bytes with openers_t, %ld files\n",
+                sizeof(old_file_t), sizeof(file_t), n);
+    fprintf(stdout, "%8s %16s %16s\n", "openers", "fd_set", "openers_t");
+    for(k=0; k<sizeof(openers)/sizeof(openers[0]); k++){
+        size_t before = heap_used();
+        for(long i=0; i<n; i++){
+            snprintf(key, sizeof(key), "/home/user/project/src/module_%ld/file_%ld.c", i / 100, i);
+            if((old_files[i] = old_file_create(key, strlen(key) + 1, 4)) == NULL){
+                perror("old_file_create");
+                return EXIT_FAILURE;
+            }
+            for(int j=1; j<openers[k]; j++)
+                FD_SET(4 + j, &old_files[i]->set);
+        }
+        size_t old_heap = heap_used() - before;
+        for(long i=0; i<n; i++)
+            old_file_free(old_files[i]);
+
+        before = heap_used();
+        for(long i=0; i<n; i++){
+            snprintf(key, sizeof(key), "/home/user/project/src/module_%ld/file_%ld.c", i / 100, i);
+            // the first opener is the client that creates the file
+            if((files[i] = file_create(key, strlen(key) + 1, NULL, 0, 4)) == NULL){
+                perror("file_create");
+                return EXIT_FAILURE;
+            }
+            for(int j=1; j<openers[k]; j++)
+                file_add_fd(files[i], 4 + j);
+        }
+        size_t new_heap = heap_used() - before;
+        fprintf(stdout, "%8d %16.1f %16.1f\n", openers[k], (double) old_heap / n, (double) new_heap / n);
+        for(long i=0; i<n; i++)
+            file_free(files[i]);
+    }
+    free(old_files);
+    free(files);
+    return 0;
+}
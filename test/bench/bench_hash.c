@@ -0,0 +1,187 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+/**
+ * @file bench_hash.c
+ *
+ * microbenchmark of the hash of the pathnames: the hash of my_file.h against
+ * the previous one (sum of the characters of a copy of the key), on sets of
+ * absolute pathnames like the ones the clients send
+ *
+ * For each set: the time to hash a key, the buckets used and the longest
+ * chain in a table of as many buckets as keys, the lookups per second of
+ * the table of my_hash.h built with each function
+ *
+ * usage: bench_hash [keys per set] [lookups]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "my_hash.h"
+#include "my_file.h"
+
+
+/********************* previous implementation ***********************/
+
+static uint64_t hash_sum( char* key ){
+    if(!key)
+        return -1;
+
+    size_t len = strlen(key)+1;
+    if(len <= 1)
+        return -1;
+    char *str_key = (char *) malloc(len * sizeof(char));
+    memset(str_key, '\0', len);
+    memcpy(str_key, key, len);
+
+    unsigned int key_value = 0;
+    for(int i=0; str_key[i] != '\0'; i++)
+        key_value += (unsigned int) str_key[i];
+    free(str_key);
+    return key_value;
+}
+
+
+/***************************** benchmark *****************************/
+
+typedef struct _set_t {
+    const char*     name;
+    const char*     fmt;        // pathname of the key (i / 100, i)
+} set_t;
+
+static const set_t sets[] = {
+    { "project", "/home/user/project/src/module_%d/file_%d.c" },
+    { "logs",    "/var/log/server/2021/05/%02d/request-%06d.log" },
+    { "archive", "/mnt/storage/archive/backup/customers/customer_%04d/invoices/2021/invoice_%08d.pdf" },
+    { "tmp",     "/tmp/f%d_%d" },
+};
+
+static double now( void ){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char** make_keys( const set_t* s, int n ){
+    char** keys = malloc(n * sizeof(char *));
+    char buf[256];
+    for(int i=0; i<n; i++){
+        snprintf(buf, sizeof(buf), s->fmt, i / 100, i);
+        keys[i] = strdup(buf);
+    }
+    return keys;
+}
+
+/**
+* @returns : nanoseconds to hash a key
+*/
+static double time_hash( uint64_t (*f)(char *), char** keys, int n ){
+    volatile uint64_t sink = 0;
+    int rounds = 2000000 / n + 1;
+    double start = now();
+    for(int r=0; r<rounds; r++)
+        for(int i=0; i<n; i++)
+            sink ^= f(keys[i]);
+    (void) sink;
+    return (now() - start) * 1e9 / ((double) rounds * n);
+}
+
+/**
+* buckets used and longest chain in a table of 'size' buckets (power of 2)
+*/
+static void spread( uint64_t (*f)(char *), char** keys, int n, int size, int* used, int* longest ){
+    int* count = calloc(size, sizeof(int));
+    *used = 0;
+    *longest = 0;
+    for(int i=0; i<n; i++){
+        int b = f(keys[i]) & (size - 1);
+        if(count[b]++ == 0) (*used)++;
+        if(count[b] > *longest) *longest = count[b];
+    }
+    free(count);
+}
+
+/**
+* @returns : millions of lookups per second in a table of my_hash.h
+*/
+static double lookups( uint64_t (*f)(char *), char** keys, int n, long m ){
+    hash_t* ht = hash_create(n, f, &hash_key_compare_for_file_t);
+    for(int i=0; i<n; i++)
+        hash_insert(ht, keys[i], strlen(keys[i]) + 1, NULL, 0, -1);
+    hash_finish_resize(ht);
+    double start = now();
+    for(long j=0; j<m; j++)
+        if(hash_find(ht, keys[(j * 7919) % n]) == NULL){
+            fprintf(stderr, "key not found: %s\n", keys[(j * 7919) % n]);
+            exit(EXIT_FAILURE);
+        }
+    double t = now() - start;
+    // emptied first: hash_destroy prints the files it deletes
+    for(int i=0; i<n; i++)
+        file_free(hash_remove(ht, keys[i]));
+    hash_destroy(ht);
+    return m / t / 1e6;
+}
+
+int main( int argc, char** argv ){
+    int n = (argc > 1) ? atoi(argv[1]) : 10000;
+    long m = (argc > 2) ? atol(argv[2]) : 2000000;
+    int size = 1;
+    size_t k;
+
+    if(n <= 0 || m <= 0){
+        fprintf(stderr, "usage: %s [keys per set] [lookups]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    while(size < n) size *= 2;
+
+    fprintf(stdout, "%d keys, %d buckets, %ld lookups\n", n, size, m);
+    fprintf(stdout, "%8s %6s %8s %8s %8s %10s\n", "set", "hash", "ns/key", "buckets", "longest", "Mlookup/s");
+    for(k=0; k<sizeof(sets)/sizeof(sets[0]); k++){
+        char** keys = make_keys(&sets[k], n);
+        struct { const char* name; uint64_t (*f)(char *); } fn[] = {
+            { "sum", &hash_sum }, { "wyhash", &hash_function_for_file_t }
+        };
+        for(size_t j=0; j<sizeof(fn)/sizeof(fn[0]); j++){
+            int used, longest;
+            double ns = time_hash(fn[j].f, keys, n);
+            spread(fn[j].f, keys, n, size, &used, &longest);
+            fprintf(stdout, "%8s %6s %8.1f %8d %8d %10.2f\n", sets[k].name, fn[j].name,
+                    ns, used, longest, lookups(fn[j].f, keys, n, m));
+        }
+        for(int i=0; i<n; i++) free(keys[i]);
+        free(keys);
+    }
+    return 0;
+}
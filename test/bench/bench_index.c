@@ -0,0 +1,148 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+/**
+ * @file bench_index.c
+ *
+ * microbenchmark of the lookups in the table of the files: the lists of
+ * the buckets (hash_create) against the open-addressing index of swiss.h
+ * (hash_create_swiss), with tables of growing size
+ *
+ * The keys are looked up in random order, those that are in the table
+ * (hit) and as many that are not (miss).
+ *
+ * usage: bench_index [lookups]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "my_hash.h"
+#include "my_file.h"
+
+
+static double now( void ){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char** make_keys( int n, const char* ext ){
+    char** keys = malloc(n * sizeof(char *));
+    char buf[256];
+    for(int i=0; i<n; i++){
+        snprintf(buf, sizeof(buf), "/home/user/project/src/module_%d/file_%d.%s", i / 100, i, ext);
+        keys[i] = strdup(buf);
+    }
+    return keys;
+}
+
+static void free_keys( char** keys, int n ){
+    for(int i=0; i<n; i++) free(keys[i]);
+    free(keys);
+}
+
+/**
+* @returns : 'm' indexes of keys in [0, n) in random order
+*/
+static int* make_order( int n, long m ){
+    int* order = malloc(m * sizeof(int));
+    uint64_t x = 88172645463325252ULL;
+    for(long j=0; j<m; j++){
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        order[j] = (int) (x % n);
+    }
+    return order;
+}
+
+/**
+* @returns : nanoseconds per lookup of the keys 'keys' in the order 'order'
+*/
+static double lookups( hash_t* ht, char** keys, int* order, long m, int hit ){
+    double start = now();
+    for(long j=0; j<m; j++){
+        if((hash_find(ht, keys[order[j]]) != NULL) != hit){
+            fprintf(stderr, "wrong lookup: %s\n", keys[order[j]]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return (now() - start) * 1e9 / m;
+}
+
+int main( int argc, char** argv ){
+    long m = (argc > 1) ? atol(argv[1]) : 2000000;
+    int sizes[] = { 1000, 16000, 256000, 1000000 };
+    size_t k;
+
+    if(m <= 0){
+        fprintf(stderr, "usage: %s [lookups]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "%ld lookups, ns per lookup\n", m);
+    fprintf(stdout, "%8s %10s %10s %10s %10s\n", "files", "chain hit", "swiss hit", "chain miss", "swiss miss");
+    for(k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++){
+        int n = sizes[k];
+        char** keys = make_keys(n, "c");
+        char** miss = make_keys(n, "h");
+        int* order = make_order(n, m);
+        hash_t* ht[2];
+        double t[2][2];
+
+        // both grow from the same initial size, as files_server
+        ht[0] = hash_create(128, &hash_function_for_file_t, &hash_key_compare_for_file_t);
+        ht[1] = hash_create_swiss(128, &hash_function_for_file_t, &hash_key_compare_for_file_t);
+        for(int b=0; b<2; b++){
+            if(!ht[b]){
+                perror("hash_create");
+                return EXIT_FAILURE;
+            }
+            for(int i=0; i<n; i++)
+                hash_insert(ht[b], keys[i], strlen(keys[i]) + 1, NULL, 0, -1);
+            hash_finish_resize(ht[b]);
+            t[b][0] = lookups(ht[b], keys, order, m, 1);
+            t[b][1] = lookups(ht[b], miss, order, m, 0);
+            // emptied first: hash_destroy prints the files it deletes
+            for(int i=0; i<n; i++)
+                file_free(hash_remove(ht[b], keys[i]));
+            hash_destroy(ht[b]);
+        }
+        fprintf(stdout, "%8d %10.1f %10.1f %10.1f %10.1f\n", n, t[0][0], t[1][0], t[0][1], t[1][1]);
+        free_keys(keys, n);
+        free_keys(miss, n);
+        free(order);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+
+/**
+ * @file stress_conn.c
+ *
+ * stress test of the connections of the client library: each thread opens
+ * its own handle (fss_openConnection) and, on its own files, creates,
+ * writes, appends, reads back (in the reply and mapped), removes, writes a
+ * batch in a pipeline and finally closes the handle
+ *
+ * Every file has contents that depend on the thread and on the file: a
+ * thread that reads back other bytes has received the reply of another
+ * handle. Built with a sanitizer (SANITIZE in the Makefile) the races
+ * between the handles are also reported.
+ *
+ * It needs a running server (scripts/stress_conn.sh starts one).
+ *
+ * usage: stress_conn socket folder [threads] [files]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "interface.h"
+
+// bytes written, then appended, to each file
+#define STRESS_SIZE (6000)
+#define STRESS_APPEND (100)
+// requests waiting for their reply in the pipeline
+#define STRESS_WINDOW (4)
+
+typedef struct _conn_arg_t {
+    const char*     sock;
+    const char*     dir;
+    int             id;
+    int             files;
+    long            errors;
+} conn_arg_t;
+
+static void fill( char* buf, size_t size, int id, int k ){
+    for(size_t i=0; i<size; i++) buf[i] = 'a' + (id * 7 + k + i) % 26;
+}
+
+static int create_local( const char* path, const char* buf, size_t size ){
+    FILE* f = fopen(path, "w");
+    if(!f) return -1;
+    size_t n = fwrite(buf, 1, size, f);
+    fclose(f);
+    return (n == size) ? 0 : -1;
+}
+
+// 1 if the file read is 'size' bytes equal to 'buf'
+static int same( void* r, size_t sz, const char* buf, size_t size ){
+    return r != NULL && sz == size && memcmp(r, buf, size) == 0;
+}
+
+static void* client( void* args ){
+    conn_arg_t* a = (conn_arg_t *) args;
+    char path[512];
+    char* buf = malloc(STRESS_SIZE + STRESS_APPEND);
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    t.tv_sec += 5;
+
+    fss_conn* c = fss_openConnection(a->sock, 100, t);
+    if(!c || !buf){
+        a->errors++;
+        free(buf);
+        return NULL;
+    }
+    for(int k=0; k<a->files; k++){
+        void* r = NULL;
+        size_t sz = 0;
+        snprintf(path, sizeof(path), "%s/t%d_f%d", a->dir, a->id, k);
+        fill(buf, STRESS_SIZE + STRESS_APPEND, a->id, k);
+        if(create_local(path, buf, STRESS_SIZE) == -1
+            || fss_openFile(c, path, O_CREATE_LOCK) == -1
+            || fss_writeFile(c, path, NULL) == -1
+            || fss_appendToFile(c, path, buf + STRESS_SIZE, STRESS_APPEND, NULL) == -1){
+            a->errors++;
+            continue;
+        }
+        if(fss_readFile(c, path, &r, &sz) == -1 || !same(r, sz, buf, STRESS_SIZE + STRESS_APPEND))
+            a->errors++;
+        free(r);
+        r = NULL;
+        if(fss_readFileMapped(c, path, &r, &sz) == -1){
+            a->errors++;
+        }else{
+            if(!same(r, sz, buf, STRESS_SIZE + STRESS_APPEND)) a->errors++;
+            releaseFileMapped(r, sz);
+        }
+        if(k % 2 == 0){
+            if(fss_removeFile(c, path) == -1) a->errors++;
+        }else{
+            if(fss_unlockFile(c, path) == -1 || fss_closeFile(c, path) == -1) a->errors++;
+        }
+    }
+
+    // a batch of new files in a single pipeline
+    if(fss_beginPipeline(c, STRESS_WINDOW) == -1){
+        a->errors++;
+    }else{
+        for(int k=0; k<a->files; k++){
+            snprintf(path, sizeof(path), "%s/t%d_p%d", a->dir, a->id, k);
+            fill(buf, STRESS_SIZE, a->id, k + a->files);
+            if(create_local(path, buf, STRESS_SIZE) == -1
+                || fss_openFile(c, path, O_CREATE_LOCK) == -1
+                || fss_writeFile(c, path, NULL) == -1) a->errors++;
+        }
+        if(fss_endPipeline(c) == -1) a->errors++;
+    }
+
+    if(fss_closeConnection(c) == -1) a->errors++;
+    free(buf);
+    return NULL;
+}
+
+int main( int argc, char** argv ){
+    int n_threads = (argc > 3) ? atoi(argv[3]) : 8;
+    int files = (argc > 4) ? atoi(argv[4]) : 50;
+    long errors = 0;
+
+    if(argc < 3 || n_threads <= 0 || files <= 0){
+        fprintf(stderr, "usage: %s socket folder [threads] [files]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    pthread_t* th = malloc(n_threads * sizeof(pthread_t));
+    conn_arg_t* a = malloc(n_threads * sizeof(conn_arg_t));
+    if(!th || !a){
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    for(int i=0; i<n_threads; i++){
+        a[i] = (conn_arg_t) { argv[1], argv[2], i, files, 0 };
+        pthread_create(&th[i], NULL, &client, &a[i]);
+    }
+    for(int i=0; i<n_threads; i++){
+        pthread_join(th[i], NULL);
+        errors += a[i].errors;
+    }
+
+    fprintf(stdout, "%d threads (one handle each), %d files each: %ld errors\n", n_threads, files, errors);
+    free(th);
+    free(a);
+    return (errors == 0) ? 0 : EXIT_FAILURE;
+}
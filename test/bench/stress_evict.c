@@ -0,0 +1,192 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021 Adrien Koumgang Tegantchouang
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+
+
+/**
+ * @file stress_evict.c
+ *
+ * stress test of the lookups without locks: reader threads look up the
+ * files and read their key and contents while a writer keeps removing
+ * them (as the eviction of the server) and inserting them again
+ *
+ * Every file has its own pathname as contents: a reader that finds a file
+ * with a different key or different contents has read memory released
+ * too early. Built with a sanitizer (SANITIZE in the Makefile) a use
+ * after free is also reported as soon as it happens.
+ *
+ * Both tables are tested: the lists of the buckets (hash_create), which
+ * also grow while the readers run, and the open-addressing index
+ * (hash_create_swiss).
+ *
+ * usage: stress_evict [readers] [seconds]
+ *
+ * @author adrien koumgang tegantchouang
+ * @version 1.0
+ * @date 00/05/2021
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "my_hash.h"
+#include "my_file.h"
+
+// number of pathnames, half of them are in the table at any time
+#define STRESS_KEYS (20000)
+
+typedef struct _stress_t {
+    hash_t*         ht;
+    char**          keys;
+    int             stop;
+    long            reads;
+    long            hits;
+    long            errors;
+    long            evictions;
+    uint64_t        seed;
+} stress_t;
+
+static double now( void ){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* reader( void* arg ){
+    stress_t* st = (stress_t *) arg;
+    uint64_t x = __atomic_add_fetch(&st->seed, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED);
+    long reads = 0, hits = 0, errors = 0;
+
+    while(!__atomic_load_n(&st->stop, __ATOMIC_RELAXED)){
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        char* key = st->keys[x % STRESS_KEYS];
+        size_t len = strlen(key) + 1;
+
+        hash_read_begin(st->ht);
+        data_hash_t* f = hash_find(st->ht, key);
+        if(f != NULL){
+            fbuf_t* b = NULL;
+            hits++;
+            if(f->size_key != len || strcmp(f->key, key) != 0)
+                errors++;
+            file_pin_content(f, &b);
+            if(b == NULL || b->size != len || memcmp(b->data, key, len) != 0)
+                errors++;
+            fbuf_release(b);
+        }
+        hash_read_end(st->ht);
+        reads++;
+    }
+    __atomic_add_fetch(&st->reads, reads, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&st->hits, hits, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&st->errors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/**
+* inserts the pathname j and removes the one inserted STRESS_KEYS/2 steps
+* before, as long as the readers run
+*/
+static void* evicter( void* arg ){
+    stress_t* st = (stress_t *) arg;
+    long evictions = 0;
+
+    for(long j=0; !__atomic_load_n(&st->stop, __ATOMIC_RELAXED); j++){
+        char* in = st->keys[j % STRESS_KEYS];
+        char* out = st->keys[(j + STRESS_KEYS / 2) % STRESS_KEYS];
+        size_t len = strlen(in) + 1;
+
+        hash_insert(st->ht, in, len, in, len, -1);
+        data_hash_t* f = hash_remove(st->ht, out);
+        if(f != NULL){
+            hash_release_item(st->ht, f);
+            evictions++;
+        }
+    }
+    st->evictions = evictions;
+    return NULL;
+}
+
+static int stress( const char* name, hash_t* ht, char** keys, int n_readers, int seconds ){
+    stress_t st = { ht, keys, 0, 0, 0, 0, 0, 88172645463325252ULL };
+    pthread_t* th = malloc((n_readers + 1) * sizeof(pthread_t));
+    double start = now();
+
+    if(!ht || !th){
+        perror("stress");
+        exit(EXIT_FAILURE);
+    }
+    for(int i=0; i<n_readers; i++)
+        pthread_create(&th[i], NULL, &reader, &st);
+    pthread_create(&th[n_readers], NULL, &evicter, &st);
+    while(now() - start < seconds && !__atomic_load_n(&st.errors, __ATOMIC_RELAXED)){
+        struct timespec ts = { 0, 100 * 1000 * 1000 };
+        nanosleep(&ts, NULL);
+    }
+    __atomic_store_n(&st.stop, 1, __ATOMIC_RELAXED);
+    for(int i=0; i<=n_readers; i++)
+        pthread_join(th[i], NULL);
+
+    fprintf(stdout, "%8s %12ld %12ld %12ld %8ld\n", name, st.reads, st.hits, st.evictions, st.errors);
+
+    // emptied first: hash_destroy prints the files it deletes
+    for(int i=0; i<STRESS_KEYS; i++)
+        hash_release_item(ht, hash_remove(ht, keys[i]));
+    hash_destroy(ht);
+    free(th);
+    return st.errors == 0;
+}
+
+int main( int argc, char** argv ){
+    int n_readers = (argc > 1) ? atoi(argv[1]) : 4;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 5;
+    char** keys = malloc(STRESS_KEYS * sizeof(char *));
+    char buf[256];
+    int ok = 1;
+
+    if(n_readers <= 0 || seconds <= 0 || !keys){
+        fprintf(stderr, "usage: %s [readers] [seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    for(int i=0; i<STRESS_KEYS; i++){
+        snprintf(buf, sizeof(buf), "/home/user/project/src/module_%d/file_%d.c", i / 100, i);
+        keys[i] = strdup(buf);
+    }
+
+    fprintf(stdout, "%d readers, %d seconds\n", n_readers, seconds);
+    fprintf(stdout, "%8s %12s %12s %12s %8s\n", "table", "lookups", "found", "evictions", "errors");
+    ok &= stress("chain", hash_create(128, &hash_function_for_file_t, &hash_key_compare_for_file_t), keys, n_readers, seconds);
+    ok &= stress("swiss", hash_create_swiss(128, &hash_function_for_file_t, &hash_key_compare_for_file_t), keys, n_readers, seconds);
+
+    for(int i=0; i<STRESS_KEYS; i++) free(keys[i]);
+    free(keys);
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# bandwidth of the transport of the contents: the same large files are
+# written to and read from the server through the socket (SHM_RING_SIZE:0)
+# and through the shared-memory rings of the connection
+#
+# usage: bench_shm.sh [files] [size of a file in KB] [rounds]
+
+server="../main/bin/server"
+client="../main/bin/client"
+n=${1:-16}
+kb=${2:-4096}
+rounds=${3:-8}
+rings="0 1048576 16777216"
+
+tmp=$(mktemp -d)
+trap 'rm -rf $tmp' EXIT
+sock="$tmp/sock"
+
+files="$tmp/f1"
+head -c $((kb * 1024)) /dev/urandom > "$tmp/f1"
+for i in $(seq 2 $n); do
+    head -c $((kb * 1024)) /dev/urandom > "$tmp/f$i"
+    files="$files,$tmp/f$i"
+done
+
+printf "%10s %12s %12s %12s\n" "ring" "seconds" "write MB/s" "read MB/s"
+for r in $rings; do
+    cat > "$tmp/config.txt" << EOF
+THREAD_WORKERS:4
+SIZE_MEMORY:$((n * kb * 1024 * 2))
+NUMBER_OF_FILES:$((n * 2))
+CONCURRENT_CLIENTS:8
+SOCKET_NAME:$sock
+LOG_FILE_NAME:$tmp/log.txt
+SHM_RING_SIZE:$r
+EOF
+    $server "$tmp/config.txt" > /dev/null 2>&1 &
+    pid=$!
+    while [ ! -S "$sock" ]; do sleep 0.1; done
+
+    start=$(date +%s.%N)
+    for i in $(seq 1 $rounds); do
+        $client -f "$sock" -W $files > /dev/null 2>&1
+    done
+    middle=$(date +%s.%N)
+    for i in $(seq 1 $rounds); do
+        $client -f "$sock" -r $files > /dev/null 2>&1
+    done
+    end=$(date +%s.%N)
+
+    kill -INT $pid
+    wait $pid 2> /dev/null
+    rm -f "$sock"
+    echo "$r $start $middle $end" | awk -v mb=$((n * kb * rounds / 1024)) \
+        '{ printf "%10d %12.3f %12.1f %12.1f\n", $1, $4 - $2, mb / ($3 - $2), mb / ($4 - $3) }'
+done
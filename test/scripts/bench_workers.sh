@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# throughput of the server as the number of workers grows:
+# for each value of THREAD_WORKERS the same load is sent by
+# parallel clients, each one reading the same files many times
+#
+# usage: bench_workers.sh [clients] [reads per client]
+
+server="../main/bin/server"
+client="../main/bin/client"
+clients=${1:-32}
+reads=${2:-200}
+workers="1 2 4 8 16 32"
+
+tmp=$(mktemp -d)
+trap 'rm -rf $tmp' EXIT
+sock="$tmp/sock"
+
+# a few files of different sizes
+for i in 1 2 3 4; do
+    head -c $((i * 4096)) /dev/urandom > "$tmp/f$i"
+done
+files="$tmp/f1,$tmp/f2,$tmp/f3,$tmp/f4"
+list="$tmp/f1"
+for i in $(seq 2 $reads); do
+    list="$list,$tmp/f$(( (i - 1) % 4 + 1 ))"
+done
+
+printf "%8s %10s %12s\n" "workers" "seconds" "requests/s"
+for w in $workers; do
+    cat > "$tmp/config.txt" << EOF
+THREAD_WORKERS:$w
+SIZE_MEMORY:100000000
+NUMBER_OF_FILES:100
+CONCURRENT_CLIENTS:$((clients + 8))
+SOCKET_NAME:$sock
+LOG_FILE_NAME:$tmp/log.txt
+IO_THREADS:2
+IO_BACKEND:epoll
+EOF
+    $server "$tmp/config.txt" > /dev/null 2>&1 &
+    pid=$!
+    while [ ! -S "$sock" ]; do sleep 0.1; done
+    $client -f "$sock" -W $files > /dev/null 2>&1
+
+    start=$(date +%s.%N)
+    for c in $(seq 1 $clients); do
+        $client -f "$sock" -r $list > /dev/null 2>&1 &
+    done
+    wait $(jobs -p | grep -v "^$pid$")
+    end=$(date +%s.%N)
+
+    kill -INT $pid
+    wait $pid 2> /dev/null
+    rm -f "$sock"
+    echo "$w $start $end" | awk -v n=$((clients * reads)) '{ t = $3 - $2; printf "%8d %10.3f %12.0f\n", $1, t, n / t }'
+done
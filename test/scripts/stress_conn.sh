@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# runs stress_conn (threads of one process, one handle each) against the
+# server started with each configuration given, with room for all the
+# files so that none is ejected while its thread still uses it
+#
+# usage: stress_conn.sh config1 [config2 ...]
+
+server="../main/bin/server"
+stress="../main/bin/stress_conn"
+
+tmp=$(mktemp -d)
+trap 'kill $pid 2> /dev/null; rm -rf $tmp' EXIT
+
+failed=0
+
+for conf in "$@"; do
+    sock=$(sed -n 's/^SOCKET_NAME://p' "$conf")
+    backend=$(sed -n 's/^IO_BACKEND://p' "$conf")
+    echo "$conf (${backend:-epoll})"
+    rm -rf "$tmp/files" "$sock"
+    mkdir -p "$tmp/files"
+    sed 's/^NUMBER_OF_FILES:.*/NUMBER_OF_FILES:100000/' "$conf" > "$tmp/config.txt"
+
+    $server "$tmp/config.txt" > "$tmp/server.out" 2>&1 &
+    pid=$!
+    while [ ! -S "$sock" ]; do
+        kill -0 $pid 2> /dev/null || { echo "    FAILED: the server did not start"; failed=1; continue 2; }
+        sleep 0.1
+    done
+
+    $stress "$sock" "$tmp/files" 8 50 || failed=1
+
+    kill -HUP $pid
+    wait $pid 2> /dev/null
+done
+
+exit $failed
@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# runs the same requests against the server once for each configuration
+# given (one per I/O backend): writes, reads back and compares the files,
+# reads all the files, serves parallel clients and stops on SIGHUP
+#
+# usage: test_backends.sh config1 [config2 ...]
+
+server="../main/bin/server"
+client="../main/bin/client"
+
+tmp=$(mktemp -d)
+trap 'kill $pid 2> /dev/null; rm -rf $tmp' EXIT
+
+# a few files of different sizes, some above the threshold of the memfds:
+# the first two are written one by one, the others as a folder
+mkdir -p "$tmp/in" "$tmp/in/dir"
+for i in $(seq 1 8); do
+    if [ $i -le 2 ]; then f="$tmp/in/f$i"; else f="$tmp/in/dir/f$i"; fi
+    head -c $(( i * 16384 + 100 )) /dev/urandom > "$f"
+done
+
+failed=0
+
+# prints the error and marks the run as failed
+fail(){
+    echo "    FAILED: $1"
+    ok=0
+    failed=1
+}
+
+for conf in "$@"; do
+    sock=$(sed -n 's/^SOCKET_NAME://p' "$conf")
+    backend=$(sed -n 's/^IO_BACKEND://p' "$conf")
+    echo "$conf (${backend:-epoll})"
+    ok=1
+    rm -rf "$tmp/out" "$tmp/all" "$sock"
+    mkdir -p "$tmp/out" "$tmp/all"
+
+    $server "$conf" > "$tmp/server.out" 2>&1 &
+    pid=$!
+    while [ ! -S "$sock" ]; do
+        kill -0 $pid 2> /dev/null || { fail "the server did not start"; continue 2; }
+        sleep 0.1
+    done
+    grep -q "io_uring not available" "$tmp/server.out" && echo "    io_uring not available: the reactors use epoll"
+
+    $client -f "$sock" -W "$tmp/in/f1,$tmp/in/f2" > /dev/null 2>&1 || fail "write of single files"
+    $client -f "$sock" -w "$tmp/in/dir,n=0" > /dev/null 2>&1 || fail "write of a folder"
+    $client -f "$sock" -d "$tmp/out" -r "$tmp/in/f1,$tmp/in/f2,$tmp/in/dir/f8" > /dev/null 2>&1 || fail "read of the files"
+    for f in f1 f2 dir/f8; do
+        cmp -s "$tmp/in/$f" "$tmp/out/$(basename $f)" || fail "contents of $f"
+    done
+    $client -f "$sock" -d "$tmp/all" -R n=0 > /dev/null 2>&1 || fail "read of all the files"
+    [ -n "$(find "$tmp/all" -type f)" ] || fail "no file read with -R"
+
+    par=""
+    for j in $(seq 1 16); do
+        $client -f "$sock" -d "$tmp/out" -r "$tmp/in/f$(( j % 2 + 1 )),$tmp/in/dir/f$(( j % 6 + 3 ))" > /dev/null 2>&1 &
+        par="$par $!"
+    done
+    for p in $par; do
+        wait $p || fail "parallel read $p"
+    done
+
+    kill -HUP $pid
+    for j in $(seq 1 50); do
+        kill -0 $pid 2> /dev/null || break
+        sleep 0.1
+    done
+    if kill -0 $pid 2> /dev/null; then
+        fail "the server did not stop on SIGHUP"
+        kill -9 $pid
+    fi
+    wait $pid 2> /dev/null
+    [ $ok -eq 1 ] && echo "    ok"
+done
+
+exit $failed
@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# fairness between clients: latency of the reads of an interactive
+# client, first with the server idle, then while bulk uploaders write
+# a large tree of files (-w dir,n=0)
+#
+# usage: test_fair.sh [uploaders] [reads]
+
+server="../main/bin/server"
+client="../main/bin/client"
+uploaders=${1:-2}
+reads=${2:-100}
+
+tmp=$(mktemp -d)
+trap 'kill $pid 2> /dev/null; rm -rf $tmp' EXIT
+sock="$tmp/sock"
+
+# a small file for the interactive client, a tree of large files for each uploader
+head -c 512 /dev/urandom > "$tmp/small"
+for u in $(seq 1 $uploaders); do
+    mkdir -p "$tmp/tree$u"
+    for i in $(seq 1 200); do
+        head -c 262144 /dev/urandom > "$tmp/tree$u/f$i"
+    done
+done
+
+cat > "$tmp/config.txt" << EOF2
+THREAD_WORKERS:2
+SIZE_MEMORY:1000000000
+NUMBER_OF_FILES:1000
+CONCURRENT_CLIENTS:16
+SOCKET_NAME:$sock
+LOG_FILE_NAME:$tmp/log.txt
+IO_THREADS:1
+IO_BACKEND:epoll
+EOF2
+
+# prints the latency (ms) of 'reads' reads of the small file
+latency(){
+    for i in $(seq 1 $reads); do
+        start=$(date +%s%N)
+        $client -f "$sock" -d "$tmp/out" -r "$tmp/small" > /dev/null 2>&1
+        end=$(date +%s%N)
+        echo $(( (end - start) / 1000 ))
+    done | sort -n | awk '{ v[NR] = $1 } END { printf "p50 = %.2f ms, p99 = %.2f ms, max = %.2f ms\n", v[int(NR * 0.5)] / 1000, v[int(NR * 0.99)] / 1000, v[NR] / 1000 }'
+}
+
+$server "$tmp/config.txt" > /dev/null 2>&1 &
+pid=$!
+while [ ! -S "$sock" ]; do sleep 0.1; done
+mkdir -p "$tmp/out"
+$client -f "$sock" -W "$tmp/small" > /dev/null 2>&1
+
+echo -n "idle server           : "
+latency
+
+for u in $(seq 1 $uploaders); do
+    $client -f "$sock" -w "$tmp/tree$u,n=0" > /dev/null 2>&1 &
+done
+echo -n "with $uploaders bulk uploaders : "
+latency
+wait $(jobs -p | grep -v "^$pid$")
+
+kill -INT $pid
+wait $pid 2> /dev/null